@@ -0,0 +1,318 @@
+#include <Arduino.h>
+#include <Wire.h>
+#include <SPI.h>
+#include <Bluepad32.h>
+#include <stdarg.h>
+#include <deque>
+#include "host.h"
+
+// The Arduino core for the host: the clock, Serial, the pins, and a Bluepad32 with one gamepad on it
+
+HardwareSerial Serial;
+TwoWire Wire;
+SPIClass SPI;
+Bluepad32 BP32;
+
+// ------------ Clock ---------------------------------
+
+unsigned long millis() {
+    return (unsigned long) (host_now_us() / 1000);
+}
+
+unsigned long micros() {
+    return (unsigned long) host_now_us();
+}
+
+// as on the ESP32, delay() blocks the task, and lets everyone else run
+void delay(uint32_t ms) {
+    vTaskDelay(ms / portTICK_PERIOD_MS);
+}
+
+// and delayMicroseconds() spins, so the time's the caller's
+void delayMicroseconds(uint32_t us) {
+    host_advance_us(us);
+}
+
+uint32_t getCpuFrequencyMhz() {
+    return F_CPU / 1000000;
+}
+
+// ------------ Pins ----------------------------------
+
+static uint32_t adc_millivolts[GPIO_NUM_MAX];
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    (void) pin;
+    (void) mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    (void) pin;
+    (void) val;
+}
+
+int digitalRead(uint8_t pin) {
+    (void) pin;
+    return LOW;
+}
+
+uint32_t analogReadMilliVolts(uint8_t pin) {
+    return (pin < GPIO_NUM_MAX) ? adc_millivolts[pin] : 0;
+}
+
+void host_adc_set_millivolts(uint8_t pin, uint32_t millivolts) {
+    if (pin < GPIO_NUM_MAX) {
+        adc_millivolts[pin] = millivolts;
+    }
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode) {
+    (void) mode;
+    return (gpio_num >= 0 && gpio_num < GPIO_NUM_MAX) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_pullup_en(gpio_num_t gpio_num) {
+    return (gpio_num >= 0 && gpio_num < GPIO_NUM_MAX) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+// ------------ Serial --------------------------------
+
+static host_serial_output_t serial_output = nullptr;
+static void* serial_output_context = nullptr;
+static int serial_write_room = 128;
+static std::deque<uint8_t> serial_input;
+
+void host_serial_set_output(host_serial_output_t output, void* context) {
+    serial_output = output;
+    serial_output_context = context;
+}
+
+void host_serial_set_write_room(int bytes) {
+    serial_write_room = bytes;
+}
+
+void host_serial_input(const char* text) {
+    while (*text) {
+        serial_input.push_back((uint8_t) *text++);
+    }
+}
+
+void HardwareSerial::begin(unsigned long baud) {
+    (void) baud;
+}
+
+int HardwareSerial::available() {
+    return (int) serial_input.size();
+}
+
+int HardwareSerial::read() {
+    if (serial_input.empty()) {
+        return -1;
+    }
+
+    uint8_t byte = serial_input.front();
+    serial_input.pop_front();
+    return byte;
+}
+
+int HardwareSerial::availableForWrite() {
+    return serial_write_room;
+}
+
+size_t HardwareSerial::write(uint8_t byte) {
+    return write(&byte, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    if (serial_output != nullptr) {
+        serial_output(serial_output_context, buffer, size);
+    } else {
+        fwrite(buffer, 1, size, stdout);
+    }
+    return size;
+}
+
+size_t HardwareSerial::print(const char* text) {
+    return write((const uint8_t*) text, strlen(text));
+}
+
+size_t HardwareSerial::println(const char* text) {
+    return print(text) + print("\r\n");
+}
+
+size_t HardwareSerial::printf(const char* format, ...) {
+    char line[512];
+
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+
+    if (len < 0) {
+        return 0;
+    }
+    return write((const uint8_t*) line, min((size_t) len, sizeof(line) - 1));
+}
+
+void HardwareSerial::flush() {
+    if (serial_output == nullptr) {
+        fflush(stdout);
+    }
+}
+
+// ------------ Wire and SPI --------------------------
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency) {
+    (void) sda;
+    (void) scl;
+    if (frequency > 0) {
+        clock_hz = frequency;
+    }
+    return true;
+}
+
+bool TwoWire::setClock(uint32_t frequency) {
+    clock_hz = frequency;
+    return true;
+}
+
+uint32_t TwoWire::getClock() {
+    return clock_hz;
+}
+
+void SPIClass::begin() {
+}
+
+uint8_t SPIClass::transfer(uint8_t data) {
+    (void) data;
+    return 0;
+}
+
+// ------------ Bluepad32 -----------------------------
+
+static Controller gamepad;
+static ControllerCallback on_connect = nullptr;
+static ControllerCallback on_disconnect = nullptr;
+
+static bool gamepad_connected = false;      // as Bluepad32 has told the firmware
+static bool connect_pending = false;
+static bool disconnect_pending = false;
+static bool packet_pending = false;
+static bool gamepad_has_data = false;
+static host_gamepad_t pending_packet;
+static host_gamepad_t current_packet;
+
+void host_gamepad_connect() {
+    connect_pending = true;
+    disconnect_pending = false;
+}
+
+void host_gamepad_disconnect() {
+    disconnect_pending = true;
+    connect_pending = false;
+    packet_pending = false;
+}
+
+void host_gamepad_send(const host_gamepad_t* packet) {
+    pending_packet = *packet;
+    packet_pending = true;
+}
+
+void Bluepad32::setup(const ControllerCallback& onConnect, const ControllerCallback& onDisconnect, bool startScanning) {
+    (void) startScanning;
+    on_connect = onConnect;
+    on_disconnect = onDisconnect;
+}
+
+bool Bluepad32::update() {
+    bool changed = false;
+
+    if (disconnect_pending) {
+        disconnect_pending = false;
+        if (gamepad_connected) {
+            gamepad_connected = false;
+            if (on_disconnect != nullptr) {
+                on_disconnect(&gamepad);
+            }
+            changed = true;
+        }
+    }
+
+    if (connect_pending) {
+        connect_pending = false;
+        if (!gamepad_connected) {
+            gamepad_connected = true;
+            current_packet = {};
+            if (on_connect != nullptr) {
+                on_connect(&gamepad);
+            }
+            changed = true;
+        }
+    }
+
+    gamepad_has_data = false;
+    if (packet_pending && gamepad_connected) {
+        packet_pending = false;
+        current_packet = pending_packet;
+        gamepad_has_data = true;
+        changed = true;
+    }
+
+    return changed;
+}
+
+void Bluepad32::enableNewBluetoothConnections(bool enabled) {
+    (void) enabled;
+}
+
+bool Controller::isConnected() const {
+    return gamepad_connected;
+}
+
+bool Controller::hasData() const {
+    return gamepad_has_data;
+}
+
+int32_t Controller::throttle() const {
+    return current_packet.throttle;
+}
+
+int32_t Controller::brake() const {
+    return 0;
+}
+
+int32_t Controller::axisX() const {
+    return current_packet.axis_x;
+}
+
+int32_t Controller::axisY() const {
+    return current_packet.axis_y;
+}
+
+int32_t Controller::axisRX() const {
+    return current_packet.axis_rx;
+}
+
+int32_t Controller::axisRY() const {
+    return current_packet.axis_ry;
+}
+
+uint16_t Controller::buttons() const {
+    return current_packet.buttons;
+}
+
+uint8_t Controller::dpad() const {
+    return current_packet.dpad;
+}
+
+// an Xbox Wireless Controller, which is what the firmware's written against
+ControllerProperties Controller::getProperties() const {
+    ControllerProperties properties;
+    properties.vendor_id = 0x045e;
+    properties.product_id = 0x0b13;
+    return properties;
+}
+
+String Controller::getModelName() const {
+    return "XBox Wireless (host)";
+}
@@ -0,0 +1,27 @@
+#ifndef _BENCH_h
+#define _BENCH_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+// Wall-clock timing for the benchmarks. Numbers are for this host, not the ESP32 - compare them with each other,
+// and against their baselines, rather than against the hot loop's budget
+
+static inline uint64_t bench_now_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+// Keeps the optimiser from throwing away work whose result nobody reads
+template <typename T>
+static inline void bench_keep(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+static inline void bench_report(const char* name, double ns_per_op, const char* unit = "op") {
+    printf("%-48s %10.1f ns/%s\n", name, ns_per_op, unit);
+}
+
+#endif
@@ -0,0 +1,106 @@
+#include "bench.h"
+#include "hal/hal.h"
+#include "lib/DShotRMT.h"
+
+// Encoding and sending one DShot frame, in each mode: DShotRMT's nibble templates, with the throttle changing every
+// frame and holding steady, against the bit-at-a-time encoder it used to have - the CRC worked out twice, and every
+// item rebuilt with a test per bit. Everything ends in the same hal_rmt_write(), so the differences are the encoding.
+
+#define BENCH_FRAMES 2000000
+
+static const dshot_mode_t modes[] = {DSHOT150, DSHOT300, DSHOT600, DSHOT1200};
+
+// The old encoder, as it was
+typedef struct bitwise_encoder_t {
+    uint16_t ticks_zero_high;
+    uint16_t ticks_zero_low;
+    uint16_t ticks_one_high;
+    uint16_t ticks_one_low;
+    rmt_item32_t items[DSHOT_PACKET_LENGTH];
+} bitwise_encoder_t;
+
+static uint16_t bitwise_crc(const dshot_packet_t& dshot_packet) {
+    const uint16_t packet = (dshot_packet.throttle_value << 1) | dshot_packet.telemetric_request;
+    return (packet ^ (packet >> 4) ^ (packet >> 8)) & 0x0F;
+}
+
+__attribute__((noinline)) static void bitwise_send(bitwise_encoder_t* encoder, uint16_t throttle_value) {
+    dshot_packet_t dshot_packet = {};
+    dshot_packet.throttle_value = throttle_value;
+    dshot_packet.telemetric_request = NO_TELEMETRIC;
+    dshot_packet.checksum = bitwise_crc(dshot_packet);
+
+    uint16_t parsed_packet = (dshot_packet.throttle_value << 1) | dshot_packet.telemetric_request;
+    parsed_packet = (parsed_packet << 4) | bitwise_crc(dshot_packet);
+
+    for (int i = 0; i < DSHOT_PAUSE_BIT; i++, parsed_packet <<= 1) {
+        if (parsed_packet & 0b1000000000000000) {
+            encoder->items[i].duration0 = encoder->ticks_one_high;
+            encoder->items[i].duration1 = encoder->ticks_one_low;
+        } else {
+            encoder->items[i].duration0 = encoder->ticks_zero_high;
+            encoder->items[i].duration1 = encoder->ticks_zero_low;
+        }
+        encoder->items[i].level0 = 1;
+        encoder->items[i].level1 = 0;
+    }
+
+    encoder->items[DSHOT_PAUSE_BIT].level0 = 0;
+    encoder->items[DSHOT_PAUSE_BIT].level1 = 1;
+    encoder->items[DSHOT_PAUSE_BIT].duration0 = 0;
+    encoder->items[DSHOT_PAUSE_BIT].duration1 = DSHOT_PAUSE;
+
+    hal_rmt_write(RMT_CHANNEL_2, encoder->items, DSHOT_PACKET_LENGTH);
+}
+
+// walks the throttle through its whole range, so every frame's different
+static inline uint16_t throttle_for(int frame) {
+    return DSHOT_THROTTLE_MIN + frame % (DSHOT_THROTTLE_MAX - DSHOT_THROTTLE_MIN + 1);
+}
+
+int main() {
+    printf("DShot frame encode and send, %d frames each\n", BENCH_FRAMES);
+
+    for (dshot_mode_t mode : modes) {
+        char name[64];
+        DShotRMT motor(GPIO_NUM_1, RMT_CHANNEL_1);
+        motor.begin(mode, false);
+
+        // the old encoder's timings are the same as the templates'
+        uint16_t ticks_per_bit = 64 >> (mode - DSHOT150);
+        bitwise_encoder_t encoder = {};
+        encoder.ticks_zero_high = ticks_per_bit * 3 / 8;
+        encoder.ticks_zero_low = ticks_per_bit - encoder.ticks_zero_high;
+        encoder.ticks_one_high = ticks_per_bit * 3 / 4;
+        encoder.ticks_one_low = ticks_per_bit - encoder.ticks_one_high;
+        rmt_config_t config = {};
+        config.channel = RMT_CHANNEL_2;
+        rmt_config(&config);
+        rmt_driver_install(RMT_CHANNEL_2, 0, 0);
+
+        uint64_t started_ns = bench_now_ns();
+        for (int i = 0; i < BENCH_FRAMES; i++) {
+            motor.sendThrottleValue(throttle_for(i));
+        }
+        snprintf(name, sizeof(name), "%s nibble templates", dshot_mode_name[mode]);
+        bench_report(name, (double) (bench_now_ns() - started_ns) / BENCH_FRAMES, "frame");
+
+        started_ns = bench_now_ns();
+        for (int i = 0; i < BENCH_FRAMES; i++) {
+            motor.sendThrottleValue(1000);
+        }
+        snprintf(name, sizeof(name), "%s nibble templates, throttle unchanged", dshot_mode_name[mode]);
+        bench_report(name, (double) (bench_now_ns() - started_ns) / BENCH_FRAMES, "frame");
+
+        started_ns = bench_now_ns();
+        for (int i = 0; i < BENCH_FRAMES; i++) {
+            bitwise_send(&encoder, throttle_for(i));
+        }
+        snprintf(name, sizeof(name), "%s bit at a time (old)", dshot_mode_name[mode]);
+        bench_report(name, (double) (bench_now_ns() - started_ns) / BENCH_FRAMES, "frame");
+
+        rmt_driver_uninstall(RMT_CHANNEL_2);
+    }
+
+    return 0;
+}
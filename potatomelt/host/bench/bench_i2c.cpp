@@ -0,0 +1,75 @@
+#include <Wire.h>
+#include "bench.h"
+#include "host.h"
+#include "lis331_model.h"
+#include "hal/hal.h"
+#include "lib/SparkFun_LIS331_ESP32.h"
+#include "subsystems/accelerometer.h"
+
+// The I2C bus time behind one RPM sample - both accelerometers read, as IMU::take_sample() does - with the six output
+// registers read in one burst, against the byte-at-a-time reads the SparkFun driver used to make.
+// Bus time is what the transactions would take on the wire, as the host's I2C counts it; it's the same on the robot,
+// less the driver's own overhead. Host time is only there to show the driver isn't costing anything on top.
+
+#define BENCH_SAMPLES 100000
+
+static host_lis331_t lis_models[2];
+static Accelerometer accels[2];
+static LIS331ESP raw[2];
+
+static void burst_sample() {
+    for (int i = 0; i < 2; i++) {
+        float xy_g;
+        float z_g;
+        bench_keep(accels[i].get_accel(&xy_g, &z_g));
+        bench_keep(xy_g);
+        bench_keep(z_g);
+    }
+}
+
+static void bytewise_sample() {
+    for (int i = 0; i < 2; i++) {
+        uint8_t data[6];
+        for (int reg = 0; reg < 6; reg++) {
+            data[reg] = raw[i].readReg(OUT_X_L + reg);
+        }
+        bench_keep(data);
+    }
+}
+
+static void report(const char* name, void (*sample)()) {
+    hal_i2c_reset_stats();
+    uint64_t started_ns = bench_now_ns();
+
+    for (int i = 0; i < BENCH_SAMPLES; i++) {
+        sample();
+    }
+
+    double host_ns = (double) (bench_now_ns() - started_ns) / BENCH_SAMPLES;
+    hal_i2c_stats_t stats;
+    hal_i2c_get_stats(&stats);
+
+    printf("%-32s %6.1f transactions %8.1f bus us %8.1f ns host, per RPM sample\n", name,
+        (double) stats.transactions / BENCH_SAMPLES, (double) stats.busy_us / BENCH_SAMPLES, host_ns);
+}
+
+int main() {
+    for (int i = 0; i < 2; i++) {
+        host_lis331_attach(&lis_models[i], 0x18 + i);
+        host_lis331_set_accel(&lis_models[i], 129, 0, 1);
+        accels[i].init(0x18 + i);
+
+        raw[i].setI2CAddr(0x18 + i);
+        raw[i].begin(LIS331ESP::USE_I2C);
+    }
+
+    uint32_t clocks[] = {100000, 400000};
+    for (uint32_t clock : clocks) {
+        Wire.setClock(clock);
+        printf("I2C at %lu kHz, both accelerometers:\n", (unsigned long) (clock / 1000));
+        report("  burst read (readAxes)", burst_sample);
+        report("  a transaction per byte", bytewise_sample);
+    }
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include "bench.h"
+#include "host.h"
+#include "hal/hal.h"
+#include "melty_config.h"
+#include "robot.h"
+
+// The heading beacon while spinning: how many RMT writes the LEDs cost in one simulated second at 3000 RPM, and the host
+// time per hot loop tick. LED, which only sends a color when it changes, against the old path - a bit at a time encode
+// and an RMT write every tick, whatever was already showing.
+// The ticks run as Robot::spin() drives the LEDs: the phase advances a hot loop period each tick, and the beacon's on
+// across the same 15% of the rotation bench_update_loop uses.
+
+#define BENCH_RPM 3000
+#define BENCH_SECONDS 100
+
+// The old path, as it was
+static rmt_item32_t led_data[NEOPIXEL_COUNT * 24];
+
+__attribute__((noinline)) static void write_pixel_per_bit(int red, int green, int blue) {
+    uint8_t pixel_color[3] = { (uint8_t) green, (uint8_t) red, (uint8_t) blue };
+    int index = 0;
+    for (int pixel = 0; pixel < NEOPIXEL_COUNT; pixel++) {
+        for (auto chan : pixel_color) {
+            for (int bit = 7; bit >= 0; bit--) {
+                if ((chan >> bit) & 1) {
+                    led_data[index].level0 = 1;
+                    led_data[index].duration0 = 8;
+                    led_data[index].level1 = 0;
+                    led_data[index].duration1 = 4;
+                } else {
+                    led_data[index].level0 = 1;
+                    led_data[index].duration0 = 4;
+                    led_data[index].level1 = 0;
+                    led_data[index].duration1 = 8;
+                }
+                index++;
+            }
+        }
+    }
+    hal_rmt_write(NEOPIXEL_RMT, led_data, NEOPIXEL_COUNT * 24);
+}
+
+static LED* leds;
+
+// a full battery's beacon, or off - the same calls Robot::spin() makes
+static void show_new(bool beacon) {
+    if (beacon) {
+        leds->leds_on_gradient(100);
+    } else {
+        leds->leds_off();
+    }
+}
+
+static void show_old(bool beacon) {
+    if (beacon) {
+        write_pixel_per_bit(0, 255, 0);
+    } else {
+        write_pixel_per_bit(0, 0, 0);
+    }
+}
+
+// Runs seconds' worth of hot loop ticks through show(), and reports the RMT writes per simulated second
+static void run(const char* name, void (*show)(bool beacon), int seconds) {
+    uint32_t phase_rate = (uint32_t) (BENCH_RPM * PHASE_PER_ROTATION / (60.0 * 1000 * 1000));
+    uint32_t led_start = (uint32_t) (0.40 * PHASE_PER_ROTATION);
+    uint32_t led_stop = (uint32_t) (0.55 * PHASE_PER_ROTATION);
+    uint32_t phase = 0;
+    int ticks = seconds * HOTLOOP_FREQ_HZ;
+
+    uint32_t writes = host_rmt_write_count(NEOPIXEL_RMT);
+    uint64_t started_ns = bench_now_ns();
+
+    for (int i = 0; i < ticks; i++) {
+        phase += phase_rate * (1000000 / HOTLOOP_FREQ_HZ);
+        show(phase - led_start <= led_stop - led_start);
+    }
+
+    uint64_t elapsed_ns = bench_now_ns() - started_ns;
+    writes = host_rmt_write_count(NEOPIXEL_RMT) - writes;
+
+    bench_report(name, (double) elapsed_ns / ticks, "tick");
+    printf("%-48s %10.1f RMT writes/s\n", name, (double) writes / seconds);
+}
+
+int main() {
+    LED led;
+    leds = &led;
+
+    printf("LEDs at %d RPM, %d ticks/s, %d pixels, over %d simulated seconds\n", BENCH_RPM, HOTLOOP_FREQ_HZ, NEOPIXEL_COUNT, BENCH_SECONDS);
+
+    run("LED, on change", show_new, BENCH_SECONDS);
+    run("write_pixel() every tick (old)", show_old, BENCH_SECONDS);
+
+    return 0;
+}
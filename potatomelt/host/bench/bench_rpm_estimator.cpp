@@ -0,0 +1,47 @@
+#include <math.h>
+#include "bench.h"
+#include "melty_config.h"
+#include "subsystems/rpm_estimator.h"
+
+// What an RPM sample costs: the accelerometer RPM on its own - sqrt(g * 89445 / r), times the correction - as
+// IMU::get_rpm() used to hand it out, against that plus a full step of the estimator, as IMU::update_estimate() runs it
+
+#define BENCH_SAMPLES 10000000
+#define SAMPLE_DT_S (1.0f / ACCELEROMETER_SAMPLE_RATE_HZ)
+
+__attribute__((noinline)) static float accel_rpm(float avg_g, float radius_cm, float correction) {
+    return sqrt(fabs(avg_g) * 89445.0f / radius_cm) * correction;
+}
+
+__attribute__((noinline)) static float fused_rpm(RPMEstimator* estimator, float avg_g, float radius_cm, float correction,
+        float motor_rpm, int throttle) {
+    estimator->predict(SAMPLE_DT_S);
+    estimator->update_accel_rpm(accel_rpm(avg_g, radius_cm, correction), false);
+    estimator->update_motor_rpm(motor_rpm);
+    estimator->update_throttle(throttle);
+
+    rpm_estimate_t estimate;
+    estimator->get_estimate(&estimate);
+    return estimate.rpm;
+}
+
+int main() {
+    printf("RPM per accelerometer sample, %d samples each\n", BENCH_SAMPLES);
+
+    // about 1500 RPM on the beetle, with a little wobble so nothing's constant
+    const float radius_cm = BEETLE_ACCELEROMETER_RADIUS_CM;
+    uint64_t started_ns = bench_now_ns();
+    for (int i = 0; i < BENCH_SAMPLES; i++) {
+        bench_keep(accel_rpm(129.0f + (i & 7) * 0.1f, radius_cm, 1.0f));
+    }
+    bench_report("accelerometer RPM (old)", (double) (bench_now_ns() - started_ns) / BENCH_SAMPLES, "sample");
+
+    RPMEstimator estimator;
+    started_ns = bench_now_ns();
+    for (int i = 0; i < BENCH_SAMPLES; i++) {
+        bench_keep(fused_rpm(&estimator, 129.0f + (i & 7) * 0.1f, radius_cm, 1.0f, 1500.0f + (i & 15), 430));
+    }
+    bench_report("fused estimate, with ESC telemetry", (double) (bench_now_ns() - started_ns) / BENCH_SAMPLES, "sample");
+
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include <math.h>
+#include "bench.h"
+#include "hal/hal.h"
+#include "sine_table.h"
+
+// The translation throttle offset, once per hot loop tick: sine_scale() off the fixed point table, against the float
+// path Robot::spin() used before it - a long modulo into the half rotation, a float parabola for the sine, and a double
+// offset, with a branch to pick which motor pushes.
+
+#define BENCH_TICKS 10000000
+#define TICK_US 250
+
+// The old path, as it was: time into the rotation, in microseconds, with two half-rotation windows
+typedef struct float_spin_params_t {
+    long rotation_interval_us;
+    long motor_start_phase_1;
+    long motor_start_phase_2;
+    int max_throttle_offset;
+    int throttle_perk;
+} float_spin_params_t;
+
+__attribute__((noinline)) static int float_offset(long time_spent_this_rotation_us, const float_spin_params_t* params) {
+    long micros_into_phase = time_spent_this_rotation_us % (params->rotation_interval_us / 2);
+    float phase_progress = 2.0 * micros_into_phase / (params->rotation_interval_us);
+    float phase_offset_fraction = -4 * phase_progress * (phase_progress - 1);
+    double throttle_offset = (double) (phase_offset_fraction * params->max_throttle_offset);
+
+    if (time_spent_this_rotation_us >= params->motor_start_phase_1 && time_spent_this_rotation_us <= params->motor_start_phase_2) {
+        return params->throttle_perk + throttle_offset;
+    }
+    return params->throttle_perk - throttle_offset;
+}
+
+__attribute__((noinline)) static int table_offset(uint32_t phase, uint32_t translate_phase, int throttle, float translate_fraction) {
+    int max_throttle_offset = (int) (throttle * translate_fraction);
+    return throttle + sine_scale(phase - translate_phase, max_throttle_offset);
+}
+
+static void report(const char* name, uint64_t ns) {
+    double ns_per_tick = (double) ns / BENCH_TICKS;
+    printf("%-48s %10.1f ns/tick %8.1f cycles/tick\n", name, ns_per_tick, ns_per_tick * hal_cycles_per_us() / 1000);
+}
+
+int main() {
+    // 1500 RPM
+    float_spin_params_t params;
+    params.rotation_interval_us = 40000;
+    params.motor_start_phase_1 = 0;
+    params.motor_start_phase_2 = params.rotation_interval_us / 2;
+    params.max_throttle_offset = 150;
+    params.throttle_perk = 300;
+
+    uint32_t phase_rate = (uint32_t) (1500 * 4294967296.0 / (60.0 * 1000 * 1000));
+    printf("Translation throttle offset, %d ticks each\n", BENCH_TICKS);
+
+    // the old path - time into the rotation, wrapped as Robot::spin() used to
+    uint64_t started_ns = bench_now_ns();
+    long time_spent = 0;
+    for (int i = 0; i < BENCH_TICKS; i++) {
+        time_spent += TICK_US;
+        if (time_spent > params.rotation_interval_us) {
+            time_spent -= params.rotation_interval_us;
+        }
+        bench_keep(float_offset(time_spent, &params));
+    }
+    report("float parabola, long modulo (old)", bench_now_ns() - started_ns);
+
+    // the table - phase wraps for free
+    started_ns = bench_now_ns();
+    uint32_t phase = 0;
+    for (int i = 0; i < BENCH_TICKS; i++) {
+        phase += phase_rate * TICK_US;
+        bench_keep(table_offset(phase, 0, params.throttle_perk, 0.5f));
+    }
+    report("sine_scale() table lookup", bench_now_ns() - started_ns);
+
+    // and what the loop around them costs
+    started_ns = bench_now_ns();
+    phase = 0;
+    for (int i = 0; i < BENCH_TICKS; i++) {
+        phase += phase_rate * TICK_US;
+        bench_keep(phase);
+    }
+    report("(loop overhead)", bench_now_ns() - started_ns);
+
+    return 0;
+}
@@ -0,0 +1,249 @@
+#include <math.h>
+#include <random>
+#include "bench.h"
+#include "melty_config.h"
+#include "subsystems/rpm_estimator.h"
+#include "subsystems/spin_controller.h"
+
+// Step response of the RPM control loop: the SpinController, run at the sensor rate as its task runs it, against the
+// PID_v1 setup it replaced - Arduino PID_v1's algorithm, at the library's default 100ms sample time, called from
+// loop()'s 10ms control tick, with the same default gains and no feed-forward.
+// Both chase the same simulated robot: a first-order spin on the throttle, behind a few ms of ESC lag, with noisy
+// accelerometers that pin at 400g, fed through the RPM estimator just as IMU::update_estimate() feeds it.
+// The robot's a little weaker and slower than the firmware's spin model thinks - as real ones are.
+
+#define SIM_STEP_US 250
+#define SAMPLE_US (1000000 / ACCELEROMETER_SAMPLE_RATE_HZ)
+#define CONTROL_TICK_US (CONTROL_LOOP_INTERVAL_MS * 1000)
+#define SEGMENT_S 4.0f
+
+#define ROBOT_RPM_PER_THROTTLE (SPIN_MODEL_RPM_PER_THROTTLE * 0.9f)
+#define ROBOT_TIME_CONSTANT_S (SPIN_MODEL_TIME_CONSTANT_S * 1.2f)
+#define ROBOT_ESC_LAG_S 0.004f
+#define ACCEL_NOISE_RPM 10.0f
+#define ACCEL_SATURATED_RPM 2640.0f
+
+// Arduino PID_v1 (Brett Beauregard), as we used it: proportional on error, DIRECT, output 0-1023, and re-initialised
+// from the current output each time it's switched to AUTOMATIC
+class PIDv1 {
+    public:
+        PIDv1(double kp, double ki, double kd) {
+            sample_time_ms = 100;
+            this->kp = kp;
+            this->ki = ki * sample_time_ms / 1000.0;
+            this->kd = kd / (sample_time_ms / 1000.0);
+            out_min = 0;
+            out_max = 1023;
+        }
+
+        void set_automatic(double input, double output) {
+            output_sum = fmin(fmax(output, out_min), out_max);
+            last_input = input;
+            last_time_ms = -sample_time_ms;
+        }
+
+        // only does anything once sample_time_ms has passed since it last did
+        bool compute(long now_ms, double input, double setpoint, double* output) {
+            if (now_ms - last_time_ms < sample_time_ms) {
+                return false;
+            }
+
+            double error = setpoint - input;
+            double d_input = input - last_input;
+            output_sum = fmin(fmax(output_sum + ki * error, out_min), out_max);
+
+            *output = fmin(fmax(kp * error + output_sum - kd * d_input, out_min), out_max);
+            last_input = input;
+            last_time_ms = now_ms;
+            return true;
+        }
+
+    private:
+        long sample_time_ms;
+        double kp;
+        double ki;
+        double kd;
+        double out_min;
+        double out_max;
+        double output_sum;
+        double last_input;
+        long last_time_ms;
+};
+
+struct robot_t {
+    float rpm;
+    float applied_throttle;     // what the ESCs are actually doing, behind the commanded throttle
+    RPMEstimator estimator;
+    std::mt19937 random_engine;
+};
+
+struct step_result_t {
+    float rise_s;               // 10% - 90% of the step
+    float settle_s;             // until it's within 5% for good
+    float overshoot_percent;
+    float steady_error_percent; // over the last second
+};
+
+// One control loop, at whatever rate it runs
+class Loop {
+    public:
+        virtual ~Loop() {}
+        virtual void start(robot_t* robot, float target_rpm) = 0;
+        virtual int step(unsigned long now_us, robot_t* robot, rpm_estimate_t* estimate, float target_rpm) = 0;
+};
+
+class SpinControllerLoop : public Loop {
+    public:
+        SpinControllerLoop() {
+            gains.kp = PID_KP;
+            gains.ki = PID_KI;
+            gains.kd = PID_KD;
+        }
+
+        // spinning up from a standstill follows a spell with spinning off, which resets it - but keeps what it's learned
+        void start(robot_t* robot, float) override {
+            if (robot->rpm == 0) {
+                controller.reset();
+            }
+        }
+
+        // runs on every RPM estimate
+        int step(unsigned long now_us, robot_t*, rpm_estimate_t* estimate, float target_rpm) override {
+            if (now_us % SAMPLE_US == 0) {
+                float output = controller.update(&gains, target_rpm, estimate, SAMPLE_US / 1000000.0f);
+                controller.learn(target_rpm, estimate, output, SAMPLE_US / 1000000.0f);
+                throttle = (int) output;
+            }
+            return throttle;
+        }
+
+    private:
+        SpinController controller;
+        spin_pid_gains_t gains;
+        int throttle = 0;
+};
+
+class PIDv1Loop : public Loop {
+    public:
+        PIDv1Loop() : pid(PID_KP, PID_KI, PID_KD) {
+        }
+
+        // spinning up from a standstill switched it to AUTOMATIC, starting from nothing
+        void start(robot_t* robot, float) override {
+            if (robot->rpm == 0) {
+                output = 0;
+                pid.set_automatic(0, output);
+            }
+        }
+
+        // runs on loop()'s control tick, reading the estimate as it was then
+        int step(unsigned long now_us, robot_t*, rpm_estimate_t* estimate, float target_rpm) override {
+            if (now_us % CONTROL_TICK_US == 0) {
+                pid.compute(now_us / 1000, estimate->rpm, target_rpm, &output);
+            }
+            return (int) output;
+        }
+
+    private:
+        PIDv1 pid;
+        double output = 0;
+};
+
+static step_result_t run_step(Loop* loop, robot_t* robot, unsigned long* now_us, float target_rpm) {
+    std::normal_distribution<float> accel_noise(0, ACCEL_NOISE_RPM);
+    float from_rpm = robot->rpm;
+    float step = target_rpm - from_rpm;
+    float esc_alpha = 1 - expf(-SIM_STEP_US / 1000000.0f / ROBOT_ESC_LAG_S);
+
+    step_result_t result = {};
+    result.rise_s = NAN;
+    float reached_10_s = NAN;
+    float last_outside_s = 0;
+    float peak = 0;
+    double steady_error_sum = 0;
+    int steady_samples = 0;
+    rpm_estimate_t estimate = {};
+    int throttle = 0;
+
+    loop->start(robot, target_rpm);
+
+    for (float t = 0; t < SEGMENT_S; t += SIM_STEP_US / 1000000.0f, *now_us += SIM_STEP_US) {
+        // the sampler's tick: a new estimate
+        if (*now_us % SAMPLE_US == 0) {
+            bool saturated = robot->rpm >= ACCEL_SATURATED_RPM;
+            float accel_rpm = fminf(robot->rpm, ACCEL_SATURATED_RPM) + accel_noise(robot->random_engine);
+            robot->estimator.predict(SAMPLE_US / 1000000.0f);
+            robot->estimator.update_accel_rpm(accel_rpm, saturated);
+            robot->estimator.update_throttle(throttle);
+            robot->estimator.get_estimate(&estimate);
+        }
+
+        throttle = constrain(loop->step(*now_us, robot, &estimate, target_rpm), 0, 1000);
+
+        robot->applied_throttle += esc_alpha * (throttle - robot->applied_throttle);
+        robot->rpm += (robot->applied_throttle * ROBOT_RPM_PER_THROTTLE - robot->rpm) / ROBOT_TIME_CONSTANT_S * SIM_STEP_US / 1000000.0f;
+        robot->rpm = fmaxf(robot->rpm, 0);
+
+        // how it's doing, measured by the true RPM
+        float progress = (robot->rpm - from_rpm) / step;
+        if (isnan(reached_10_s) && progress >= 0.1f) {
+            reached_10_s = t;
+        }
+        if (isnan(result.rise_s) && progress >= 0.9f) {
+            result.rise_s = t - reached_10_s;
+        }
+        peak = fmaxf(peak, progress);
+        if (fabsf(robot->rpm - target_rpm) > target_rpm * 0.05f) {
+            last_outside_s = t;
+        }
+        if (t >= SEGMENT_S - 1.0f) {
+            steady_error_sum += (robot->rpm - target_rpm) / target_rpm * 100;
+            steady_samples++;
+        }
+    }
+
+    result.settle_s = (last_outside_s >= SEGMENT_S - 1.0f) ? NAN : last_outside_s;
+    result.overshoot_percent = fmaxf(0, (peak - 1) * fabsf(step) / target_rpm * 100);
+    result.steady_error_percent = steady_error_sum / steady_samples;
+    return result;
+}
+
+static void print_result(const char* name, const char* step, step_result_t* result) {
+    char rise[16];
+    char settle[16];
+    snprintf(rise, sizeof(rise), isnan(result->rise_s) ? "-" : "%.2f s", result->rise_s);
+    snprintf(settle, sizeof(settle), isnan(result->settle_s) ? "never" : "%.2f s", result->settle_s);
+    printf("%-28s %-14s %9s %9s %8.1f%% %8.1f%%\n", name, step, rise, settle, result->overshoot_percent, result->steady_error_percent);
+}
+
+static void run_sequence(const char* name, Loop* loop) {
+    const float targets[] = {1200, 1800, 1200, 2400};
+    robot_t robot = {};
+    robot.random_engine.seed(1);
+    unsigned long now_us = 0;
+    float from = 0;
+
+    for (float target : targets) {
+        char step[32];
+        snprintf(step, sizeof(step), "%.0f -> %.0f", from, target);
+        step_result_t result = run_step(loop, &robot, &now_us, target);
+        print_result(name, step, &result);
+        from = target;
+    }
+}
+
+int main() {
+    printf("RPM step response, %.0f s per step. Robot: %.2f RPM per throttle, %.2f s time constant, %.0f ms ESC lag\n\n",
+        SEGMENT_S, ROBOT_RPM_PER_THROTTLE, ROBOT_TIME_CONSTANT_S, ROBOT_ESC_LAG_S * 1000);
+    printf("%-28s %-14s %9s %9s %9s %9s\n", "", "step", "rise", "settled", "overshoot", "steady");
+
+    PIDv1Loop pid_v1;
+    run_sequence("PID_v1, 100ms (old)", &pid_v1);
+
+    // the same controller twice: the second time round, it's learned its feed-forward
+    SpinControllerLoop spin_controller;
+    run_sequence("SpinController", &spin_controller);
+    run_sequence("SpinController, learned", &spin_controller);
+
+    return 0;
+}
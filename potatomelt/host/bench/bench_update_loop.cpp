@@ -0,0 +1,97 @@
+#include "bench.h"
+#include "host.h"
+#include "flight_recorder.h"
+#include "lis331_model.h"
+#include "robot.h"
+#include "melty_config.h"
+#include "subsystems/storage.h"
+
+// Times one hot loop tick - Robot::update_loop() - in each state it runs in
+// The robot's own tasks get a moment to start up and get the spin controller going first, then the ticks run back to
+// back, with the virtual clock moving a hot loop period between each. The clock's cost is timed on its own, and taken off.
+// Spinning gets timed again writing a flight record each tick, as the hot loop does - the difference is what recording costs.
+
+#define BENCH_TICKS 200000
+
+Storage store;
+Robot robot;
+FlightRecorder flight_recorder;
+
+static host_lis331_t lis1;
+static host_lis331_t lis2;
+
+static void discard_serial(void*, const uint8_t*, size_t) {
+}
+
+static double time_ticks(robot_status state, spin_control_parameters_t* spin, tank_control_parameters_t* tank, bool run_loop,
+    bool record = false) {
+    uint64_t started_ns = bench_now_ns();
+
+    for (int i = 0; i < BENCH_TICKS; i++) {
+        if (run_loop) {
+            robot.update_loop(state, spin, tank);
+        }
+        if (record) {
+            // as hotloopFN() writes it down
+            flight_record_t* record = flight_recorder.next();
+            if (record != nullptr) {
+                record->timestamp_us = i;
+                record->lateness_us = 0;
+                robot.fill_flight_record(record);
+                flight_recorder.commit();
+            }
+        }
+        host_advance_us(1000000 / HOTLOOP_FREQ_HZ);
+    }
+
+    return (double) (bench_now_ns() - started_ns) / BENCH_TICKS;
+}
+
+int main() {
+    host_serial_set_output(discard_serial, nullptr);
+
+    // spinning at about 1500 RPM, on a full battery
+    host_lis331_attach(&lis1, 0x18);
+    host_lis331_attach(&lis2, 0x19);
+    host_lis331_set_accel(&lis1, 129, 0, 1);
+    host_lis331_set_accel(&lis2, 129, 0, 1);
+    host_adc_set_millivolts(BATTERY_ADC_PIN, (uint32_t) (4 * 4.2 / BATTERY_VOLTAGE_DIVIDER * 1000));
+
+    store.init();
+    robot.init();
+    flight_recorder.init();
+
+    // give the sampler and spin controller a moment, so the spinning ticks have a throttle to work with
+    robot.set_spin_target(true, 1500);
+    host_run_for_us(200000);
+
+    spin_control_parameters_t spin = {};
+    spin.phase_rate = (uint32_t) (1500 * PHASE_PER_ROTATION / (60.0 * 1000 * 1000));
+    spin.led_start = (uint32_t) (0.40 * PHASE_PER_ROTATION);
+    spin.led_stop = (uint32_t) (0.55 * PHASE_PER_ROTATION);
+    spin.translate_phase = 0;
+    spin.translate_fraction = 0.5f;
+    spin.battery_percent = 100;
+
+    tank_control_parameters_t tank = {};
+    tank.translate_forback = 300;
+    tank.turn_lr = 100;
+    tank.forback_power_scale = TANK_FORBACK_POWER_SCALE;
+    tank.turning_power_scale = TANK_TURNING_POWER_SCALE;
+
+    printf("Robot::update_loop(), %d ticks each, host time with the virtual clock's overhead taken off\n", BENCH_TICKS);
+
+    time_ticks(SPINNING, &spin, &tank, true);
+    double clock_ns = time_ticks(SPINNING, &spin, &tank, false);
+
+    double spinning_ns = time_ticks(SPINNING, &spin, &tank, true) - clock_ns;
+    double recording_ns = time_ticks(SPINNING, &spin, &tank, true, true) - clock_ns;
+    bench_report("update_loop SPINNING", spinning_ns, "tick");
+    bench_report("update_loop SPINNING + flight record", recording_ns, "tick");
+    bench_report("(flight record, per tick)", recording_ns - spinning_ns, "tick");
+    bench_report("update_loop READY (tank drive)", time_ticks(READY, &spin, &tank, true) - clock_ns, "tick");
+    bench_report("update_loop NO_CONTROLLER", time_ticks(NO_CONTROLLER, &spin, &tank, true) - clock_ns, "tick");
+    bench_report("(virtual clock, per tick)", clock_ns, "tick");
+
+    return 0;
+}
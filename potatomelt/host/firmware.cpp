@@ -0,0 +1,17 @@
+// The sketch itself, built for the host
+// The Arduino builder puts Arduino.h in front of the sketch for us - here we have to do it ourselves
+#include <Arduino.h>
+#include "../potatomelt.ino"
+#include "host.h"
+
+// Arduino-ESP32's main: one task on core 1, running setup() and then loop() forever
+static void loop_task(void*) {
+    setup();
+    while (true) {
+        loop();
+    }
+}
+
+void host_start_firmware() {
+    xTaskCreatePinnedToCore(loop_task, "loopTask", 8192, NULL, 1, NULL, 1);
+}
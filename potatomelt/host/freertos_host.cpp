@@ -0,0 +1,442 @@
+// glibc's fortified longjmp refuses to jump between stacks, which is the whole point here
+#undef _FORTIFY_SOURCE
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ucontext.h>
+#include <vector>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_timer.h>
+#include "host.h"
+
+// FreeRTOS and esp_timer for the host, on a virtual clock
+// Every task gets its own stack, and runs until it blocks - then the scheduler picks the highest priority task that's
+// ready (round robin among equals), or if there isn't one, jumps the clock to the next timer or timeout.
+// Both cores share the one host thread, so a task on core 0 and a task on core 1 take turns rather than overlapping.
+
+// host code leans on the stack harder than the ESP32 build does (glibc's printf, for one), so don't go by the requested depth
+#define HOST_TASK_STACK_BYTES (256 * 1024)
+#define NEVER UINT64_MAX
+
+struct tskTaskControlBlock {
+    const char* name;
+    TaskFunction_t function;
+    void* parameter;
+    UBaseType_t priority;
+    BaseType_t core;
+    char* stack;
+    ucontext_t start_context;       // where it starts from, the first time it runs
+    jmp_buf context;                // where it picks up from, every time after that
+    bool started;
+    bool deleted;
+    bool blocked;
+    bool waiting_for_notification;
+    uint64_t wake_at_us;            // when a blocked task times out, or NEVER
+    uint32_t notifications;
+    uint64_t last_ran;              // for round robin - whoever's waited longest goes first
+};
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void* arg;
+    uint64_t period_us;             // 0 for a one-shot
+    uint64_t expires_at_us;
+    bool armed;
+};
+
+static uint64_t now_us = 0;
+static std::vector<TaskHandle_t> tasks;
+static std::vector<esp_timer_handle_t> timers;
+static TaskHandle_t current_task = nullptr;
+static jmp_buf scheduler_context;
+static bool in_timer_callback = false;
+static uint64_t task_switches = 0;
+static uint64_t timer_callbacks = 0;
+
+static void fail(const char* message) {
+    fprintf(stderr, "host FreeRTOS: %s\n", message);
+    abort();
+}
+
+// ------------ The clock ------------------------------
+
+uint64_t host_now_us() {
+    return now_us;
+}
+
+static uint64_t next_event_us() {
+    uint64_t next = NEVER;
+
+    for (esp_timer_handle_t timer : timers) {
+        if (timer->armed && timer->expires_at_us < next) {
+            next = timer->expires_at_us;
+        }
+    }
+
+    for (TaskHandle_t task : tasks) {
+        if (!task->deleted && task->blocked && task->wake_at_us < next) {
+            next = task->wake_at_us;
+        }
+    }
+
+    return next;
+}
+
+static void wake(TaskHandle_t task) {
+    task->blocked = false;
+    task->waiting_for_notification = false;
+    task->wake_at_us = NEVER;
+}
+
+// Fires everything that's due at or before now - timers in expiry order, each as many times as it's due
+static void fire_due_events() {
+    for (TaskHandle_t task : tasks) {
+        if (!task->deleted && task->blocked && task->wake_at_us <= now_us) {
+            wake(task);
+        }
+    }
+
+    while (true) {
+        esp_timer_handle_t due = nullptr;
+        for (esp_timer_handle_t timer : timers) {
+            if (timer->armed && timer->expires_at_us <= now_us && (due == nullptr || timer->expires_at_us < due->expires_at_us)) {
+                due = timer;
+            }
+        }
+        if (due == nullptr) {
+            return;
+        }
+
+        if (due->period_us > 0) {
+            due->expires_at_us += due->period_us;
+        } else {
+            due->armed = false;
+        }
+
+        // callbacks run in the esp_timer task, not whichever task happened to move the clock
+        TaskHandle_t interrupted = current_task;
+        current_task = nullptr;
+        in_timer_callback = true;
+        due->callback(due->arg);
+        in_timer_callback = false;
+        current_task = interrupted;
+        timer_callbacks++;
+    }
+}
+
+static void advance_to(uint64_t target_us) {
+    while (true) {
+        uint64_t next = next_event_us();
+        if (next > target_us) {
+            break;
+        }
+        if (next > now_us) {
+            now_us = next;
+        }
+        fire_due_events();
+    }
+    now_us = target_us;
+}
+
+void host_advance_us(uint64_t us) {
+    advance_to(now_us + us);
+}
+
+uint64_t host_task_switches() {
+    return task_switches;
+}
+
+uint64_t host_timer_callbacks() {
+    return timer_callbacks;
+}
+
+// ------------ The scheduler --------------------------
+
+static TaskHandle_t pick_ready_task() {
+    TaskHandle_t best = nullptr;
+
+    for (TaskHandle_t task : tasks) {
+        if (task->deleted || task->blocked) {
+            continue;
+        }
+        if (best == nullptr || task->priority > best->priority || (task->priority == best->priority && task->last_ran < best->last_ran)) {
+            best = task;
+        }
+    }
+
+    return best;
+}
+
+static void task_entry() {
+    TaskHandle_t task = current_task;
+    task->function(task->parameter);
+
+    // a FreeRTOS task that returns would take the ESP32 down - here it just stops
+    task->deleted = true;
+    _longjmp(scheduler_context, 1);
+}
+
+static void switch_to(TaskHandle_t task) {
+    current_task = task;
+    task->last_ran = ++task_switches;
+
+    if (_setjmp(scheduler_context) == 0) {
+        if (!task->started) {
+            task->started = true;
+            setcontext(&task->start_context);
+        }
+        _longjmp(task->context, 1);
+    }
+
+    current_task = nullptr;
+}
+
+// Hands the CPU back to the scheduler. Returns once the scheduler picks this task again
+static void suspend_current() {
+    if (_setjmp(current_task->context) == 0) {
+        _longjmp(scheduler_context, 1);
+    }
+}
+
+// Lets task run straight away if it outranks whoever's running - as it would on the ESP32
+static void preempt_for(TaskHandle_t task) {
+    if (current_task != nullptr && !in_timer_callback && task->priority > current_task->priority) {
+        suspend_current();
+    }
+}
+
+void host_run_for_us(uint64_t us) {
+    if (current_task != nullptr || in_timer_callback) {
+        fail("host_run_for_us() can't be called from a task");
+    }
+
+    uint64_t end_us = now_us + us;
+
+    while (true) {
+        TaskHandle_t next = pick_ready_task();
+        if (next != nullptr) {
+            switch_to(next);
+            continue;
+        }
+
+        uint64_t next_event = next_event_us();
+        if (next_event > end_us) {
+            break;
+        }
+        if (next_event > now_us) {
+            now_us = next_event;
+        }
+        fire_due_events();
+    }
+
+    now_us = end_us;
+}
+
+// ------------ Tasks ----------------------------------
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pvTaskCode, const char* pcName, uint32_t usStackDepth, void* pvParameters,
+    UBaseType_t uxPriority, TaskHandle_t* pvCreatedTask, BaseType_t xCoreID) {
+    (void) usStackDepth;
+
+    TaskHandle_t task = new tskTaskControlBlock();
+    task->name = pcName;
+    task->function = pvTaskCode;
+    task->parameter = pvParameters;
+    task->priority = uxPriority;
+    task->core = xCoreID;
+    task->stack = (char*) malloc(HOST_TASK_STACK_BYTES);
+    task->wake_at_us = NEVER;
+
+    getcontext(&task->start_context);
+    task->start_context.uc_stack.ss_sp = task->stack;
+    task->start_context.uc_stack.ss_size = HOST_TASK_STACK_BYTES;
+    task->start_context.uc_link = nullptr;
+    makecontext(&task->start_context, task_entry, 0);
+
+    tasks.push_back(task);
+    if (pvCreatedTask != nullptr) {
+        *pvCreatedTask = task;
+    }
+
+    preempt_for(task);
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t pvTaskCode, const char* pcName, uint32_t usStackDepth, void* pvParameters,
+    UBaseType_t uxPriority, TaskHandle_t* pvCreatedTask) {
+    return xTaskCreatePinnedToCore(pvTaskCode, pcName, usStackDepth, pvParameters, uxPriority, pvCreatedTask, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete) {
+    TaskHandle_t task = (xTaskToDelete == nullptr) ? current_task : xTaskToDelete;
+    if (task == nullptr) {
+        return;
+    }
+
+    task->deleted = true;
+    if (task == current_task) {
+        _longjmp(scheduler_context, 1);
+    }
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return current_task;
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t) (now_us / (1000000 / configTICK_RATE_HZ));
+}
+
+BaseType_t xPortGetCoreID() {
+    if (current_task == nullptr || current_task->core == tskNO_AFFINITY) {
+        return 0;
+    }
+    return current_task->core;
+}
+
+void vTaskDelay(TickType_t xTicksToDelay) {
+    uint64_t delay_us = (uint64_t) xTicksToDelay * (1000000 / configTICK_RATE_HZ);
+
+    // outside a task, there's nothing to switch to - the time just passes
+    if (current_task == nullptr) {
+        host_advance_us(delay_us);
+        return;
+    }
+
+    if (xTicksToDelay > 0) {
+        current_task->blocked = true;
+        current_task->wake_at_us = now_us + delay_us;
+    }
+    suspend_current();
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify) {
+    if (xTaskToNotify == nullptr || xTaskToNotify->deleted) {
+        return pdPASS;
+    }
+
+    xTaskToNotify->notifications++;
+    if (xTaskToNotify->waiting_for_notification) {
+        wake(xTaskToNotify);
+        preempt_for(xTaskToNotify);
+    }
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t* pxHigherPriorityTaskWoken) {
+    if (pxHigherPriorityTaskWoken != nullptr) {
+        *pxHigherPriorityTaskWoken = pdFALSE;
+    }
+
+    bool saved = in_timer_callback;
+    in_timer_callback = true;
+    xTaskNotifyGive(xTaskToNotify);
+    in_timer_callback = saved;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait) {
+    if (current_task == nullptr) {
+        fail("ulTaskNotifyTake() can only block inside a task");
+    }
+
+    TaskHandle_t task = current_task;
+    if (task->notifications == 0 && xTicksToWait > 0) {
+        task->blocked = true;
+        task->waiting_for_notification = true;
+        task->wake_at_us = (xTicksToWait == portMAX_DELAY) ? NEVER : now_us + (uint64_t) xTicksToWait * (1000000 / configTICK_RATE_HZ);
+        suspend_current();
+    }
+
+    uint32_t notifications = task->notifications;
+    if (notifications > 0) {
+        task->notifications = xClearCountOnExit ? 0 : notifications - 1;
+    }
+    return notifications;
+}
+
+// ------------ Critical sections ----------------------
+
+void vPortEnterCritical(portMUX_TYPE* mux) {
+    mux->owner = (uint32_t) xPortGetCoreID();
+    mux->count++;
+}
+
+void vPortExitCritical(portMUX_TYPE* mux) {
+    if (mux->count == 0) {
+        fail("critical section exited more times than it was entered");
+    }
+    if (--mux->count == 0) {
+        mux->owner = portMUX_FREE_VAL;
+    }
+}
+
+// ------------ esp_timer ------------------------------
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* create_args, esp_timer_handle_t* out_handle) {
+    if (create_args == nullptr || create_args->callback == nullptr || out_handle == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_timer_handle_t timer = new esp_timer();
+    timer->callback = create_args->callback;
+    timer->arg = create_args->arg;
+    timers.push_back(timer);
+
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    if (timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    timer->period_us = 0;
+    timer->expires_at_us = now_us + timeout_us;
+    timer->armed = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period) {
+    if (timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (period == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    timer->period_us = period;
+    timer->expires_at_us = now_us + period;
+    timer->armed = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    if (!timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    timer->armed = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    if (timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    for (size_t i = 0; i < timers.size(); i++) {
+        if (timers[i] == timer) {
+            timers.erase(timers.begin() + i);
+            break;
+        }
+    }
+    delete timer;
+    return ESP_OK;
+}
+
+int64_t esp_timer_get_time() {
+    return (int64_t) now_us;
+}
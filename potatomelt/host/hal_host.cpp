@@ -0,0 +1,238 @@
+#include <Arduino.h>
+#include <Wire.h>
+#include <time.h>
+#include <map>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "../src/hal/hal.h"
+#include "host.h"
+
+// The host backend for the HAL
+// The clock's the virtual one, the I2C bus is whatever devices host.h has attached, and NVS lives in memory.
+// The cycle counter is the one thing that's real: it counts host time, so the profiler and the benchmarks measure the
+// code actually running.
+
+hal_i2c_stats_t i2c_stats;
+
+static host_i2c_device_t i2c_devices[128];
+static bool i2c_attached[128];
+
+static std::string nvs_namespace;
+static uint32_t nvs_writes = 0;
+static bool psram_available = true;
+
+// ------------ Clock ---------------------------------
+
+unsigned long hal_micros() {
+    return micros();
+}
+
+unsigned long hal_millis() {
+    return millis();
+}
+
+// The TSC where there is one - it ticks at a fixed rate, which is what we want for timing code anyway
+static uint64_t read_counter() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+}
+
+static uint64_t monotonic_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+uint32_t hal_cycle_count() {
+    return (uint32_t) read_counter();
+}
+
+// Measured once, against the monotonic clock
+uint32_t hal_cycles_per_us() {
+    static uint32_t cycles_per_us = 0;
+
+    if (cycles_per_us == 0) {
+        uint64_t started_ns = monotonic_ns();
+        uint64_t started_cycles = read_counter();
+        while (monotonic_ns() - started_ns < 20000000) {
+        }
+        uint64_t cycles = read_counter() - started_cycles;
+        uint64_t elapsed_ns = monotonic_ns() - started_ns;
+
+        cycles_per_us = max((uint32_t) 1, (uint32_t) (cycles * 1000 / elapsed_ns));
+    }
+
+    return cycles_per_us;
+}
+
+// ------------ I2C -----------------------------------
+
+void host_i2c_attach(uint8_t address, const host_i2c_device_t* device) {
+    i2c_devices[address & 0x7f] = *device;
+    i2c_attached[address & 0x7f] = true;
+}
+
+void host_i2c_detach(uint8_t address) {
+    i2c_attached[address & 0x7f] = false;
+}
+
+// What a transaction of this many bits takes on the wire at Wire's clock - every byte's 9 bits with its ack,
+// and the starts and stops are a bit each. The ESP32's driver adds its own overhead on top of this.
+static unsigned long bus_us(unsigned long bits) {
+    return (bits * 1000000UL + Wire.getClock() - 1) / Wire.getClock();
+}
+
+void hal_i2c_write(uint8_t device_addr, uint8_t reg_addr, const uint8_t* data, uint8_t len) {
+    if (i2c_attached[device_addr & 0x7f] && i2c_devices[device_addr & 0x7f].write != nullptr) {
+        host_i2c_device_t* device = &i2c_devices[device_addr & 0x7f];
+        device->write(device->context, reg_addr, data, len);
+    }
+
+    // start, address, register, data, stop
+    i2c_stats.transactions++;
+    i2c_stats.busy_us += bus_us(1 + 9 + 9 + 9 * len + 1);
+}
+
+void hal_i2c_read(uint8_t device_addr, uint8_t reg_addr, uint8_t* data, uint8_t len) {
+    if (i2c_attached[device_addr & 0x7f] && i2c_devices[device_addr & 0x7f].read != nullptr) {
+        host_i2c_device_t* device = &i2c_devices[device_addr & 0x7f];
+        device->read(device->context, reg_addr, data, len);
+    } else {
+        memset(data, 0xff, len);
+    }
+
+    // start, address, register, repeated start, address, data, stop
+    i2c_stats.transactions++;
+    i2c_stats.busy_us += bus_us(1 + 9 + 9 + 1 + 9 + 9 * len + 1);
+}
+
+void hal_i2c_get_stats(hal_i2c_stats_t* stats) {
+    *stats = i2c_stats;
+}
+
+void hal_i2c_reset_stats() {
+    i2c_stats.transactions = 0;
+    i2c_stats.busy_us = 0;
+}
+
+// ------------ RMT -----------------------------------
+
+void hal_rmt_write(rmt_channel_t channel, const rmt_item32_t* items, int item_count) {
+    rmt_write_items(channel, items, item_count, false);
+}
+
+// ------------ ADC -----------------------------------
+
+uint32_t hal_adc_read_millivolts(uint8_t pin) {
+    return analogReadMilliVolts(pin);
+}
+
+// ------------ NVS -----------------------------------
+
+static std::map<std::string, std::vector<uint8_t>>& nvs() {
+    static std::map<std::string, std::vector<uint8_t>> stored;
+    return stored;
+}
+
+static std::string nvs_key(const char* key) {
+    return nvs_namespace + "/" + key;
+}
+
+static bool nvs_get(const char* key, void* buffer, size_t len) {
+    auto found = nvs().find(nvs_key(key));
+    if (found == nvs().end() || found->second.size() != len) {
+        return false;
+    }
+
+    memcpy(buffer, found->second.data(), len);
+    return true;
+}
+
+static void nvs_put(const char* key, const void* buffer, size_t len) {
+    const uint8_t* bytes = (const uint8_t*) buffer;
+    nvs()[nvs_key(key)] = std::vector<uint8_t>(bytes, bytes + len);
+    nvs_writes++;
+}
+
+void host_nvs_clear() {
+    nvs().clear();
+}
+
+uint32_t host_nvs_write_count() {
+    return nvs_writes;
+}
+
+void hal_nvs_begin(const char* name) {
+    nvs_namespace = name;
+}
+
+int hal_nvs_get_int(const char* key, int default_value) {
+    int value;
+    return nvs_get(key, &value, sizeof(value)) ? value : default_value;
+}
+
+void hal_nvs_put_int(const char* key, int value) {
+    nvs_put(key, &value, sizeof(value));
+}
+
+float hal_nvs_get_float(const char* key, float default_value) {
+    float value;
+    return nvs_get(key, &value, sizeof(value)) ? value : default_value;
+}
+
+void hal_nvs_put_float(const char* key, float value) {
+    nvs_put(key, &value, sizeof(value));
+}
+
+size_t hal_nvs_get_bytes(const char* key, void* buffer, size_t len) {
+    // as on the ESP32 - anything that isn't the size we expect is junk to us
+    return nvs_get(key, buffer, len) ? len : 0;
+}
+
+void hal_nvs_put_bytes(const char* key, const void* buffer, size_t len) {
+    nvs_put(key, buffer, len);
+}
+
+// ------------ Memory --------------------------------
+
+void host_set_psram(bool available) {
+    psram_available = available;
+}
+
+void* hal_alloc_psram(size_t len) {
+    return psram_available ? malloc(len) : nullptr;
+}
+
+// ------------ Checksums -----------------------------
+
+// The same CRC-32 as the ESP32's ROM (and zlib's): reflected, polynomial 0xEDB88320, inverted in and out
+uint32_t hal_crc32(const void* data, size_t len) {
+    static uint32_t table[256];
+    static bool table_built = false;
+
+    if (!table_built) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+            }
+            table[i] = crc;
+        }
+        table_built = true;
+    }
+
+    const uint8_t* bytes = (const uint8_t*) data;
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc = table[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
@@ -0,0 +1,99 @@
+#ifndef _HOST_h
+#define _HOST_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <driver/rmt.h>
+
+// The Linux backend, as the tests, benchmarks and simulator see it
+// The firmware runs unmodified against the stand-in headers in include/: FreeRTOS tasks become cooperative green threads
+// on one host thread, the clock is virtual, and the hardware is whatever gets plugged in here.
+// Nothing here is thread-safe - everything but the seqlock stress tests runs on the one thread.
+
+// ------------ Virtual time --------------------------
+// The clock only moves when something moves it. Tasks run until they block, in priority order, and then the clock jumps
+// straight to whatever happens next - a timer, or a task's timeout. So a tick that takes 10us on the ESP32 takes no
+// virtual time at all, unless it says otherwise with host_advance_us().
+
+uint64_t host_now_us();
+
+// Moves the clock on, firing any timers and waking any tasks that fall due on the way - but doesn't switch tasks.
+// From inside a task, this is the task taking that long to run. From outside, it's time passing between calls.
+void host_advance_us(uint64_t us);
+
+// Runs tasks and timers until the clock reaches now + us, or every task is blocked forever
+void host_run_for_us(uint64_t us);
+
+// Counts the task switches and timer callbacks so far - benchmarks use these to make sure they're timing what they think
+uint64_t host_task_switches();
+uint64_t host_timer_callbacks();
+
+// Creates the Arduino loop task, which runs setup() and then loop() forever - as the ESP32's main does.
+// Only in the potatomelt_firmware library, which builds the sketch itself.
+void host_start_firmware();
+
+// ------------ I2C -----------------------------------
+// A device on the bus. reg is the sub-address byte exactly as the firmware sent it - auto-increment bit and all
+typedef struct host_i2c_device_t {
+    void (*read)(void* context, uint8_t reg, uint8_t* data, uint8_t len);
+    void (*write)(void* context, uint8_t reg, const uint8_t* data, uint8_t len);
+    void* context;
+} host_i2c_device_t;
+
+void host_i2c_attach(uint8_t address, const host_i2c_device_t* device);
+void host_i2c_detach(uint8_t address);
+
+// Reads from an address with nothing on it come back as 0xff, as they would off a pulled-up bus.
+// Every transaction is charged what it would cost on the wire at Wire's clock - see hal_i2c_get_stats() - but that's
+// only counted, not taken off the virtual clock.
+
+// ------------ RMT -----------------------------------
+// Called with every frame written to a transmit channel
+typedef void (*host_rmt_listener_t)(void* context, rmt_channel_t channel, const rmt_item32_t* items, int item_count);
+
+void host_rmt_set_listener(host_rmt_listener_t listener, void* context);
+uint32_t host_rmt_write_count(rmt_channel_t channel);
+
+// Hands a receive channel a capture, as if it had just come in off the pin. Dropped if the channel isn't receiving.
+void host_rmt_receive(rmt_channel_t channel, const rmt_item32_t* items, int item_count);
+
+// ------------ ADC -----------------------------------
+void host_adc_set_millivolts(uint8_t pin, uint32_t millivolts);
+
+// ------------ NVS -----------------------------------
+// Wipes everything stored, as if the flash had just been erased
+void host_nvs_clear();
+uint32_t host_nvs_write_count();
+
+// ------------ Memory --------------------------------
+// Whether hal_alloc_psram() has any PSRAM to hand out. On by default.
+void host_set_psram(bool available);
+
+// ------------ Serial --------------------------------
+// Where Serial's output goes - nullptr for stdout
+typedef void (*host_serial_output_t)(void* context, const uint8_t* data, size_t len);
+
+void host_serial_set_output(host_serial_output_t output, void* context);
+void host_serial_set_write_room(int bytes);     // what availableForWrite() says. Defaults to the ESP32's 128 byte FIFO
+void host_serial_input(const char* text);       // queues text for Serial.read()
+
+// ------------ Gamepad -------------------------------
+// What the Bluepad32 stand-in reports for its one gamepad, in Bluepad32's units
+typedef struct host_gamepad_t {
+    int throttle;       // 0 - 1023
+    int axis_x;         // -512 - 511
+    int axis_y;
+    int axis_rx;
+    int axis_ry;
+    uint16_t buttons;
+    uint8_t dpad;
+} host_gamepad_t;
+
+// Connects and disconnects show up on the next BP32.update(), as Bluepad32's callbacks
+void host_gamepad_connect();
+void host_gamepad_disconnect();
+
+// A new packet, for the next BP32.update() to pick up. Packets sent between updates overwrite each other, as they do on the ESP32
+void host_gamepad_send(const host_gamepad_t* gamepad);
+
+#endif
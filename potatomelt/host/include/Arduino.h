@@ -0,0 +1,82 @@
+#ifndef _HOST_ARDUINO_h
+#define _HOST_ARDUINO_h
+
+// Host stand-in for the Arduino-ESP32 core - just the slice PotatoMelt uses
+// The clock is the virtual one from host.h, and Serial goes to stdout unless a test or the simulator takes it over
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "driver/gpio.h"
+
+// the ESP32-S3 at full speed, with its 80MHz peripheral clock
+#ifndef F_CPU
+#define F_CPU 240000000L
+#endif
+#define APB_CLK_FREQ 80000000
+
+#define PI 3.1415926535897932384626433832795
+#define HALF_PI 1.5707963267948966192313216916398
+#define TWO_PI 6.283185307179586476925286766559
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+
+#define LOW 0x0
+#define HIGH 0x1
+#define INPUT 0x01
+#define OUTPUT 0x03
+
+// as in Arduino-ESP32, min() and max() are the std:: ones - so both arguments have to be the same type
+using std::abs;
+using std::max;
+using std::min;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+uint32_t getCpuFrequencyMhz();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+uint32_t analogReadMilliVolts(uint8_t pin);
+
+// Arduino's String, as far as anyone here uses it
+class String : public std::string {
+    public:
+        String() {}
+        String(const char* text) : std::string(text == nullptr ? "" : text) {}
+        String(const std::string& text) : std::string(text) {}
+};
+
+class HardwareSerial {
+    public:
+        void begin(unsigned long baud);
+        int available();
+        int read();
+        int availableForWrite();
+        size_t write(uint8_t byte);
+        size_t write(const uint8_t* buffer, size_t size);
+        size_t print(const char* text);
+        size_t println(const char* text = "");
+        size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+        void flush();
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef _HOST_BLUEPAD32_h
+#define _HOST_BLUEPAD32_h
+
+#include <Arduino.h>
+
+// Host stand-in for Bluepad32's Arduino API, with a single gamepad that host.h connects and drives
+
+#define BP32_MAX_GAMEPADS 4
+
+typedef struct {
+    uint16_t vendor_id;
+    uint16_t product_id;
+} ControllerProperties;
+
+class Controller {
+    public:
+        bool isConnected() const;
+        bool hasData() const;
+        int32_t throttle() const;
+        int32_t brake() const;
+        int32_t axisX() const;
+        int32_t axisY() const;
+        int32_t axisRX() const;
+        int32_t axisRY() const;
+        uint16_t buttons() const;
+        uint8_t dpad() const;
+        ControllerProperties getProperties() const;
+        String getModelName() const;
+};
+
+typedef Controller* ControllerPtr;
+
+typedef void (*ControllerCallback)(ControllerPtr controller);
+
+class Bluepad32 {
+    public:
+        void setup(const ControllerCallback& onConnect, const ControllerCallback& onDisconnect, bool startScanning = true);
+        // runs the connect and disconnect callbacks, and picks up the latest packet - true if anything's changed
+        bool update();
+        void enableNewBluetoothConnections(bool enabled);
+};
+
+extern Bluepad32 BP32;
+
+#endif
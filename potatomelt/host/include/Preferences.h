@@ -0,0 +1,7 @@
+#ifndef _HOST_PREFERENCES_h
+#define _HOST_PREFERENCES_h
+
+// Host stand-in for Arduino-ESP32's Preferences.h
+// Only here so the sketch's include resolves - NVS goes through hal_nvs_*, which hal_host.cpp keeps in memory
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef _HOST_SPI_h
+#define _HOST_SPI_h
+
+#include <Arduino.h>
+
+// Host stand-in for Arduino-ESP32's SPI.h - there's nothing on the bus, so reads come back as zeros
+// Like the real one, it brings the pin functions along with it
+
+class SPIClass {
+    public:
+        void begin();
+        uint8_t transfer(uint8_t data);
+};
+
+extern SPIClass SPI;
+
+#endif
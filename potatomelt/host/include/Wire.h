@@ -0,0 +1,20 @@
+#ifndef _HOST_WIRE_h
+#define _HOST_WIRE_h
+
+#include <stdint.h>
+
+// Host stand-in for Arduino's Wire.h
+// Only the setup calls live here - the firmware goes through hal_i2c_read/write, which host.h's device models answer
+
+class TwoWire {
+    public:
+        bool begin(int sda, int scl, uint32_t frequency = 0);
+        bool setClock(uint32_t frequency);
+        uint32_t getClock();
+    private:
+        uint32_t clock_hz = 100000;
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef _HOST_DRIVER_RMT_h
+#define _HOST_DRIVER_RMT_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "../esp_err.h"
+#include "../freertos/ringbuf.h"
+#include "gpio.h"
+
+// Host stand-in for ESP-IDF's legacy RMT driver, as the ESP32-S3 has it: 4 transmit channels, then 4 receive channels
+// Written frames go to whoever's listening through host.h, and receive channels hand back whatever host.h fed them
+
+#define SOC_RMT_SUPPORT_TX_SYNCHRO 1
+
+typedef enum {
+    RMT_CHANNEL_0,
+    RMT_CHANNEL_1,
+    RMT_CHANNEL_2,
+    RMT_CHANNEL_3,
+    RMT_CHANNEL_4,
+    RMT_CHANNEL_5,
+    RMT_CHANNEL_6,
+    RMT_CHANNEL_7,
+    RMT_CHANNEL_MAX
+} rmt_channel_t;
+
+typedef enum {
+    RMT_MODE_TX,
+    RMT_MODE_RX,
+    RMT_MODE_MAX
+} rmt_mode_t;
+
+typedef enum {
+    RMT_IDLE_LEVEL_LOW,
+    RMT_IDLE_LEVEL_HIGH,
+    RMT_IDLE_LEVEL_MAX,
+} rmt_idle_level_t;
+
+typedef enum {
+    RMT_CARRIER_LEVEL_LOW,
+    RMT_CARRIER_LEVEL_HIGH,
+    RMT_CARRIER_LEVEL_MAX
+} rmt_carrier_level_t;
+
+typedef struct {
+    union {
+        struct {
+            uint32_t duration0 : 15;
+            uint32_t level0 : 1;
+            uint32_t duration1 : 15;
+            uint32_t level1 : 1;
+        };
+        uint32_t val;
+    };
+} rmt_item32_t;
+
+typedef struct {
+    uint32_t carrier_freq_hz;
+    rmt_carrier_level_t carrier_level;
+    rmt_idle_level_t idle_level;
+    uint8_t carrier_duty_percent;
+    uint32_t loop_count;
+    bool carrier_en;
+    bool loop_en;
+    bool idle_output_en;
+} rmt_tx_config_t;
+
+typedef struct {
+    uint16_t idle_threshold;
+    uint8_t filter_ticks_thresh;
+    bool filter_en;
+    bool rm_carrier;
+    uint32_t carrier_freq_hz;
+    uint8_t carrier_duty_percent;
+    rmt_carrier_level_t carrier_level;
+} rmt_rx_config_t;
+
+typedef struct {
+    rmt_mode_t rmt_mode;
+    rmt_channel_t channel;
+    gpio_num_t gpio_num;
+    uint8_t clk_div;
+    uint8_t mem_block_num;
+    uint32_t flags;
+    union {
+        rmt_tx_config_t tx_config;
+        rmt_rx_config_t rx_config;
+    };
+} rmt_config_t;
+
+#define RMT_DEFAULT_CONFIG_TX(gpio, channel_id)     \
+    {                                               \
+        .rmt_mode = RMT_MODE_TX,                    \
+        .channel = channel_id,                      \
+        .gpio_num = gpio,                           \
+        .clk_div = 80,                              \
+        .mem_block_num = 1,                         \
+        .flags = 0,                                 \
+        .tx_config = {                              \
+            .carrier_freq_hz = 38000,               \
+            .carrier_level = RMT_CARRIER_LEVEL_HIGH,\
+            .idle_level = RMT_IDLE_LEVEL_LOW,       \
+            .carrier_duty_percent = 33,             \
+            .loop_count = 0,                        \
+            .carrier_en = false,                    \
+            .loop_en = false,                       \
+            .idle_output_en = true,                 \
+        }                                           \
+    }
+
+#define RMT_DEFAULT_CONFIG_RX(gpio, channel_id)     \
+    {                                               \
+        .rmt_mode = RMT_MODE_RX,                    \
+        .channel = channel_id,                      \
+        .gpio_num = gpio,                           \
+        .clk_div = 80,                              \
+        .mem_block_num = 1,                         \
+        .flags = 0,                                 \
+        .rx_config = {                              \
+            .idle_threshold = 12000,                \
+            .filter_ticks_thresh = 100,             \
+            .filter_en = true,                      \
+            .rm_carrier = false,                    \
+            .carrier_freq_hz = 38000,               \
+            .carrier_duty_percent = 33,             \
+            .carrier_level = RMT_CARRIER_LEVEL_HIGH \
+        }                                           \
+    }
+
+esp_err_t rmt_config(const rmt_config_t* rmt_param);
+esp_err_t rmt_driver_install(rmt_channel_t channel, size_t rx_buf_size, int intr_alloc_flags);
+esp_err_t rmt_driver_uninstall(rmt_channel_t channel);
+esp_err_t rmt_write_items(rmt_channel_t channel, const rmt_item32_t* rmt_item, int item_num, bool wait_tx_done);
+esp_err_t rmt_get_ringbuf_handle(rmt_channel_t channel, RingbufHandle_t* buf_handle);
+esp_err_t rmt_rx_start(rmt_channel_t channel, bool rx_idx_rst);
+esp_err_t rmt_rx_stop(rmt_channel_t channel);
+esp_err_t rmt_add_channel_to_group(rmt_channel_t channel);
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef _HOST_FREERTOS_h
+#define _HOST_FREERTOS_h
+
+#include <stdint.h>
+
+// Host stand-in for ESP-IDF's freertos/FreeRTOS.h: the types, and the port layer's critical sections
+// The tasks themselves are in task.h, and run on the cooperative scheduler in freertos_host.cpp
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdFALSE ((BaseType_t) 0)
+#define pdTRUE ((BaseType_t) 1)
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS ((TickType_t) 1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY ((TickType_t) 0xffffffffUL)
+#define pdMS_TO_TICKS(xTimeInMs) ((TickType_t) (((TickType_t) (xTimeInMs) * (TickType_t) configTICK_RATE_HZ) / (TickType_t) 1000U))
+
+#define portNUM_PROCESSORS 2
+
+// Host tasks only switch when they block, so nothing can get in between a task and its critical section -
+// the lock only has to exist, and count, so mismatched enters and exits still show up
+typedef struct {
+    uint32_t owner;
+    uint32_t count;
+} portMUX_TYPE;
+
+#define portMUX_FREE_VAL 0xB33FFFFF
+#define portMUX_INITIALIZER_UNLOCKED { portMUX_FREE_VAL, 0 }
+
+void vPortEnterCritical(portMUX_TYPE* mux);
+void vPortExitCritical(portMUX_TYPE* mux);
+
+#define portMUX_INITIALIZE(mux) do { (mux)->owner = portMUX_FREE_VAL; (mux)->count = 0; } while (0)
+#define portENTER_CRITICAL(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux) vPortExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux) vPortExitCritical(mux)
+
+// which core the calling task is pinned to
+BaseType_t xPortGetCoreID();
+
+#endif
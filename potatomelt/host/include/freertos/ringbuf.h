@@ -0,0 +1,15 @@
+#ifndef _HOST_FREERTOS_RINGBUF_h
+#define _HOST_FREERTOS_RINGBUF_h
+
+#include <stddef.h>
+#include "FreeRTOS.h"
+
+// Host stand-in for ESP-IDF's freertos/ringbuf.h - no-split buffers only, which is all the RMT driver hands out
+
+typedef struct host_ringbuf_t* RingbufHandle_t;
+
+// never blocks on the host - xTicksToWait is ignored, and an empty buffer returns nullptr straight away
+void* xRingbufferReceive(RingbufHandle_t xRingbuffer, size_t* pxItemSize, TickType_t xTicksToWait);
+void vRingbufferReturnItem(RingbufHandle_t xRingbuffer, void* pvItem);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef _HOST_FREERTOS_TASK_h
+#define _HOST_FREERTOS_TASK_h
+
+#include "FreeRTOS.h"
+
+// Host stand-in for ESP-IDF's freertos/task.h
+// Must be included after FreeRTOS.h, as on the ESP32
+
+typedef struct tskTaskControlBlock* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+#define tskNO_AFFINITY 0x7FFFFFFF
+#define tskIDLE_PRIORITY ((UBaseType_t) 0U)
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pvTaskCode, const char* pcName, uint32_t usStackDepth, void* pvParameters,
+    UBaseType_t uxPriority, TaskHandle_t* pvCreatedTask, BaseType_t xCoreID);
+BaseType_t xTaskCreate(TaskFunction_t pvTaskCode, const char* pcName, uint32_t usStackDepth, void* pvParameters,
+    UBaseType_t uxPriority, TaskHandle_t* pvCreatedTask);
+void vTaskDelete(TaskHandle_t xTaskToDelete);
+
+TaskHandle_t xTaskGetCurrentTaskHandle();
+TickType_t xTaskGetTickCount();
+void vTaskDelay(TickType_t xTicksToDelay);
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify);
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t* pxHigherPriorityTaskWoken);
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait);
+
+#define taskYIELD() vTaskDelay(0)
+#define taskENTER_CRITICAL(mux) portENTER_CRITICAL(mux)
+#define taskEXIT_CRITICAL(mux) portEXIT_CRITICAL(mux)
+#define taskENTER_CRITICAL_ISR(mux) portENTER_CRITICAL_ISR(mux)
+#define taskEXIT_CRITICAL_ISR(mux) portEXIT_CRITICAL_ISR(mux)
+
+#endif
@@ -0,0 +1,86 @@
+#include <math.h>
+#include <string.h>
+#include "lis331_model.h"
+#include "host.h"
+#include "../src/lib/SparkFun_LIS331_ESP32.h"
+
+static void lis331_read(void* context, uint8_t reg, uint8_t* data, uint8_t len);
+static void lis331_write(void* context, uint8_t reg, const uint8_t* data, uint8_t len);
+
+void host_lis331_attach(host_lis331_t* lis, uint8_t address) {
+    memset(lis, 0, sizeof(*lis));
+    lis->address = address;
+
+    // the power-on defaults: powered down, all three axes enabled
+    lis->registers[CTRL_REG1] = 0x07;
+
+    host_i2c_device_t device;
+    device.read = lis331_read;
+    device.write = lis331_write;
+    device.context = lis;
+    host_i2c_attach(address, &device);
+}
+
+void host_lis331_set_accel(host_lis331_t* lis, float x_g, float y_g, float z_g) {
+    lis->accel_g[0] = x_g;
+    lis->accel_g[1] = y_g;
+    lis->accel_g[2] = z_g;
+}
+
+int host_lis331_full_scale_g(const host_lis331_t* lis) {
+    switch ((lis->registers[CTRL_REG4] >> 4) & 0x03) {
+        case 0: return 100;
+        case 1: return 200;
+        default: return 400;
+    }
+}
+
+// One axis, as the part would report it: 12 bit two's complement, left-justified in 16
+static int16_t output_counts(const host_lis331_t* lis, int axis) {
+    float counts = roundf(lis->accel_g[axis] * 2047 / host_lis331_full_scale_g(lis));
+    counts = fmaxf(-2048.0f, fminf(2047.0f, counts));
+    return (int16_t) ((int16_t) counts * 16);
+}
+
+static uint8_t read_register(const host_lis331_t* lis, uint8_t reg) {
+    if (reg >= OUT_X_L && reg <= OUT_Z_H) {
+        int16_t counts = output_counts(lis, (reg - OUT_X_L) / 2);
+        return ((reg - OUT_X_L) & 1) ? (uint8_t) ((uint16_t) counts >> 8) : (uint8_t) (counts & 0xff);
+    }
+
+    if (reg == STATUS_REG) {
+        return 0x0f;            // always fresh data on every axis
+    }
+
+    return (reg < sizeof(lis->registers)) ? lis->registers[reg] : 0;
+}
+
+static void lis331_read(void* context, uint8_t reg, uint8_t* data, uint8_t len) {
+    host_lis331_t* lis = (host_lis331_t*) context;
+    bool auto_increment = reg & I2C_AUTO_INCREMENT;
+    reg &= ~I2C_AUTO_INCREMENT;
+
+    if (lis->before_read != nullptr) {
+        lis->before_read(lis->before_read_context, lis);
+    }
+
+    for (int i = 0; i < len; i++) {
+        data[i] = read_register(lis, auto_increment ? reg + i : reg);
+    }
+
+    lis->reads++;
+    lis->bytes_read += len;
+}
+
+static void lis331_write(void* context, uint8_t reg, const uint8_t* data, uint8_t len) {
+    host_lis331_t* lis = (host_lis331_t*) context;
+    bool auto_increment = reg & I2C_AUTO_INCREMENT;
+    reg &= ~I2C_AUTO_INCREMENT;
+
+    for (int i = 0; i < len; i++) {
+        uint8_t target = auto_increment ? reg + i : reg;
+        if (target < sizeof(lis->registers)) {
+            lis->registers[target] = data[i];
+        }
+    }
+}
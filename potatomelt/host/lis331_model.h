@@ -0,0 +1,30 @@
+#ifndef _LIS331_MODEL_h
+#define _LIS331_MODEL_h
+
+#include <stdint.h>
+
+// An H3LIS331DL on the host's I2C bus
+// Enough of the register file for the SparkFun driver to set it up, and output registers that read back whatever
+// acceleration it's been given - at the configured full scale, 12 bits left-justified, clipped at the ends of the range,
+// just as the real part reports it. Multi-byte reads only move on to the next register with the auto-increment bit set.
+
+typedef struct host_lis331_t {
+    uint8_t address;
+    uint8_t registers[0x40];
+    float accel_g[3];               // x, y, z
+    uint32_t reads;                 // transactions, and bytes, the firmware's read from us
+    uint32_t bytes_read;
+
+    // If set, called before every read - so a model can bring accel_g up to the moment it's read. Cleared by attach
+    void (*before_read)(void* context, struct host_lis331_t* lis);
+    void* before_read_context;
+} host_lis331_t;
+
+// Resets the part and puts it on the bus
+void host_lis331_attach(host_lis331_t* lis, uint8_t address);
+void host_lis331_set_accel(host_lis331_t* lis, float x_g, float y_g, float z_g);
+
+// What the part's set to measure up to, from CTRL_REG4 - 100, 200 or 400g
+int host_lis331_full_scale_g(const host_lis331_t* lis);
+
+#endif
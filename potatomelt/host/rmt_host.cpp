@@ -0,0 +1,177 @@
+#include <string.h>
+#include <deque>
+#include <vector>
+#include <driver/rmt.h>
+#include <freertos/ringbuf.h>
+#include "host.h"
+
+// The RMT driver for the host
+// Transmit channels hand each frame to the listener as it's written, straight away - there's no wire to wait on.
+// Receive channels queue up whatever host_rmt_receive() gives them, for the driver's ring buffer to hand out.
+
+struct host_ringbuf_t {
+    std::deque<std::vector<uint8_t>> items;
+    size_t size;                    // as given to rmt_driver_install() - once it's full, new captures are dropped
+    size_t used;
+    bool item_out;                  // the front item's been handed out, and not returned yet
+};
+
+typedef struct host_rmt_channel_t {
+    rmt_config_t config;
+    bool installed;
+    bool receiving;
+    bool grouped;
+    uint32_t writes;
+    host_ringbuf_t ringbuf;
+} host_rmt_channel_t;
+
+// Robot's constructor sets up its channels before main() - so they're built on first use, not whenever static init gets to them
+static host_rmt_channel_t* get_channels() {
+    static host_rmt_channel_t channels[RMT_CHANNEL_MAX];
+    return channels;
+}
+
+static host_rmt_listener_t listener = nullptr;
+static void* listener_context = nullptr;
+
+static bool valid(rmt_channel_t channel) {
+    return channel >= RMT_CHANNEL_0 && channel < RMT_CHANNEL_MAX;
+}
+
+esp_err_t rmt_config(const rmt_config_t* rmt_param) {
+    if (rmt_param == nullptr || !valid(rmt_param->channel)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    get_channels()[rmt_param->channel].config = *rmt_param;
+    return ESP_OK;
+}
+
+esp_err_t rmt_driver_install(rmt_channel_t channel, size_t rx_buf_size, int intr_alloc_flags) {
+    (void) intr_alloc_flags;
+
+    if (!valid(channel)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (get_channels()[channel].installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    get_channels()[channel].installed = true;
+    get_channels()[channel].ringbuf.size = rx_buf_size;
+    return ESP_OK;
+}
+
+esp_err_t rmt_driver_uninstall(rmt_channel_t channel) {
+    if (!valid(channel)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    host_rmt_channel_t* c = &get_channels()[channel];
+    c->installed = false;
+    c->receiving = false;
+    c->grouped = false;
+    c->ringbuf.items.clear();
+    c->ringbuf.used = 0;
+    c->ringbuf.item_out = false;
+    return ESP_OK;
+}
+
+esp_err_t rmt_write_items(rmt_channel_t channel, const rmt_item32_t* rmt_item, int item_num, bool wait_tx_done) {
+    (void) wait_tx_done;
+
+    if (!valid(channel) || !get_channels()[channel].installed || rmt_item == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    get_channels()[channel].writes++;
+    if (listener != nullptr) {
+        listener(listener_context, channel, rmt_item, item_num);
+    }
+    return ESP_OK;
+}
+
+esp_err_t rmt_get_ringbuf_handle(rmt_channel_t channel, RingbufHandle_t* buf_handle) {
+    if (!valid(channel) || !get_channels()[channel].installed || buf_handle == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *buf_handle = &get_channels()[channel].ringbuf;
+    return ESP_OK;
+}
+
+esp_err_t rmt_rx_start(rmt_channel_t channel, bool rx_idx_rst) {
+    (void) rx_idx_rst;
+
+    if (!valid(channel) || !get_channels()[channel].installed || get_channels()[channel].config.rmt_mode != RMT_MODE_RX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    get_channels()[channel].receiving = true;
+    return ESP_OK;
+}
+
+esp_err_t rmt_rx_stop(rmt_channel_t channel) {
+    if (!valid(channel)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    get_channels()[channel].receiving = false;
+    return ESP_OK;
+}
+
+esp_err_t rmt_add_channel_to_group(rmt_channel_t channel) {
+    if (!valid(channel) || !get_channels()[channel].installed) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    get_channels()[channel].grouped = true;
+    return ESP_OK;
+}
+
+void* xRingbufferReceive(RingbufHandle_t xRingbuffer, size_t* pxItemSize, TickType_t xTicksToWait) {
+    (void) xTicksToWait;
+
+    if (xRingbuffer->items.empty() || xRingbuffer->item_out) {
+        return nullptr;
+    }
+
+    xRingbuffer->item_out = true;
+    *pxItemSize = xRingbuffer->items.front().size();
+    return xRingbuffer->items.front().data();
+}
+
+void vRingbufferReturnItem(RingbufHandle_t xRingbuffer, void* pvItem) {
+    if (!xRingbuffer->item_out || pvItem != xRingbuffer->items.front().data()) {
+        return;
+    }
+
+    xRingbuffer->used -= xRingbuffer->items.front().size();
+    xRingbuffer->items.pop_front();
+    xRingbuffer->item_out = false;
+}
+
+void host_rmt_set_listener(host_rmt_listener_t new_listener, void* context) {
+    listener = new_listener;
+    listener_context = context;
+}
+
+uint32_t host_rmt_write_count(rmt_channel_t channel) {
+    return valid(channel) ? get_channels()[channel].writes : 0;
+}
+
+void host_rmt_receive(rmt_channel_t channel, const rmt_item32_t* items, int item_count) {
+    if (!valid(channel) || !get_channels()[channel].receiving || item_count <= 0) {
+        return;
+    }
+
+    host_ringbuf_t* ringbuf = &get_channels()[channel].ringbuf;
+    size_t len = item_count * sizeof(rmt_item32_t);
+    if (ringbuf->used + len > ringbuf->size) {
+        return;
+    }
+
+    const uint8_t* bytes = (const uint8_t*) items;
+    ringbuf->items.emplace_back(bytes, bytes + len);
+    ringbuf->used += len;
+}
@@ -0,0 +1,676 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <random>
+#include <vector>
+#include "host.h"
+#include "lis331_model.h"
+#include "melty_config.h"
+#include "config.h"
+#include "hal/hal.h"
+
+// melty_sim: the whole firmware, unmodified, spinning a simulated robot in closed loop
+// The chassis spins up and down on the average of what the two motors are doing, and gets pushed sideways by the difference.
+// The motors follow the DShot frames the hot loop sends, behind a first-order ESC lag. The accelerometers read back the
+// centripetal (and tangential, and translational) acceleration at wherever they really are, through the LIS331 model.
+// The controller's scripted: spin up, step between target RPMs with the left stick, then push forwards on the right.
+//
+// What comes out:
+// - RPM settling: how the real chassis RPM answers each step in the target - rise time, settling time, overshoot, and
+//   how far off it sits once it gets there
+// - heading drift: where the heading LED flashes, in the world, and how fast that wanders. A perfectly tracked robot's
+//   beacon stays put
+// - translation: which way the chassis actually gets pushed, compared to where the beacon says forwards is, and how
+//   much of the push the firmware asked for goes that way
+//
+// Everything runs on the host's virtual clock, so a minute of spinning takes well under a second.
+// Run with --help for the knobs - the firmware's tuning (PID gains, LED offset, accelerometer radius) goes in through
+// the stored config, as if it had been saved on the robot; the rest describe the robot itself.
+
+#define SIM_MAX_STEP_US 125                 // longest physics step - half a hot loop tick
+#define SIM_PACKET_INTERVAL_US 20000        // how often the gamepad sends a packet
+#define SIM_STICK_PULSE 400                 // how far the left stick gets pushed to step the target RPM
+#define SIM_SETTLED_PERCENT 5.0             // settled = within this % of the target, for good
+#define GRAVITY_MS2 9.80665
+
+// ------------ The robot -----------------------------
+
+// What the robot's really like - as opposed to what the firmware's been told
+typedef struct sim_robot_t {
+    float rpm_per_throttle;             // where the chassis settles, per unit of average throttle (out of 1000)
+    float spin_time_constant_s;         // how long it takes to get 2/3 of the way there
+    float esc_lag_ms;                   // how far behind the motors are, as a first-order lag
+    float accel_radius_cm;              // where the accelerometers really are
+    float noise_g;                      // accelerometer noise, per axis per read (standard deviation)
+    float push_per_throttle;            // translation, in m/s^2 per unit of throttle difference between the motors
+    float led_mount_deg;                // where the heading LED is, clockwise from motor 1
+} sim_robot_t;
+
+typedef struct chassis_t {
+    uint64_t at_us;
+    double angle;                       // radians, clockwise, unwrapped - the way motor 1 faces from the center
+    double rpm;
+    double rpm_per_s;
+    double push[2];                     // m/s^2 the motors are pushing the chassis with, in the world (x east, y north)
+    float commanded[2];                 // throttle (-1000 to 1000) out of the last DShot frame
+    float esc[2];                       // and what the motors are actually doing
+} chassis_t;
+
+static sim_robot_t robot_model;
+static chassis_t chassis;
+
+static host_lis331_t lis1;
+static host_lis331_t lis2;
+static std::mt19937 noise_source(1);
+
+// A direction, clockwise from north, as a unit vector
+static double east(double angle) {
+    return sin(angle);
+}
+
+static double north(double angle) {
+    return cos(angle);
+}
+
+static double wrap_angle(double angle) {
+    return angle - TWO_PI * floor(angle / TWO_PI + 0.5);
+}
+
+// ------------ Measurements --------------------------
+
+// A flash of the heading LED: where in the world it was centered
+typedef struct beacon_t {
+    double time_s;
+    double angle_deg;                   // unwrapped across the segment
+} beacon_t;
+
+// One stretch of the script, and everything measured over it
+typedef struct segment_t {
+    char name[32];
+    float from_rpm;
+    float target_rpm;
+    bool translating;
+    uint64_t started_us;
+    uint64_t measure_from_us;           // the second half - drift, steady state and translation are only measured once settled
+
+    // the RPM's response to the step
+    uint64_t rise_10_us;
+    uint64_t rise_90_us;
+    uint64_t last_outside_us;
+    bool ever_outside;
+    double peak_progress;
+    double steady_error_sum;
+    uint32_t steady_samples;
+
+    std::vector<beacon_t> beacons;
+
+    // translation, a rotation at a time
+    double along_beacon;                // push that went towards the beacon
+    double commanded;                   // push the firmware asked for, had the motors kept up
+    double direction_error_sum;
+    uint32_t rotations;
+} segment_t;
+
+static segment_t* active = nullptr;
+
+static bool beacon_lit = false;
+static double beacon_on_angle;
+static double beacon_angle = NAN;       // the latest beacon, in radians - the direction a driver thinks is forwards
+
+// the current rotation's push, the one the motors gave and the one they were asked for
+static double rotation_push[2];
+static double rotation_commanded[2];
+static double next_rotation_at = TWO_PI;
+
+static void observe_rpm(segment_t* seg, uint64_t now) {
+    double step = seg->target_rpm - seg->from_rpm;
+    double progress = (step != 0) ? (chassis.rpm - seg->from_rpm) / step : 1.0;
+
+    if (seg->rise_10_us == 0 && progress >= 0.1) {
+        seg->rise_10_us = now;
+    }
+    if (seg->rise_90_us == 0 && progress >= 0.9) {
+        seg->rise_90_us = now;
+    }
+    seg->peak_progress = fmax(seg->peak_progress, progress);
+
+    if (fabs(chassis.rpm - seg->target_rpm) > seg->target_rpm * SIM_SETTLED_PERCENT / 100) {
+        seg->last_outside_us = now;
+        seg->ever_outside = true;
+    }
+
+    if (now >= seg->measure_from_us) {
+        seg->steady_error_sum += (chassis.rpm - seg->target_rpm) / seg->target_rpm;
+        seg->steady_samples++;
+    }
+}
+
+// A whole rotation's gone by - which way did it push, next to the beacon?
+static void finish_rotation() {
+    if (active != nullptr && active->translating && host_now_us() >= active->measure_from_us && !isnan(beacon_angle)) {
+        double along = rotation_push[0] * east(beacon_angle) + rotation_push[1] * north(beacon_angle);
+        double pushed_angle = atan2(rotation_push[0], rotation_push[1]);
+
+        active->along_beacon += along;
+        active->commanded += hypot(rotation_commanded[0], rotation_commanded[1]);
+        active->direction_error_sum += wrap_angle(pushed_angle - beacon_angle);
+        active->rotations++;
+    }
+
+    rotation_push[0] = rotation_push[1] = 0;
+    rotation_commanded[0] = rotation_commanded[1] = 0;
+}
+
+// ------------ Physics -------------------------------
+
+static void chassis_step(double dt_s) {
+    // the motors chase their throttles - the hot loop sends a frame every tick, so dt's nearly always the same
+    static double lag_dt_s = -1;
+    static double lag;
+    if (dt_s != lag_dt_s) {
+        lag_dt_s = dt_s;
+        lag = (robot_model.esc_lag_ms > 0) ? 1 - exp(-dt_s * 1000 / robot_model.esc_lag_ms) : 1;
+    }
+    for (int motor = 0; motor < 2; motor++) {
+        chassis.esc[motor] += (chassis.commanded[motor] - chassis.esc[motor]) * lag;
+    }
+
+    // the average spins us, towards wherever that throttle settles
+    double settles_at = robot_model.rpm_per_throttle * (chassis.esc[0] + chassis.esc[1]) / 2;
+    double rpm_before = chassis.rpm;
+    chassis.rpm_per_s = (settles_at - chassis.rpm) / robot_model.spin_time_constant_s;
+    chassis.rpm += chassis.rpm_per_s * dt_s;
+    double angle_before = chassis.angle;
+    chassis.angle += (rpm_before + chassis.rpm) / 2 / 60 * TWO_PI * dt_s;
+
+    // and the difference pushes us sideways - both motors push clockwise, from opposite sides of the robot,
+    // so motor 1 pushes a quarter turn on from where it's facing, and motor 2 the opposite way
+    double push = robot_model.push_per_throttle * (chassis.esc[0] - chassis.esc[1]);
+    double commanded = robot_model.push_per_throttle * (chassis.commanded[0] - chassis.commanded[1]);
+    chassis.push[0] = chassis.push[1] = 0;
+
+    // which is nothing at all, until we're asked to translate
+    if (push != 0 || commanded != 0) {
+        double push_east;
+        double push_north;
+        sincos((angle_before + chassis.angle) / 2 + M_PI / 2, &push_east, &push_north);
+
+        chassis.push[0] = push * push_east;
+        chassis.push[1] = push * push_north;
+        rotation_push[0] += chassis.push[0] * dt_s;
+        rotation_push[1] += chassis.push[1] * dt_s;
+        rotation_commanded[0] += commanded * push_east * dt_s;
+        rotation_commanded[1] += commanded * push_north * dt_s;
+    }
+
+    if (chassis.angle >= next_rotation_at) {
+        next_rotation_at = TWO_PI * (floor(chassis.angle / TWO_PI) + 1);
+        finish_rotation();
+    }
+}
+
+// Brings the chassis up to now, whenever the firmware's about to see it or change it.
+// Throttles only change when the hot loop sends a frame, so there's nothing to gain from stepping more finely than that
+static void chassis_sync() {
+    uint64_t now = host_now_us();
+
+    while (chassis.at_us < now) {
+        uint64_t step_us = min(now - chassis.at_us, (uint64_t) SIM_MAX_STEP_US);
+        chassis_step(step_us / 1000000.0);
+        chassis.at_us += step_us;
+    }
+
+    if (active != nullptr) {
+        observe_rpm(active, now);
+    }
+}
+
+// What an accelerometer out at the real radius feels: x points out from the center, y the way it's going round
+static void accelerometer_read(void*, host_lis331_t* lis) {
+    chassis_sync();
+
+    double radius_m = robot_model.accel_radius_cm / 100;
+    double omega = chassis.rpm / 60 * TWO_PI;
+    double alpha = chassis.rpm_per_s / 60 * TWO_PI;
+
+    double outwards = chassis.angle;
+    double onwards = chassis.angle + M_PI / 2;
+    double push_out = chassis.push[0] * east(outwards) + chassis.push[1] * north(outwards);
+    double push_on = chassis.push[0] * east(onwards) + chassis.push[1] * north(onwards);
+
+    std::normal_distribution<float> noise(0.0f, robot_model.noise_g);
+    float x_g = (float) ((push_out - omega * omega * radius_m) / GRAVITY_MS2) + noise(noise_source);
+    float y_g = (float) ((push_on + alpha * radius_m) / GRAVITY_MS2) + noise(noise_source);
+    float z_g = 1.0f + noise(noise_source);
+
+    host_lis331_set_accel(lis, x_g, y_g, z_g);
+}
+
+// ------------ The firmware's outputs ----------------
+
+// The high part of each item's the longer one for a 1 - bidirectional DShot just has it second
+static uint32_t decode_bits(const rmt_item32_t* items, int count) {
+    uint32_t bits = 0;
+    for (int i = 0; i < count; i++) {
+        uint32_t high = items[i].level0 ? items[i].duration0 : items[i].duration1;
+        uint32_t low = items[i].level0 ? items[i].duration1 : items[i].duration0;
+        bits = (bits << 1) | (high > low ? 1 : 0);
+    }
+    return bits;
+}
+
+// A DShot frame's throttle, undoing perk2dshot(): 48-1047 forwards, 1049-2047 backwards, anything else stopped.
+// Frames with a bad CRC get ignored - returns false
+static bool decode_dshot(const rmt_item32_t* items, int count, float* throttle) {
+    if (count < 16) {
+        return false;
+    }
+
+    uint16_t packet = (uint16_t) decode_bits(items, 16);
+    uint16_t data = packet >> 4;
+    uint16_t crc = (data ^ (data >> 4) ^ (data >> 8)) & 0x0f;
+    if ((packet & 0x0f) != crc && (packet & 0x0f) != (~crc & 0x0f)) {
+        return false;
+    }
+
+    int value = packet >> 5;
+    if (value >= 48 && value <= 1047) {
+        *throttle = value - 48;
+    } else if (value >= 1049) {
+        *throttle = -(value - 1049);
+    } else {
+        *throttle = 0;
+    }
+    return true;
+}
+
+static void beacon_changed(bool lit) {
+    if (lit == beacon_lit) {
+        return;
+    }
+    beacon_lit = lit;
+
+    if (lit) {
+        beacon_on_angle = chassis.angle;
+        return;
+    }
+
+    // centered between where it came on and went off
+    double angle = (beacon_on_angle + chassis.angle) / 2 + robot_model.led_mount_deg * M_PI / 180;
+    beacon_angle = wrap_angle(angle);
+
+    if (active != nullptr && host_now_us() >= active->measure_from_us) {
+        double angle_deg = beacon_angle * 180 / M_PI;
+        if (!active->beacons.empty()) {
+            double previous = active->beacons.back().angle_deg;
+            angle_deg = previous + wrap_angle((angle_deg - previous) * M_PI / 180) * 180 / M_PI;
+        }
+        active->beacons.push_back({host_now_us() / 1000000.0, angle_deg});
+    }
+}
+
+// The hot loop sends both motors a frame every tick, but the throttle only changes every so often - so only decode what's new
+static void motor_frame(int motor, const rmt_item32_t* items, int item_count) {
+    static rmt_item32_t last_frame[2][16];
+
+    if (item_count < 16 || memcmp(items, last_frame[motor], sizeof(last_frame[motor])) == 0) {
+        return;
+    }
+
+    float throttle;
+    if (decode_dshot(items, item_count, &throttle)) {
+        chassis.commanded[motor] = throttle;
+        memcpy(last_frame[motor], items, sizeof(last_frame[motor]));
+    }
+}
+
+static void on_rmt_write(void*, rmt_channel_t channel, const rmt_item32_t* items, int item_count) {
+    chassis_sync();
+
+    if (channel == MOTOR_1_RMT) {
+        motor_frame(0, items, item_count);
+    } else if (channel == MOTOR_2_RMT) {
+        motor_frame(1, items, item_count);
+    } else if (channel == NEOPIXEL_RMT && item_count >= 24) {
+        beacon_changed(decode_bits(items, 24) != 0);
+    }
+}
+
+static void discard_serial(void*, const uint8_t*, size_t) {
+}
+
+// ------------ The script -----------------------------
+
+static host_gamepad_t gamepad;
+
+static void drive(uint64_t us) {
+    for (uint64_t elapsed = 0; elapsed < us; elapsed += SIM_PACKET_INTERVAL_US) {
+        host_gamepad_send(&gamepad);
+        host_run_for_us(min((uint64_t) SIM_PACKET_INTERVAL_US, us - elapsed));
+    }
+    chassis_sync();
+}
+
+// Runs one stretch of the script, measuring it. Steps the target RPM first, a stick flick per step
+static void run_segment(segment_t* seg, int steps, uint64_t us) {
+    seg->started_us = host_now_us();
+    seg->measure_from_us = seg->started_us + us / 2;
+    active = seg;
+
+    for (int i = 0; i < abs(steps); i++) {
+        // forwards on the stick is negative, and speeds up
+        gamepad.axis_y = (steps > 0) ? -SIM_STICK_PULSE : SIM_STICK_PULSE;
+        drive(SIM_PACKET_INTERVAL_US);
+        gamepad.axis_y = 0;
+        drive(SIM_PACKET_INTERVAL_US);
+    }
+
+    drive(seg->started_us + us - host_now_us());
+    active = nullptr;
+}
+
+// Least-squares slope of the beacon's angle, and the scatter about it
+static void fit_drift(const segment_t* seg, double* drift_deg_per_s, double* jitter_deg) {
+    size_t n = seg->beacons.size();
+    *drift_deg_per_s = NAN;
+    *jitter_deg = NAN;
+    if (n < 3) {
+        return;
+    }
+
+    double mean_t = 0, mean_a = 0;
+    for (const beacon_t& b : seg->beacons) {
+        mean_t += b.time_s / n;
+        mean_a += b.angle_deg / n;
+    }
+
+    double tt = 0, ta = 0;
+    for (const beacon_t& b : seg->beacons) {
+        tt += (b.time_s - mean_t) * (b.time_s - mean_t);
+        ta += (b.time_s - mean_t) * (b.angle_deg - mean_a);
+    }
+    double slope = (tt > 0) ? ta / tt : 0;
+
+    double squares = 0;
+    for (const beacon_t& b : seg->beacons) {
+        double residual = b.angle_deg - (mean_a + slope * (b.time_s - mean_t));
+        squares += residual * residual;
+    }
+
+    *drift_deg_per_s = slope;
+    *jitter_deg = sqrt(squares / n);
+}
+
+// ------------ Options -------------------------------
+
+typedef struct sim_option_t {
+    const char* name;
+    float* value;
+    const char* help;
+} sim_option_t;
+
+// the firmware's tuning - negative means leave it at melty_config.h's default
+static float kp = -1, ki = -1, kd = -1, led_offset_percent = -1, config_radius_cm = -1;
+
+static float segment_s = 4.0f;
+static float translate_s = 3.0f;
+static float translate_stick = 256;
+static float seed = 1;
+
+// pass/fail limits - negative means don't check
+static float max_settle_s = -1, max_overshoot_percent = -1, max_steady_error_percent = -1;
+static float max_drift_deg_per_s = -1, min_efficiency_percent = -1, max_direction_error_deg = -1;
+
+static sim_option_t options[] = {
+    {"--kp", &kp, "the spin PID gains, if not melty_config.h's"},
+    {"--ki", &ki, ""},
+    {"--kd", &kd, ""},
+    {"--led-offset", &led_offset_percent, "LED_OFFSET_PERCENT, if not melty_config.h's"},
+    {"--radius-cm", &config_radius_cm, "the accelerometer radius the firmware's told (default: the profile's)"},
+    {"--true-radius-cm", &robot_model.accel_radius_cm, "where the accelerometers really are (default: where the firmware thinks)"},
+    {"--esc-lag-ms", &robot_model.esc_lag_ms, "the motors' first-order lag behind their throttle"},
+    {"--rpm-per-throttle", &robot_model.rpm_per_throttle, "where the chassis settles, per unit of throttle"},
+    {"--spin-time-constant-s", &robot_model.spin_time_constant_s, "how quickly it gets there"},
+    {"--noise-g", &robot_model.noise_g, "accelerometer noise, standard deviation per axis"},
+    {"--push", &robot_model.push_per_throttle, "translation, m/s^2 per unit of throttle difference"},
+    {"--led-mount-deg", &robot_model.led_mount_deg, "where the LED is, clockwise from motor 1"},
+    {"--segment-s", &segment_s, "how long to hold each target RPM"},
+    {"--translate-s", &translate_s, "how long to push forwards for, at the last RPM"},
+    {"--stick", &translate_stick, "how far forwards to push the right stick (0-511)"},
+    {"--seed", &seed, "for the accelerometer noise"},
+    {"--max-settle-s", &max_settle_s, "fail if any step takes longer than this to settle"},
+    {"--max-overshoot", &max_overshoot_percent, "fail if any step overshoots by more than this %"},
+    {"--max-steady-error", &max_steady_error_percent, "fail if the RPM sits further than this % off the target"},
+    {"--max-drift", &max_drift_deg_per_s, "fail if the beacon drifts faster than this, in deg/s"},
+    {"--min-efficiency", &min_efficiency_percent, "fail if less than this % of the push goes where the beacon says"},
+    {"--max-direction-error", &max_direction_error_deg, "fail if the push goes further than this from the beacon, in deg"},
+};
+
+static void usage() {
+    printf("usage: melty_sim [--rpms 1200,600,1800,...] [--quick] [--verbose] [options]\n\n");
+    for (const sim_option_t& option : options) {
+        char value[16] = "-";
+        if (*option.value >= 0) {
+            snprintf(value, sizeof(value), "%.2f", *option.value);
+        }
+        printf("  %-24s %7s  %s\n", option.name, value, option.help);
+    }
+}
+
+static int rpm_index(const robot_config_t* config, int rpm) {
+    for (int i = 0; i < NUM_TARGET_RPMS; i++) {
+        if (config->spin_target_rpms[i] == rpm) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static double wall_s() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv) {
+    // a beetle, a bit less punchy than the firmware's spin model thinks, on a decent set of ESCs
+    robot_model.rpm_per_throttle = SPIN_MODEL_RPM_PER_THROTTLE * 0.9f;
+    robot_model.spin_time_constant_s = SPIN_MODEL_TIME_CONSTANT_S * 1.2f;
+    robot_model.esc_lag_ms = 4.0f;
+    robot_model.accel_radius_cm = -1;
+    robot_model.noise_g = 0.3f;
+    robot_model.push_per_throttle = 0.01f;
+    robot_model.led_mount_deg = 0;
+
+    std::vector<int> rpms = {1200, 600, 1800, 3000, 1200};
+    bool verbose = false;
+
+    for (int i = 1; i < argc; i++) {
+        bool known = false;
+
+        if (strcmp(argv[i], "--help") == 0) {
+            usage();
+            return 0;
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            verbose = known = true;
+        } else if (strcmp(argv[i], "--quick") == 0) {
+            rpms = {1200, 1800};
+            segment_s = 3.0f;
+            translate_s = 2.0f;
+            known = true;
+        } else if (strcmp(argv[i], "--rpms") == 0 && i + 1 < argc) {
+            rpms.clear();
+            for (char* rpm = strtok(argv[++i], ","); rpm != nullptr; rpm = strtok(nullptr, ",")) {
+                rpms.push_back(atoi(rpm));
+            }
+            known = !rpms.empty();
+        } else {
+            for (const sim_option_t& option : options) {
+                if (strcmp(argv[i], option.name) == 0 && i + 1 < argc) {
+                    *option.value = atof(argv[++i]);
+                    known = true;
+                }
+            }
+        }
+
+        if (!known) {
+            fprintf(stderr, "melty_sim: don't understand %s\n\n", argv[i]);
+            usage();
+            return 2;
+        }
+    }
+
+    // the firmware's tuning goes in as a stored config, as if it'd been saved on the robot
+    config_blob_t blob;
+    config_load_defaults(&blob);
+    robot_config_t* config = &blob.profiles[blob.active_profile];
+
+    if (kp >= 0) config->pid_kp = kp;
+    if (ki >= 0) config->pid_ki = ki;
+    if (kd >= 0) config->pid_kd = kd;
+    if (led_offset_percent >= 0) config->led_offset_percent = led_offset_percent;
+    if (config_radius_cm > 0) config->accelerometer_radius_cm = config_radius_cm;
+    if (robot_model.accel_radius_cm <= 0) robot_model.accel_radius_cm = config->accelerometer_radius_cm;
+
+    for (int rpm : rpms) {
+        if (rpm_index(config, rpm) < 0) {
+            fprintf(stderr, "melty_sim: %d isn't one of the profile's target RPMs\n", rpm);
+            return 2;
+        }
+    }
+    config->target_rpm_index = rpm_index(config, rpms[0]);
+    config_update_crc(&blob);
+
+    hal_nvs_begin("potatomelt");
+    hal_nvs_put_bytes("config", &blob, sizeof(blob));
+
+    noise_source.seed((uint32_t) seed);
+
+    printf("melty_sim: %s profile, PID %.2f/%.2f/%.2f, LED offset %.1f%%, accelerometers at %.2f cm (configured %.2f cm),\n"
+           "           ESC lag %.1f ms, %.2f RPM per throttle, spin time constant %.2f s, noise %.2f g\n\n",
+        config_profile_name(blob.active_profile), config->pid_kp, config->pid_ki, config->pid_kd, config->led_offset_percent,
+        robot_model.accel_radius_cm, config->accelerometer_radius_cm, robot_model.esc_lag_ms, robot_model.rpm_per_throttle,
+        robot_model.spin_time_constant_s, robot_model.noise_g);
+
+    // the robot's sitting still, level, on a full 4S battery
+    if (!verbose) {
+        host_serial_set_output(discard_serial, nullptr);
+    }
+    host_rmt_set_listener(on_rmt_write, nullptr);
+    host_lis331_attach(&lis1, 0x18);
+    host_lis331_attach(&lis2, 0x19);
+    lis1.before_read = lis2.before_read = accelerometer_read;
+    host_adc_set_millivolts(BATTERY_ADC_PIN, (uint32_t) (config->battery_cell_count * BATTERY_CELL_FULL_VOLTAGE / BATTERY_VOLTAGE_DIVIDER * 1000));
+
+    double started_wall_s = wall_s();
+
+    host_start_firmware();
+    host_run_for_us(1000000);
+
+    // connect, and hold the trigger
+    host_gamepad_connect();
+    drive(500000);
+    gamepad.throttle = 1023;
+
+    std::vector<segment_t> segments(rpms.size() + 1);
+    uint64_t segment_us = (uint64_t) (segment_s * 1000000);
+
+    for (size_t i = 0; i < rpms.size(); i++) {
+        segment_t* seg = &segments[i];
+        seg->from_rpm = (i == 0) ? 0 : rpms[i - 1];
+        seg->target_rpm = rpms[i];
+        snprintf(seg->name, sizeof(seg->name), "%s%d -> %d", (i == 0) ? "spin-up " : "", (int) seg->from_rpm, rpms[i]);
+
+        int steps = (i == 0) ? 0 : rpm_index(config, rpms[i]) - rpm_index(config, rpms[i - 1]);
+        run_segment(seg, steps, segment_us);
+    }
+
+    // then push forwards, at whatever we ended up at
+    segment_t* translation = &segments[rpms.size()];
+    translation->from_rpm = translation->target_rpm = rpms.back();
+    translation->translating = true;
+    snprintf(translation->name, sizeof(translation->name), "translate @ %d", rpms.back());
+    gamepad.axis_ry = (int) translate_stick;
+    run_segment(translation, 0, (uint64_t) (translate_s * 1000000));
+
+    double simulated_s = host_now_us() / 1000000.0;
+    double wall_elapsed_s = wall_s() - started_wall_s;
+
+    // and the report
+    bool passed = true;
+
+    printf("%-18s %9s %9s %9s %9s %10s %11s %9s\n", "", "rise", "settled", "overshoot", "steady", "RPM", "drift", "jitter");
+    printf("%-18s %9s %9s %9s %9s %10s %11s %9s\n", "", "10-90%", "within 5%", "", "error", "(actual)", "(deg/s)", "(deg)");
+
+    for (const segment_t& seg : segments) {
+        double settle_s = (seg.last_outside_us - seg.started_us) / 1000000.0;
+        double overshoot = fmax(0.0, seg.peak_progress - 1) * 100;
+        double steady_error = (seg.steady_samples > 0) ? seg.steady_error_sum / seg.steady_samples * 100 : NAN;
+        double drift, jitter;
+        fit_drift(&seg, &drift, &jitter);
+
+        bool is_step = seg.from_rpm != seg.target_rpm;
+        bool settled = !seg.ever_outside || seg.last_outside_us < seg.measure_from_us;
+
+        char rise[16] = "-";
+        char settle[16] = "never";
+        if (is_step && seg.rise_10_us != 0 && seg.rise_90_us != 0) {
+            snprintf(rise, sizeof(rise), "%.2f s", (seg.rise_90_us - seg.rise_10_us) / 1000000.0);
+        }
+        if (!is_step) {
+            strcpy(settle, "-");
+        } else if (settled) {
+            snprintf(settle, sizeof(settle), "%.2f s", seg.ever_outside ? settle_s : 0.0);
+        }
+
+        printf("%-18s %9s %9s %8.1f%% %8.1f%% %10.0f %11.2f %9.2f\n", seg.name, rise, settle, is_step ? overshoot : 0.0,
+            steady_error, seg.target_rpm * (1 + steady_error / 100), drift, jitter);
+
+        if (is_step && max_settle_s >= 0 && (!settled || settle_s > max_settle_s)) {
+            printf("  FAIL: took longer than %.2f s to settle\n", max_settle_s);
+            passed = false;
+        }
+        if (is_step && max_overshoot_percent >= 0 && overshoot > max_overshoot_percent) {
+            printf("  FAIL: overshot by more than %.1f%%\n", max_overshoot_percent);
+            passed = false;
+        }
+        if (max_steady_error_percent >= 0 && !(fabs(steady_error) <= max_steady_error_percent)) {
+            printf("  FAIL: sits more than %.1f%% off the target\n", max_steady_error_percent);
+            passed = false;
+        }
+        if (max_drift_deg_per_s >= 0 && !(fabs(drift) <= max_drift_deg_per_s)) {
+            printf("  FAIL: the beacon drifts faster than %.1f deg/s\n", max_drift_deg_per_s);
+            passed = false;
+        }
+    }
+
+    if (translation->rotations > 0 && translation->commanded > 0) {
+        double efficiency = translation->along_beacon / translation->commanded * 100;
+        double direction_error_deg = translation->direction_error_sum / translation->rotations * 180 / M_PI;
+
+        // the beacon follows LED_OFFSET_PERCENT round - this much more would put it right where we go
+        double suggested_offset = config->led_offset_percent + direction_error_deg / 3.6;
+
+        printf("\ntranslation, stick at %d: pushed %.1f deg clockwise of the beacon (LED offset %.1f%% would line them up),\n"
+               "                        %.0f%% of the push asked for went towards the beacon\n",
+            (int) translate_stick, direction_error_deg, suggested_offset, efficiency);
+
+        if (min_efficiency_percent >= 0 && efficiency < min_efficiency_percent) {
+            printf("  FAIL: less than %.0f%% of the push went towards the beacon\n", min_efficiency_percent);
+            passed = false;
+        }
+        if (max_direction_error_deg >= 0 && fabs(direction_error_deg) > max_direction_error_deg) {
+            printf("  FAIL: pushed more than %.1f deg off the beacon\n", max_direction_error_deg);
+            passed = false;
+        }
+    } else if (min_efficiency_percent >= 0 || max_direction_error_deg >= 0) {
+        printf("\ntranslation: never saw a whole rotation with the beacon lit\n  FAIL\n");
+        passed = false;
+    }
+
+    printf("\nsimulated %.1f s in %.2f s - %.0fx real time\n", simulated_s, wall_elapsed_s, simulated_s / wall_elapsed_s);
+
+    return passed ? 0 : 1;
+}
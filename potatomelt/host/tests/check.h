@@ -0,0 +1,40 @@
+#ifndef _CHECK_h
+#define _CHECK_h
+
+#include <math.h>
+#include <stdio.h>
+
+// Just enough of a test framework: a failed CHECK() is reported and counted, and the test carries on.
+// main() returns check_result(), so ctest sees the failure.
+
+static int check_failures = 0;
+
+#define CHECK(condition)                                                                \
+    do {                                                                                \
+        if (!(condition)) {                                                             \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            check_failures++;                                                           \
+        }                                                                               \
+    } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance)                                         \
+    do {                                                                                \
+        double actual_ = (actual);                                                      \
+        double expected_ = (expected);                                                  \
+        if (!(fabs(actual_ - expected_) <= (tolerance))) {                              \
+            fprintf(stderr, "%s:%d: %s is %g, expected %g +/- %g\n", __FILE__, __LINE__, \
+                #actual, actual_, expected_, (double) (tolerance));                     \
+            check_failures++;                                                           \
+        }                                                                               \
+    } while (0)
+
+static inline int check_result() {
+    if (check_failures > 0) {
+        fprintf(stderr, "%d check(s) failed\n", check_failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
+
+#endif
@@ -0,0 +1,59 @@
+#include <Wire.h>
+#include "check.h"
+#include "host.h"
+#include "lis331_model.h"
+#include "hal/hal.h"
+#include "subsystems/accelerometer.h"
+
+// What a read of the LIS331 costs on the bus: one auto-incrementing burst of all six output registers, rather than a
+// transaction per byte - and that the burst still lands every byte in the right axis.
+
+// start, address, register, repeated start, address, 6 bytes, stop - at 400kHz
+#define BURST_READ_BUS_US ((1 + 9 + 9 + 1 + 9 + 9 * 6 + 1) * 1000000 / 400000)
+
+static host_lis331_t lis;
+static Accelerometer accel;
+
+int main() {
+    Wire.setClock(400000);
+    host_lis331_attach(&lis, 0x18);
+    accel.init(0x18);
+    CHECK(host_lis331_full_scale_g(&lis) == 400);
+
+    // distinct values on every axis - a read that didn't auto-increment would see x's low byte six times over
+    host_lis331_set_accel(&lis, 30, -120, 1);
+    hal_i2c_reset_stats();
+    uint32_t reads_before = lis.reads;
+    uint32_t bytes_before = lis.bytes_read;
+
+    float xy_g;
+    float z_g;
+    bool saturated = accel.get_accel(&xy_g, &z_g);
+
+    hal_i2c_stats_t stats;
+    hal_i2c_get_stats(&stats);
+    CHECK(stats.transactions == 1);
+    CHECK(stats.busy_us == BURST_READ_BUS_US);
+    CHECK(lis.reads - reads_before == 1);
+    CHECK(lis.bytes_read - bytes_before == 6);
+
+    // a count is 400/2047 g
+    CHECK_NEAR(xy_g, sqrt(30 * 30 + 120 * 120), 0.3);
+    CHECK_NEAR(z_g, 1, 0.2);
+    CHECK(!saturated);
+
+    // the z axis and the xy magnitude come off the same burst, and so do the other getters
+    hal_i2c_reset_stats();
+    CHECK_NEAR(accel.get_xy_accel(), sqrt(30 * 30 + 120 * 120), 0.3);
+    CHECK_NEAR(accel.get_z_accel(), 1, 0.2);
+    hal_i2c_get_stats(&stats);
+    CHECK(stats.transactions == 2);
+
+    // pinned at the end of the range, either way round
+    host_lis331_set_accel(&lis, 0, -450, 1);
+    saturated = accel.get_accel(&xy_g, &z_g);
+    CHECK(saturated);
+    CHECK_NEAR(xy_g, 400, 0.3);
+
+    return check_result();
+}
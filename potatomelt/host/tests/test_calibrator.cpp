@@ -0,0 +1,87 @@
+#include "check.h"
+#include "host.h"
+#include "melty_config.h"
+#include "hal/hal.h"
+#include "subsystems/calibrator.h"
+
+// Auto-calibration against ESC telemetry, fed as run_calibration() feeds it: once a control tick, with a robot that
+// holds each target RPM exactly, and accelerometers that read 10% low. What matters is what happens when the
+// telemetry goes quiet - getMotorRPM() leaves the last reading behind, and none of that may end up in the curve.
+
+#define TICK_US (CONTROL_LOOP_INTERVAL_MS * 1000)
+#define ACCEL_CORRECTION 1.1f
+
+static const int targets[] = {1000, 2000};
+
+// when (in ticks since the run started) the telemetry's quiet, and whether the flag still claims it's valid
+typedef struct dropout_t {
+    int from_tick;
+    int to_tick;
+    bool still_valid;
+} dropout_t;
+
+// returns whether the run produced a curve
+static bool run(Calibrator* calibrator, const dropout_t* dropout, int* ticks) {
+    calibrator->start(targets, 2);
+
+    float reference_rpm = 0;
+    unsigned long reference_at_us = 0;
+
+    for (*ticks = 0; calibrator->is_running() && *ticks < 100000; (*ticks)++) {
+        float rpm = calibrator->get_target_rpm();
+        bool quiet = dropout != nullptr && *ticks >= dropout->from_tick && *ticks < dropout->to_tick;
+        bool valid = true;
+
+        if (!quiet) {
+            reference_rpm = rpm;
+            reference_at_us = hal_micros();
+        } else {
+            valid = dropout->still_valid;
+        }
+
+        if (calibrator->update(rpm / ACCEL_CORRECTION, false, reference_rpm, valid, reference_at_us, 0)) {
+            return true;
+        }
+        host_advance_us(TICK_US);
+    }
+    return false;
+}
+
+int main() {
+    Calibrator calibrator;
+    correction_curve_t curve;
+    int ticks;
+
+    // all the way through: both steps measured, each once settled
+    CHECK(run(&calibrator, nullptr, &ticks));
+    calibrator.get_curve(&curve);
+    CHECK_NEAR(correction_curve_get(&curve, 1000), ACCEL_CORRECTION, 1e-4);
+    CHECK_NEAR(correction_curve_get(&curve, 2000), ACCEL_CORRECTION, 1e-4);
+    const int ticks_per_step = AUTOCAL_SETTLE_MS / CONTROL_LOOP_INTERVAL_MS + AUTOCAL_SAMPLES_PER_STEP;
+    CHECK(ticks >= 2 * ticks_per_step && ticks <= 2 * ticks_per_step + 4);
+
+    // telemetry that's gone quiet for the whole second step - with the flag still claiming it's good, as it used to.
+    // Its reference is frozen at 1000 RPM, which would have made a correction of 0.55 at 2000. That step never
+    // measures, so only the first makes it into the curve
+    dropout_t frozen = {ticks_per_step + 1, 100000, true};
+    CHECK(run(&calibrator, &frozen, &ticks));
+    calibrator.get_curve(&curve);
+    CHECK_NEAR(correction_curve_get(&curve, 2000), ACCEL_CORRECTION, 1e-4);
+    CHECK(ticks >= ticks_per_step + AUTOCAL_STEP_TIMEOUT_MS / CONTROL_LOOP_INTERVAL_MS);
+
+    // a dropout partway through the second step's samples: what it had is thrown away, and it measures over once the
+    // telemetry's back - the frozen reading never gets in
+    int sampling_from = ticks_per_step + AUTOCAL_SETTLE_MS / CONTROL_LOOP_INTERVAL_MS + 2;
+    dropout_t blip = {sampling_from + AUTOCAL_SAMPLES_PER_STEP / 2, sampling_from + AUTOCAL_SAMPLES_PER_STEP / 2 + 20, false};
+    CHECK(run(&calibrator, &blip, &ticks));
+    calibrator.get_curve(&curve);
+    CHECK_NEAR(correction_curve_get(&curve, 2000), ACCEL_CORRECTION, 1e-4);
+    CHECK(ticks == blip.to_tick + AUTOCAL_SAMPLES_PER_STEP - 1);
+
+    // and no telemetry at all is no calibration - it gives up straight away
+    dropout_t none = {0, 100000, false};
+    CHECK(!run(&calibrator, &none, &ticks));
+    CHECK(ticks == 1);
+
+    return check_result();
+}
@@ -0,0 +1,95 @@
+#include <atomic>
+#include <thread>
+#include "check.h"
+#include "seqlock.h"
+#include "robot.h"
+
+// loop() hands the hot loop its commands across cores through a Seqlock<robot_command_t> - see publish_commands().
+// This plays both sides on real threads, built with ThreadSanitizer: TSan fails the test on any data race in the
+// handoff, and the hot loop side checks every command it picks up is one whole command - state and all - and never
+// an older one than it's already had.
+
+#define COMMANDS 300000
+
+static Seqlock<robot_command_t> robot_commands;
+static std::atomic<bool> publishing{true};
+
+// every field of command n follows from n
+static robot_command_t make_command(uint32_t n) {
+    robot_command_t command;
+    command.state = (robot_status) (n % (NO_CONTROLLER + 1));
+    command.spin.translate_fraction = (float) (n % 1000) / 1000;
+    command.spin.phase_rate = n;
+    command.spin.led_start = n * 3;
+    command.spin.led_stop = n * 3 + 1000;
+    command.spin.translate_phase = ~n;
+    command.spin.battery_percent = n % 101;
+    command.tank.translate_forback = (int) (n % 2001) - 1000;
+    command.tank.turn_lr = -command.tank.translate_forback;
+    command.tank.forback_power_scale = (float) (n % 100);
+    command.tank.turning_power_scale = (float) (n % 50);
+    command.input_received_at_us = n;
+    return command;
+}
+
+static bool command_whole(const robot_command_t* command) {
+    robot_command_t expected = make_command(command->input_received_at_us);
+    return command->state == expected.state
+        && command->spin.translate_fraction == expected.spin.translate_fraction
+        && command->spin.phase_rate == expected.spin.phase_rate
+        && command->spin.led_start == expected.spin.led_start
+        && command->spin.led_stop == expected.spin.led_stop
+        && command->spin.translate_phase == expected.spin.translate_phase
+        && command->spin.battery_percent == expected.spin.battery_percent
+        && command->tank.translate_forback == expected.tank.translate_forback
+        && command->tank.turn_lr == expected.tank.turn_lr
+        && command->tank.forback_power_scale == expected.tank.forback_power_scale
+        && command->tank.turning_power_scale == expected.tank.turning_power_scale;
+}
+
+static void loop_side() {
+    for (uint32_t n = 1; n <= COMMANDS; n++) {
+        robot_commands.write(make_command(n));
+    }
+    publishing = false;
+}
+
+static uint32_t reads = 0;
+static uint32_t torn = 0;
+static uint32_t backwards = 0;
+
+static void hotloop_side() {
+    unsigned long last_received_at_us = 0;
+
+    while (publishing) {
+        robot_command_t command;
+        robot_commands.read(&command);
+        reads++;
+
+        if (command.input_received_at_us != 0 && !command_whole(&command)) {
+            torn++;
+        }
+        if (command.input_received_at_us < last_received_at_us) {
+            backwards++;
+        }
+        last_received_at_us = command.input_received_at_us;
+    }
+}
+
+int main() {
+    std::thread hotloop(hotloop_side);
+    std::thread loop(loop_side);
+    loop.join();
+    hotloop.join();
+
+    printf("%u commands read, %u torn, %u out of order\n", reads, torn, backwards);
+    CHECK(reads > 0);
+    CHECK(torn == 0);
+    CHECK(backwards == 0);
+
+    robot_command_t last;
+    robot_commands.read(&last);
+    CHECK(last.input_received_at_us == COMMANDS && command_whole(&last));
+
+    return check_result();
+}
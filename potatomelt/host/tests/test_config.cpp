@@ -0,0 +1,129 @@
+#include "check.h"
+#include "host.h"
+#include "config.h"
+#include "melty_config.h"
+#include "hal/hal.h"
+#include "subsystems/imu.h"
+#include "subsystems/storage.h"
+
+// The stored config blob, across a reflash: a blob from the same melty_config.h comes back as it was, and one from
+// different defaults takes on the new tuning - but keeps what the robot's calibrated, learned and been told
+
+static void discard_serial(void*, const uint8_t*, size_t) {
+}
+
+static void store_blob(config_blob_t* blob) {
+    config_update_crc(blob);
+    hal_nvs_begin("potatomelt");
+    hal_nvs_put_bytes("config", blob, sizeof(config_blob_t));
+}
+
+// a blob as a robot would have it after a while: different tuning, and everything it's picked up along the way
+static void make_used_blob(config_blob_t* blob) {
+    config_load_defaults(blob);
+    blob->active_profile = PROFILE_BEETLE;
+
+    for (int p = 0; p < NUM_PROFILES; p++) {
+        robot_config_t* config = &blob->profiles[p];
+        config->led_offset_percent = LED_OFFSET_PERCENT + 10;
+        config->pid_kp = PID_KP * 2;
+        config->spin_target_rpms[0] = 700;
+        config->battery_cell_count = 6;
+
+        config->has_accel_correction_curve = true;
+        correction_curve_init(&config->accel_correction_curve, 1.1f + p * 0.1f);
+        correction_curve_init(&config->feed_forward_curve, 0.3f + p * 0.01f);
+        config->target_rpm_index = 5 + p;
+        config->trans_trim_index = 7 + p;
+    }
+}
+
+static void check_kept(const config_blob_t* used, const robot_config_t* config, int profile) {
+    const robot_config_t* before = &used->profiles[profile];
+    CHECK(config->has_accel_correction_curve);
+    for (int i = 0; i < CORRECTION_CURVE_KNOTS; i++) {
+        CHECK(config->accel_correction_curve.knots[i] == before->accel_correction_curve.knots[i]);
+        CHECK(config->feed_forward_curve.knots[i] == before->feed_forward_curve.knots[i]);
+    }
+    CHECK(config->target_rpm_index == before->target_rpm_index);
+    CHECK(config->trans_trim_index == before->trans_trim_index);
+}
+
+int main() {
+    host_serial_set_output(discard_serial, nullptr);
+
+    // nothing stored: the defaults
+    host_nvs_clear();
+    Storage fresh;
+    fresh.init();
+    CHECK(fresh.get_profile() == DEFAULT_PROFILE);
+    CHECK(fresh.get_config()->pid_kp == PID_KP);
+    CHECK(fresh.get_config()->led_offset_percent == LED_OFFSET_PERCENT);
+    CHECK(!fresh.get_config()->has_accel_correction_curve);
+
+    // stored from this melty_config.h: all of it comes back, and nothing needs writing
+    config_blob_t used;
+    make_used_blob(&used);
+    host_nvs_clear();
+    store_blob(&used);
+    uint32_t writes = host_nvs_write_count();
+
+    Storage same;
+    same.init();
+    CHECK(same.get_profile() == PROFILE_BEETLE);
+    CHECK(same.get_config()->pid_kp == PID_KP * 2);
+    CHECK(same.get_config()->led_offset_percent == LED_OFFSET_PERCENT + 10);
+    check_kept(&used, same.get_config(), PROFILE_BEETLE);
+    same.flush();
+    CHECK(host_nvs_write_count() == writes);
+
+    // stored from some other melty_config.h: both profiles take on its tuning, and keep their calibration
+    used.defaults_hash ^= 1;
+    host_nvs_clear();
+    store_blob(&used);
+    hal_nvs_put_float("a_cor_600", 1.5f);       // and a leftover from older firmware still, which mustn't come back
+    writes = host_nvs_write_count();
+
+    Storage changed;
+    changed.init();
+    CHECK(changed.get_profile() == PROFILE_BEETLE);
+    for (int p = PROFILE_BEETLE; p >= PROFILE_ANT; p--) {
+        changed.set_profile(p);
+        const robot_config_t* config = changed.get_config();
+        CHECK(config->pid_kp == PID_KP);
+        CHECK(config->led_offset_percent == LED_OFFSET_PERCENT);
+        CHECK(config->spin_target_rpms[0] == 600);
+        CHECK(config->battery_cell_count == (p == PROFILE_ANT ? ANT_BATTERY_CELL_COUNT : BEETLE_BATTERY_CELL_COUNT));
+        CHECK(config->accelerometer_radius_cm == (p == PROFILE_ANT ? ANT_ACCELEROMETER_RADIUS_CM : BEETLE_ACCELEROMETER_RADIUS_CM));
+        check_kept(&used, config, p);
+    }
+
+    IMU imu;
+    imu.load_accel_correction();
+    CHECK_NEAR(imu.get_trim(600), 1.1f, 1e-6);
+
+    // the update's written back once, and then it's settled
+    changed.set_profile(PROFILE_BEETLE);
+    changed.flush();
+    CHECK(host_nvs_write_count() == writes + 1);
+
+    Storage restarted;
+    restarted.init();
+    CHECK(restarted.get_config()->pid_kp == PID_KP);
+    check_kept(&used, restarted.get_config(), PROFILE_BEETLE);
+    restarted.flush();
+    CHECK(host_nvs_write_count() == writes + 1);
+
+    // a blob from an older CONFIG_VERSION can't be read at all: everything goes back to the defaults
+    used.version = CONFIG_VERSION - 1;
+    host_nvs_clear();
+    store_blob(&used);
+
+    Storage old;
+    old.init();
+    CHECK(old.get_profile() == DEFAULT_PROFILE);
+    CHECK(old.get_config()->pid_kp == PID_KP);
+    CHECK(!old.get_config()->has_accel_correction_curve);
+
+    return check_result();
+}
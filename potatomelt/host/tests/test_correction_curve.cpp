@@ -0,0 +1,123 @@
+#include "check.h"
+#include "host.h"
+#include "hal/hal.h"
+#include "subsystems/correction_curve.h"
+#include "subsystems/imu.h"
+#include "subsystems/storage.h"
+
+// The accelerometer correction curve: piecewise-linear across the whole RPM range, so the correction follows the
+// robot between the target RPMs rather than jumping at each one. Also kept in the config blob - and carried over
+// from the per-target-RPM trims older firmware saved.
+
+static void discard_serial(void*, const uint8_t*, size_t) {
+}
+
+// The most a curve moves between two RPMs step apart, anywhere in the range
+static float worst_step(const correction_curve_t* curve, float step) {
+    float worst = 0;
+    for (float rpm = 0; rpm < CORRECTION_CURVE_MAX_RPM + 500; rpm += step) {
+        worst = fmaxf(worst, fabsf(correction_curve_get(curve, rpm + step) - correction_curve_get(curve, rpm)));
+    }
+    return worst;
+}
+
+int main() {
+    host_serial_set_output(discard_serial, nullptr);
+
+    // knots are evenly spread over the range
+    CHECK(correction_curve_knot_rpm(0) == CORRECTION_CURVE_MIN_RPM);
+    CHECK(correction_curve_knot_rpm(CORRECTION_CURVE_KNOTS - 1) == CORRECTION_CURVE_MAX_RPM);
+
+    // flat is flat, everywhere - including off both ends
+    correction_curve_t curve;
+    correction_curve_init(&curve, 1.02f);
+    for (float rpm : {0.0f, 400.0f, 1234.0f, 3200.0f, 5000.0f}) {
+        CHECK_NEAR(correction_curve_get(&curve, rpm), 1.02f, 1e-6);
+    }
+
+    // exact at the knots, straight lines between them, and the end knots hold beyond the range
+    for (int i = 0; i < CORRECTION_CURVE_KNOTS; i++) {
+        curve.knots[i] = 1.0f + 0.01f * i * i;
+    }
+    for (int i = 0; i < CORRECTION_CURVE_KNOTS; i++) {
+        CHECK_NEAR(correction_curve_get(&curve, correction_curve_knot_rpm(i)), curve.knots[i], 1e-6);
+    }
+    for (int i = 0; i < CORRECTION_CURVE_KNOTS - 1; i++) {
+        float rpm = correction_curve_knot_rpm(i) + CORRECTION_CURVE_KNOT_SPACING_RPM * 0.25f;
+        CHECK_NEAR(correction_curve_get(&curve, rpm), curve.knots[i] * 0.75f + curve.knots[i + 1] * 0.25f, 1e-6);
+    }
+    CHECK_NEAR(correction_curve_get(&curve, 100), curve.knots[0], 1e-6);
+    CHECK_NEAR(correction_curve_get(&curve, 4000), curve.knots[CORRECTION_CURVE_KNOTS - 1], 1e-6);
+
+    // continuous: spinning up through the range, the correction never jumps - an RPM's step moves it no more than
+    // the steepest segment's slope says
+    float steepest = (curve.knots[CORRECTION_CURVE_KNOTS - 1] - curve.knots[CORRECTION_CURVE_KNOTS - 2]) / CORRECTION_CURVE_KNOT_SPACING_RPM;
+    CHECK(worst_step(&curve, 1.0f) <= steepest * 1.0f + 1e-5);
+
+    // fitting through measurements that lie on a line reproduces the line, between the knots the measurements span
+    float rpms[] = {600, 1000, 1500, 2100, 3000};
+    float corrections[5];
+    for (int i = 0; i < 5; i++) {
+        corrections[i] = 1.1f - rpms[i] * 0.00005f;
+    }
+    correction_curve_fit(&curve, rpms, corrections, 5);
+    for (float rpm = 750; rpm <= 2850; rpm += 50) {
+        CHECK_NEAR(correction_curve_get(&curve, rpm), 1.1f - rpm * 0.00005f, 1e-5);
+    }
+    // the knots beyond them hold the end measurements - so out at the measured ends, between a held knot and a
+    // fitted one, it's only close
+    CHECK_NEAR(correction_curve_get(&curve, 400), corrections[0], 1e-6);
+    CHECK_NEAR(correction_curve_get(&curve, 3200), corrections[4], 1e-6);
+    CHECK_NEAR(correction_curve_get(&curve, 600), corrections[0], 0.005);
+    CHECK_NEAR(correction_curve_get(&curve, 3000), corrections[4], 0.005);
+
+    // a trim only moves the two knots either side of it
+    correction_curve_init(&curve, 1.0f);
+    correction_curve_scale(&curve, 1300, 1.005f);
+    for (int i = 0; i < CORRECTION_CURVE_KNOTS; i++) {
+        bool neighbour = correction_curve_knot_rpm(i) == 1100 || correction_curve_knot_rpm(i) == 1450;
+        CHECK_NEAR(curve.knots[i], neighbour ? 1.005f : 1.0f, 1e-6);
+    }
+
+    // learning homes in on a value at one RPM, without dragging the far end of the curve along
+    correction_curve_init(&curve, 1.0f);
+    for (int i = 0; i < 200; i++) {
+        correction_curve_learn(&curve, 1300, 1.1f, 0.1f);
+    }
+    CHECK_NEAR(correction_curve_get(&curve, 1300), 1.1f, 1e-3);
+    CHECK_NEAR(correction_curve_get(&curve, 3000), 1.0f, 1e-6);
+
+    // Older firmware saved a trim per target RPM - those become the curve, the first time round
+    hal_nvs_begin("potatomelt");
+    hal_nvs_put_float("a_cor_600", 1.10f);
+    hal_nvs_put_float("a_cor_1800", 0.95f);
+
+    Storage store;
+    store.init();
+    CHECK(!store.get_accel_correction_curve(&curve));
+
+    // 1800 is a knot, so it's exact. 600 isn't, and sits between a held knot and a fitted one, as above
+    IMU imu;
+    imu.load_accel_correction();
+    CHECK_NEAR(imu.get_trim(1800), 0.95f, 1e-5);
+    CHECK_NEAR(imu.get_trim(3000), 0.95f, 1e-5);
+    CHECK_NEAR(imu.get_trim(600), 1.10f, 0.015);
+    CHECK_NEAR(imu.get_trim(400), 1.10f, 1e-5);
+
+    // and the curve's saved in the config blob, which comes back whole after a restart
+    imu.trim(true, 1200);
+    float trimmed = imu.get_trim(1200);
+    CHECK(store.get_accel_correction_curve(&curve));
+    store.flush();
+
+    Storage restarted;
+    restarted.init();
+    correction_curve_t reloaded;
+    CHECK(restarted.get_accel_correction_curve(&reloaded));
+    CHECK_NEAR(correction_curve_get(&reloaded, 1200), trimmed, 1e-6);
+    for (int i = 0; i < CORRECTION_CURVE_KNOTS; i++) {
+        CHECK(reloaded.knots[i] == curve.knots[i]);
+    }
+
+    return check_result();
+}
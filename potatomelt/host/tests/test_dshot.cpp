@@ -0,0 +1,135 @@
+#include <string.h>
+#include "check.h"
+#include "host.h"
+#include "lib/DShotRMT.h"
+
+// DShot frames off the nibble templates, bit for bit against a straightforward encoding of the spec:
+// 11 bits of throttle, the telemetry bit, then a 4 bit CRC - inverted for bidirectional - one RMT item per bit,
+// a 1 held high for 3/4 of the bit and a 0 for 3/8, and a pause item to finish.
+
+typedef struct mode_timing_t {
+    dshot_mode_t mode;
+    uint16_t ticks_per_bit;
+    uint16_t ticks_one_high;
+    uint16_t ticks_zero_high;
+} mode_timing_t;
+
+static const mode_timing_t timings[] = {
+    {DSHOT150, 64, 48, 24},
+    {DSHOT300, 32, 24, 12},
+    {DSHOT600, 16, 12, 6},
+    {DSHOT1200, 8, 6, 3},
+};
+
+static rmt_item32_t frame[DSHOT_PACKET_LENGTH];
+static int frame_length = 0;
+static uint32_t frames = 0;
+
+static void capture(void*, rmt_channel_t, const rmt_item32_t* items, int item_count) {
+    frame_length = item_count;
+    memcpy(frame, items, sizeof(rmt_item32_t) * min(item_count, DSHOT_PACKET_LENGTH));
+    frames++;
+}
+
+static uint16_t expected_packet(uint16_t throttle_value, bool bidirectional) {
+    uint16_t packet = throttle_value << 1;      // no telemetry request
+    uint16_t crc = (packet ^ (packet >> 4) ^ (packet >> 8)) & 0x0F;
+    if (bidirectional) {
+        crc = ~crc & 0x0F;
+    }
+    return (packet << 4) | crc;
+}
+
+// Checks the captured frame is exactly the spec's encoding of packet
+static bool frame_matches(uint16_t packet, const mode_timing_t* timing, bool bidirectional) {
+    if (frame_length != DSHOT_PACKET_LENGTH) {
+        return false;
+    }
+
+    for (int bit = 0; bit < DSHOT_PAUSE_BIT; bit++) {
+        bool is_one = packet & (0x8000 >> bit);
+        uint16_t high = is_one ? timing->ticks_one_high : timing->ticks_zero_high;
+        uint16_t low = timing->ticks_per_bit - high;
+        const rmt_item32_t& item = frame[bit];
+
+        // bidirectional frames are inverted: the line idles high, and each bit starts low
+        bool matches = bidirectional
+            ? (item.level0 == 0 && item.duration0 == low && item.level1 == 1 && item.duration1 == high)
+            : (item.level0 == 1 && item.duration0 == high && item.level1 == 0 && item.duration1 == low);
+        if (!matches) {
+            return false;
+        }
+    }
+
+    const rmt_item32_t& pause = frame[DSHOT_PAUSE_BIT];
+    return pause.duration0 == 0 && pause.duration1 == DSHOT_PAUSE && pause.level1 == (bidirectional ? 0 : 1);
+}
+
+static void check_every_throttle(DShotRMT* motor, const mode_timing_t* timing, bool bidirectional) {
+    int mismatches = 0;
+
+    for (uint16_t throttle = DSHOT_THROTTLE_MIN; throttle <= DSHOT_THROTTLE_MAX; throttle++) {
+        motor->sendThrottleValue(throttle);
+        if (!frame_matches(expected_packet(throttle, bidirectional), timing, bidirectional)) {
+            mismatches++;
+        }
+    }
+
+    motor->sendThrottleValue(0);
+    if (!frame_matches(expected_packet(0, bidirectional), timing, bidirectional)) {
+        mismatches++;
+    }
+
+    if (mismatches > 0) {
+        fprintf(stderr, "%s%s: %d frames wrong\n", dshot_mode_name[timing->mode], bidirectional ? " bidirectional" : "", mismatches);
+    }
+    CHECK(mismatches == 0);
+}
+
+int main() {
+    host_rmt_set_listener(capture, nullptr);
+
+    // every throttle value, in every mode, both ways round
+    for (const mode_timing_t& timing : timings) {
+        for (bool bidirectional : {false, true}) {
+            DShotRMT motor(GPIO_NUM_1, RMT_CHANNEL_1, RMT_CHANNEL_4);
+            motor.begin(timing.mode, bidirectional);
+            check_every_throttle(&motor, &timing, bidirectional);
+        }
+    }
+
+    // a couple of worked examples, from the spec: throttle 1046 is 10000010110 0 0110, and bidirectional is 1001
+    CHECK(expected_packet(1046, false) == 0b1000001011000110);
+    CHECK(expected_packet(1046, true) == 0b1000001011001001);
+
+    // out of range throttles are clamped to the ends of the range
+    DShotRMT motor(GPIO_NUM_1, RMT_CHANNEL_1);
+    motor.begin(DSHOT600, false);
+    motor.sendThrottleValue(10);
+    CHECK(frame_matches(expected_packet(DSHOT_THROTTLE_MIN, false), &timings[2], false));
+    motor.sendThrottleValue(5000);
+    CHECK(frame_matches(expected_packet(DSHOT_THROTTLE_MAX, false), &timings[2], false));
+
+    // an unchanged throttle skips the encoding, but still goes out - the ESC needs a steady stream of frames
+    motor.sendThrottleValue(1000);
+    uint32_t frames_before = frames;
+    for (int i = 0; i < 10; i++) {
+        motor.sendThrottleValue(1000);
+    }
+    CHECK(frames - frames_before == 10);
+    CHECK(frame_matches(expected_packet(1000, false), &timings[2], false));
+
+    // and the group sends both motors' frames, each with its own throttle
+    DShotRMT motor2(GPIO_NUM_2, RMT_CHANNEL_2);
+    motor2.begin(DSHOT600, false);
+    DShotRMTGroup group(motor, motor2);
+    CHECK(group.begin());
+
+    frames_before = frames;
+    group.sendThrottleValues(300, 1500);
+    CHECK(frames - frames_before == 2);
+    CHECK(frame_matches(expected_packet(1500, false), &timings[2], false));
+    CHECK(host_rmt_write_count(RMT_CHANNEL_2) == 1);
+
+    return check_result();
+}
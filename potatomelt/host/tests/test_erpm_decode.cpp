@@ -0,0 +1,261 @@
+#include <string.h>
+#include <random>
+#include <vector>
+#include "check.h"
+#include "host.h"
+#include "melty_config.h"
+#include "robot.h"
+#include "lib/DShotRMT.h"
+#include "subsystems/storage.h"
+
+// Bidirectional DShot telemetry: decoding the ESC's eRPM replies from what the RMT receiver captures.
+// The captures are built here from the spec, as an ESC would send them and the RMT would record them - a 12 bit
+// e-period and an inverted CRC, GCR coded, sent as level changes after a low start bit at 5/4 of the command bitrate,
+// then run-length coded into RMT items, ending where the line idles high. Each run's length can be jittered, as a real
+// ESC's clock would.
+// Built with DSHOT_BIDIRECTIONAL_ENABLED, so the robot's motors listen for telemetry too.
+
+#define TICKS_PER_BIT 16            // DSHOT600, at the RMT's 100ns clock
+#define ROBOT_TICKS_PER_BIT 32      // DSHOT300, as the robot runs its motors
+
+static std::mt19937 random_engine(1);
+
+// The 16 bit packet for an e-period, in microseconds - as a 3 bit shift and 9 bit mantissa - with its CRC
+static uint16_t erpm_packet(uint32_t period_us) {
+    uint16_t shift = 0;
+    while ((period_us >> shift) > 0x1FF) {
+        shift++;
+    }
+    uint16_t value = (shift << 9) | (period_us >> shift);
+    if (period_us == 0) {
+        value = DSHOT_ERPM_MAX_PERIOD;
+    }
+
+    uint16_t crc = ~(value ^ (value >> 4) ^ (value >> 8)) & 0x0F;
+    return (value << 4) | crc;
+}
+
+// What the receiver captures when the ESC sends packet. jitter is the most each run's length is off by, as a fraction
+static std::vector<rmt_item32_t> capture_reply(uint16_t packet, float jitter = 0, int ticks_per_bit = TICKS_PER_BIT) {
+    // GCR: each nibble becomes 5 bits
+    uint32_t gcr = 0;
+    for (int nibble = 3; nibble >= 0; nibble--) {
+        gcr = (gcr << 5) | GCR_encode[(packet >> (nibble * 4)) & 0x0F];
+    }
+
+    // the start bit is low, and every GCR 1 flips the line
+    std::vector<int> levels;
+    int level = 0;
+    levels.push_back(level);
+    for (int bit = 19; bit >= 0; bit--) {
+        if (gcr & (1 << bit)) {
+            level ^= 1;
+        }
+        levels.push_back(level);
+    }
+
+    // then run-length code it. Once the line goes high for the last time, it stays there - the receiver sees no more
+    // edges, and ends the capture with a zero-length item
+    std::vector<std::pair<int, uint32_t>> runs;
+    std::uniform_real_distribution<float> spread(-jitter, jitter);
+    for (size_t i = 0; i < levels.size();) {
+        size_t run_end = i;
+        while (run_end < levels.size() && levels[run_end] == levels[i]) {
+            run_end++;
+        }
+
+        if (run_end == levels.size() && levels[i] == 1) {
+            runs.push_back({1, 0});
+        } else {
+            float ticks = (run_end - i) * ticks_per_bit * 4 / 5.0f;
+            runs.push_back({levels[i], (uint32_t) lroundf(ticks * (1 + spread(random_engine)))});
+        }
+        i = run_end;
+    }
+    if (runs.back().first == 0) {
+        runs.push_back({1, 0});
+    }
+
+    std::vector<rmt_item32_t> items((runs.size() + 1) / 2);
+    memset(items.data(), 0, items.size() * sizeof(rmt_item32_t));
+    for (size_t i = 0; i < runs.size(); i++) {
+        if (i % 2 == 0) {
+            items[i / 2].level0 = runs[i].first;
+            items[i / 2].duration0 = runs[i].second;
+        } else {
+            items[i / 2].level1 = runs[i].first;
+            items[i / 2].duration1 = runs[i].second;
+        }
+    }
+    return items;
+}
+
+static dshot_erpm_exit_mode_t decode(const std::vector<rmt_item32_t>& items, uint32_t& erpm) {
+    return DShotRMT::decodeERPM(items.data(), items.size(), TICKS_PER_BIT, erpm);
+}
+
+// Our own outgoing frames, as the receiver sees them on the shared wire
+Storage store;
+Robot robot;
+
+static void discard_serial(void*, const uint8_t*, size_t) {
+}
+
+// both ESCs reply, or just one
+static void motors_reply(uint32_t period_us, bool motor2_too = true) {
+    std::vector<rmt_item32_t> reply = capture_reply(erpm_packet(period_us), 0, ROBOT_TICKS_PER_BIT);
+    host_rmt_receive(MOTOR_1_RX_RMT, reply.data(), reply.size());
+    if (motor2_too) {
+        host_rmt_receive(MOTOR_2_RX_RMT, reply.data(), reply.size());
+    }
+}
+
+// a hot loop tick, then what it published
+static bool tick_and_read(float* motor_rpm) {
+    spin_control_parameters_t spin = {};
+    tank_control_parameters_t tank = {};
+    robot.update_loop(READY, &spin, &tank);
+    host_advance_us(1000000 / HOTLOOP_FREQ_HZ);
+
+    float motor2_rpm;
+    return robot.get_motor_rpms(motor_rpm, &motor2_rpm);
+}
+
+static std::vector<rmt_item32_t> last_sent;
+
+static void capture_sent(void*, rmt_channel_t, const rmt_item32_t* items, int item_count) {
+    last_sent.assign(items, items + item_count);
+}
+
+// Through a motor's receive channel - the robot's, as it happens, so this is done with them before the robot starts
+static void check_receive_channel() {
+    uint32_t erpm;
+
+    // Nothing's arrived yet
+    host_rmt_set_listener(capture_sent, nullptr);
+    DShotRMT motor(GPIO_NUM_1, RMT_CHANNEL_1, RMT_CHANNEL_4);
+    motor.begin(DSHOT600, true);
+    CHECK(motor.getMotorRPM(erpm) == ERR_NO_PACKETS);
+
+    // the receiver hears our own frame go out too, before the reply - that's skipped, and the reply picked up
+    motor.sendThrottleValue(1000);
+    host_rmt_receive(RMT_CHANNEL_4, last_sent.data(), last_sent.size());
+    std::vector<rmt_item32_t> reply = capture_reply(erpm_packet(428));
+    host_rmt_receive(RMT_CHANNEL_4, reply.data(), reply.size());
+    CHECK(motor.getMotorRPM(erpm) == DECODE_SUCCESS);
+    CHECK(erpm == 60000000 / 428);
+
+    // with nothing new, we keep the last reading
+    CHECK(motor.getMotorRPM(erpm) == ERR_EMPTY_QUEUE);
+    CHECK(erpm == 60000000 / 428);
+
+    // with several replies waiting, the newest wins
+    for (uint32_t period_us : {400, 390, 380}) {
+        reply = capture_reply(erpm_packet(period_us));
+        host_rmt_receive(RMT_CHANNEL_4, reply.data(), reply.size());
+    }
+    CHECK(motor.getMotorRPM(erpm) == DECODE_SUCCESS);
+    CHECK(erpm == 60000000 / 380);
+
+    // only bad replies: say so, but keep the last good reading
+    reply = capture_reply(erpm_packet(300) ^ 1);
+    host_rmt_receive(RMT_CHANNEL_4, reply.data(), reply.size());
+    CHECK(motor.getMotorRPM(erpm) == ERR_CHECKSUM_FAIL);
+    CHECK(erpm == 60000000 / 380);
+
+    // and a motor that isn't bidirectional has no telemetry to give
+    DShotRMT plain(GPIO_NUM_2, RMT_CHANNEL_2);
+    plain.begin(DSHOT600, false);
+    CHECK(plain.getMotorRPM(erpm) == ERR_BIDIRECTION_DISABLED);
+    host_rmt_set_listener(nullptr, nullptr);
+}
+
+int main() {
+    // every e-period the packet can hold exactly, from the fastest to the slowest - bar the very slowest, which
+    // means stopped
+    int wrong = 0;
+    for (uint32_t shift = 0; shift < 8; shift++) {
+        for (uint32_t mantissa = (shift == 0) ? 1 : 256; mantissa <= ((shift == 7) ? 0x1FE : 0x1FF); mantissa++) {
+            uint32_t period_us = mantissa << shift;
+            uint32_t erpm = 0;
+            if (decode(capture_reply(erpm_packet(period_us)), erpm) != DECODE_SUCCESS || erpm != 60000000 / period_us) {
+                wrong++;
+            }
+        }
+    }
+    CHECK(wrong == 0);
+
+    // a stopped motor reports the longest period there is, which is 0 eRPM
+    uint32_t erpm = 12345;
+    CHECK(decode(capture_reply(erpm_packet(0)), erpm) == DECODE_SUCCESS);
+    CHECK(erpm == 0);
+
+    // an ESC's clock isn't ours: runs up to 10% long or short still decode
+    wrong = 0;
+    for (int i = 0; i < 10000; i++) {
+        uint32_t period_us = (256 + random_engine() % 256) << (random_engine() % 7);
+        if (decode(capture_reply(erpm_packet(period_us), 0.10f), erpm) != DECODE_SUCCESS || erpm != 60000000 / period_us) {
+            wrong++;
+        }
+    }
+    CHECK(wrong == 0);
+
+    // a flipped bit fails the CRC, or the GCR
+    int accepted = 0;
+    for (int bit = 0; bit < 16; bit++) {
+        uint16_t packet = erpm_packet(428) ^ (1 << bit);
+        if (decode(capture_reply(packet), erpm) == DECODE_SUCCESS) {
+            accepted++;
+        }
+    }
+    CHECK(accepted == 0);
+
+    // GCR codes that don't decode to anything are rejected outright: 0b00000 is never sent
+    std::vector<rmt_item32_t> flat(1);
+    flat[0].level0 = 0;
+    flat[0].duration0 = TICKS_PER_BIT * 4 / 5 * 21;
+    flat[0].level1 = 1;
+    flat[0].duration1 = 0;
+    CHECK(decode(flat, erpm) == ERR_CHECKSUM_FAIL);
+
+    // and nothing at all is no packet
+    std::vector<rmt_item32_t> empty(1);
+    memset(empty.data(), 0, sizeof(rmt_item32_t));
+    CHECK(decode(empty, erpm) == ERR_NO_PACKETS);
+    CHECK(DShotRMT::decodeERPM(nullptr, 0, TICKS_PER_BIT, erpm) == ERR_NO_PACKETS);
+
+    check_receive_channel();
+
+    // And through the robot. The telemetry's only valid while both ESCs keep replying
+    host_serial_set_output(discard_serial, nullptr);
+    store.init();
+    robot.init();
+
+    float motor_rpm;
+    CHECK(!tick_and_read(&motor_rpm));
+    motors_reply(428);
+    CHECK(tick_and_read(&motor_rpm));
+    CHECK_NEAR(motor_rpm, (60000000 / 428) / (float) MOTOR_POLE_PAIRS, 0.01);
+
+    // an ESC going quiet for a few frames is fine - getMotorRPM() just says there's nothing new
+    int valid_ticks = 0;
+    while (tick_and_read(&motor_rpm) && valid_ticks < 100) {
+        valid_ticks++;
+    }
+    CHECK(valid_ticks == MOTOR_RPM_TIMEOUT_US / (1000000 / HOTLOOP_FREQ_HZ));
+
+    // but once it's been quiet for longer, the last reading's stale: still there, but not valid
+    CHECK_NEAR(motor_rpm, (60000000 / 428) / (float) MOTOR_POLE_PAIRS, 0.01);
+    CHECK(!tick_and_read(&motor_rpm));
+
+    // one ESC back isn't enough
+    motors_reply(400, false);
+    CHECK(!tick_and_read(&motor_rpm));
+    CHECK_NEAR(motor_rpm, (60000000 / 400) / (float) MOTOR_POLE_PAIRS, 0.01);
+
+    // both are
+    motors_reply(400);
+    CHECK(tick_and_read(&motor_rpm));
+
+    return check_result();
+}
@@ -0,0 +1,104 @@
+#include <string>
+#include "check.h"
+#include "host.h"
+#include "lis331_model.h"
+#include "melty_config.h"
+#include "lib/DShotRMT.h"
+
+// Boots the whole sketch on the host, and drives it through the states a real session goes through:
+// no controller, connected and ready, spinning, and the failsafe once the packets stop
+
+static host_lis331_t lis1;
+static host_lis331_t lis2;
+
+static std::string serial_output;
+static uint32_t motor_frames[2];
+static int motor_throttles[2];
+
+static void capture_serial(void*, const uint8_t* data, size_t len) {
+    serial_output.append((const char*) data, len);
+}
+
+// The throttle out of a DShot frame: 11 bits of throttle, the telemetry bit and the CRC, most significant bit first.
+// A one's high (or for bidirectional, low) for longer than it isn't
+static int dshot_throttle(const rmt_item32_t* items) {
+    uint16_t packet = 0;
+    for (int bit = 0; bit < 16; bit++) {
+        packet = (packet << 1) | (items[bit].duration0 > items[bit].duration1 ? 1 : 0);
+    }
+    return packet >> 5;
+}
+
+static void on_rmt_write(void*, rmt_channel_t channel, const rmt_item32_t* items, int) {
+    int motor = (channel == MOTOR_1_RMT) ? 0 : (channel == MOTOR_2_RMT) ? 1 : -1;
+    if (motor >= 0) {
+        motor_frames[motor]++;
+        motor_throttles[motor] = dshot_throttle(items);
+    }
+}
+
+static void send_packets(int throttle, uint64_t for_us) {
+    host_gamepad_t gamepad = {};
+    gamepad.throttle = throttle;
+
+    for (uint64_t elapsed = 0; elapsed < for_us; elapsed += 20000) {
+        host_gamepad_send(&gamepad);
+        host_run_for_us(20000);
+    }
+}
+
+int main() {
+    host_serial_set_output(capture_serial, nullptr);
+    host_rmt_set_listener(on_rmt_write, nullptr);
+
+    // a robot sitting still and level, on a full 4S battery
+    host_lis331_attach(&lis1, 0x18);
+    host_lis331_attach(&lis2, 0x19);
+    host_lis331_set_accel(&lis1, 0, 0, 1);
+    host_lis331_set_accel(&lis2, 0, 0, 1);
+    host_adc_set_millivolts(BATTERY_ADC_PIN, (uint32_t) (4 * 4.2 / BATTERY_VOLTAGE_DIVIDER * 1000));
+
+    host_start_firmware();
+    host_run_for_us(1000000);
+
+    CHECK(serial_output.find("PotatoMelt startup") != std::string::npos);
+    CHECK(serial_output.find("Config: nothing valid stored") != std::string::npos);
+
+    // both the LIS331s got set up for 400g
+    CHECK(host_lis331_full_scale_g(&lis1) == 400);
+    CHECK(host_lis331_full_scale_g(&lis2) == 400);
+
+    // the hot loop's sending both motors a frame every tick - and with no controller, they're stopped
+    // setup() takes a while with the accelerometers' warmup, so count over a second once it's done
+    uint32_t frames_before = motor_frames[0];
+    host_run_for_us(1000000);
+    CHECK_NEAR(motor_frames[0] - frames_before, HOTLOOP_FREQ_HZ, HOTLOOP_FREQ_HZ / 100);
+    CHECK(motor_frames[0] == motor_frames[1]);
+    CHECK(motor_throttles[0] == 0 && motor_throttles[1] == 0);
+
+    // the sampler's reading both accelerometers at its own rate, a burst read each
+    uint32_t reads_before = lis1.reads;
+    host_run_for_us(1000000);
+    CHECK_NEAR(lis1.reads - reads_before, ACCELEROMETER_SAMPLE_RATE_HZ, ACCELEROMETER_SAMPLE_RATE_HZ / 100 + 1);
+
+    // connect, and hold the trigger down - we should spin up
+    host_gamepad_connect();
+    send_packets(1023, 1000000);
+
+    CHECK(motor_throttles[0] > DSHOT_THROTTLE_MIN && motor_throttles[1] > DSHOT_THROTTLE_MIN);
+
+    // let go, and we stop
+    send_packets(0, 200000);
+    CHECK(motor_throttles[0] == 0 && motor_throttles[1] == 0);
+
+    // hold it down again, then stop sending anything - the failsafe kicks in, and stops the motors
+    send_packets(1023, 500000);
+    CHECK(motor_throttles[0] > 0);
+    host_run_for_us((CONTROL_UPDATE_TIMEOUT_MS + 500) * 1000);
+    CHECK(motor_throttles[0] == 0 && motor_throttles[1] == 0);
+
+    // and the status line's still coming out, every half second
+    CHECK(serial_output.find("Hot loop: ticks:") != std::string::npos);
+
+    return check_result();
+}
@@ -0,0 +1,58 @@
+#include "check.h"
+#include "host.h"
+#include "latency_histogram.h"
+
+// The input latency histograms: fed a known spread of latencies, the p50 and p99 they report land within a bucket of
+// the real ones. The buckets have to be narrow enough for that to mean something - input polls at 1kHz, so these
+// latencies are all under a millisecond or so.
+
+static void discard_serial(void*, const uint8_t*, size_t) {
+}
+
+int main() {
+    host_serial_set_output(discard_serial, nullptr);
+
+    CHECK(LATENCY_HISTOGRAM_BUCKET_US <= 50);
+    CHECK(LATENCY_HISTOGRAM_BUCKET_US * LATENCY_HISTOGRAM_BUCKETS >= 2000);
+
+    // evenly spread over the first millisecond, one sample per microsecond
+    LatencyHistogram even("even");
+    for (int n = 0; n < 1000; n++) {
+        even.record(n);
+    }
+    CHECK(even.samples() == 1000);
+    CHECK_NEAR(even.percentile(1000, 0.50f), 500, LATENCY_HISTOGRAM_BUCKET_US);
+    CHECK_NEAR(even.percentile(1000, 0.99f), 990, LATENCY_HISTOGRAM_BUCKET_US);
+
+    // mostly quick, with a slow tail - 900 samples across 200-300us, 100 across 1500-2000us
+    LatencyHistogram tail("tail");
+    for (int n = 0; n < 900; n++) {
+        tail.record(200 + n / 9);
+    }
+    for (int n = 0; n < 100; n++) {
+        tail.record(1500 + n * 5);
+    }
+    CHECK_NEAR(tail.percentile(1000, 0.50f), 200 + 500 / 9, LATENCY_HISTOGRAM_BUCKET_US);
+    CHECK_NEAR(tail.percentile(1000, 0.99f), 1500 + 90 * 5, LATENCY_HISTOGRAM_BUCKET_US);
+
+    // all the same - the percentiles can't stray past what was actually seen
+    LatencyHistogram steady("steady");
+    for (int n = 0; n < 1000; n++) {
+        steady.record(420);
+    }
+    CHECK(steady.percentile(1000, 0.50f) == 420);
+    CHECK(steady.percentile(1000, 0.99f) == 420);
+
+    // anything past the last bucket lands in it, and the max still comes from what was seen
+    LatencyHistogram slow("slow");
+    slow.record(100);
+    slow.record(50000);
+    CHECK(slow.percentile(2, 0.99f) <= 50000);
+    CHECK(slow.percentile(2, 0.99f) >= LATENCY_HISTOGRAM_BUCKET_US * (LATENCY_HISTOGRAM_BUCKETS - 1));
+
+    // reports start counting afresh
+    tail.report();
+    CHECK(tail.samples() == 0);
+
+    return check_result();
+}
@@ -0,0 +1,102 @@
+#include <string.h>
+#include "check.h"
+#include "host.h"
+#include "melty_config.h"
+#include "subsystems/led.h"
+
+// The LED encoding: every color LED sends goes out as exactly the RMT items the old bit-at-a-time encoder built, for
+// all NEOPIXEL_COUNT pixels - and it only goes out when the color changes, whichever of its two buffers it comes from.
+
+#define PIXEL_ITEMS (NEOPIXEL_COUNT * 24)
+
+static rmt_item32_t sent[PIXEL_ITEMS];
+static int sent_count = 0;
+
+static void capture_rmt(void*, rmt_channel_t channel, const rmt_item32_t* items, int item_count) {
+    if (channel != NEOPIXEL_RMT) {
+        return;
+    }
+    sent_count = item_count;
+    memcpy(sent, items, (item_count < PIXEL_ITEMS ? item_count : PIXEL_ITEMS) * sizeof(rmt_item32_t));
+}
+
+// The old encoder, as LED::write_pixel() had it - a bit at a time, green, red then blue - for every pixel in the chain
+static void encode_per_bit(int red, int green, int blue, rmt_item32_t* items) {
+    uint8_t pixel_color[3] = { (uint8_t) green, (uint8_t) red, (uint8_t) blue };
+    int index = 0;
+    for (int pixel = 0; pixel < NEOPIXEL_COUNT; pixel++) {
+        for (auto chan : pixel_color) {
+            for (int bit = 7; bit >= 0; bit--) {
+                items[index].level0 = 1;
+                items[index].duration0 = ((chan >> bit) & 1) ? 8 : 4;
+                items[index].level1 = 0;
+                items[index].duration1 = ((chan >> bit) & 1) ? 4 : 8;
+                index++;
+            }
+        }
+    }
+}
+
+// whether the last thing sent was that color, item for item
+static bool sent_color(int red, int green, int blue) {
+    rmt_item32_t expected[PIXEL_ITEMS];
+    encode_per_bit(red, green, blue, expected);
+
+    if (sent_count != PIXEL_ITEMS) {
+        return false;
+    }
+    for (int i = 0; i < PIXEL_ITEMS; i++) {
+        if (sent[i].val != expected[i].val) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    host_rmt_set_listener(capture_rmt, nullptr);
+    LED leds;
+
+    // every step of the battery gradient, as the beacon shows it
+    for (int color = 0; color <= 100; color++) {
+        uint32_t writes = host_rmt_write_count(NEOPIXEL_RMT);
+        leds.leds_on_gradient(color);
+        CHECK(host_rmt_write_count(NEOPIXEL_RMT) == writes + 1);
+
+        int green = (color > 50) ? 255 : 255 * color / 50;
+        int red = (color < 50) ? 255 : 255 * (100 - color) / 50;
+        CHECK(sent_color(red, green, 0));
+    }
+
+    leds.leds_on_ready();
+    CHECK(sent_color(0, 0, 255));
+    leds.leds_on_low_battery();
+    CHECK(sent_color(255, 0, 0));
+    leds.leds_off();
+    CHECK(sent_color(0, 0, 0));
+
+    // the same color again doesn't bother the RMT
+    uint32_t writes = host_rmt_write_count(NEOPIXEL_RMT);
+    leds.leds_off();
+    leds.leds_off();
+    CHECK(host_rmt_write_count(NEOPIXEL_RMT) == writes);
+
+    // flipping between the beacon and off, as while spinning, sends each change from whichever buffer has it
+    for (int i = 0; i < 10; i++) {
+        leds.leds_on_gradient(75);
+        CHECK(sent_color(127, 255, 0));
+        leds.leds_off();
+        CHECK(sent_color(0, 0, 0));
+    }
+    CHECK(host_rmt_write_count(NEOPIXEL_RMT) == writes + 20);
+
+    // and a new color in the middle of that still comes out right
+    leds.leds_on_gradient(20);
+    CHECK(sent_color(255, 102, 0));
+    leds.leds_off();
+    CHECK(sent_color(0, 0, 0));
+    leds.leds_on_gradient(75);
+    CHECK(sent_color(127, 255, 0));
+
+    return check_result();
+}
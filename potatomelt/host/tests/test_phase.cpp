@@ -0,0 +1,115 @@
+#include "check.h"
+#include "host.h"
+#include "lis331_model.h"
+#include "robot.h"
+#include "melty_config.h"
+#include "subsystems/storage.h"
+
+// The hot loop's rotation phase: integrated every tick in fixed point, so however long a tick takes - even several
+// rotations' worth - no phase is lost, and a new rotation rate is slewed to rather than jumped to.
+// Drives Robot::update_loop() by hand, and reads the phase back out of the flight record.
+
+#define TICK_US (1000000 / HOTLOOP_FREQ_HZ)
+
+Storage store;
+Robot robot;
+
+static host_lis331_t lis1;
+static host_lis331_t lis2;
+
+static spin_control_parameters_t spin = {};
+static tank_control_parameters_t tank = {};
+
+static uint32_t rate_for_rpm(float rpm) {
+    return (uint32_t) (rpm * PHASE_PER_ROTATION / (60.0 * 1000 * 1000));
+}
+
+static void tick(robot_status state, uint32_t us) {
+    host_advance_us(us);
+    robot.update_loop(state, &spin, &tank);
+}
+
+static uint32_t phase() {
+    flight_record_t record;
+    robot.fill_flight_record(&record);
+    return record.phase;
+}
+
+static uint32_t phase_rate() {
+    flight_record_t record;
+    robot.fill_flight_record(&record);
+    return record.phase_rate;
+}
+
+static void discard_serial(void*, const uint8_t*, size_t) {
+}
+
+int main() {
+    host_serial_set_output(discard_serial, nullptr);
+    host_lis331_attach(&lis1, 0x18);
+    host_lis331_attach(&lis2, 0x19);
+    store.init();
+    robot.init();
+
+    // spin up to 1500 RPM, and let the ramp finish
+    spin.phase_rate = rate_for_rpm(1500);
+    for (int i = 0; i < PHASE_RATE_RAMP_US / TICK_US + 1; i++) {
+        tick(SPINNING, TICK_US);
+    }
+    CHECK(phase_rate() == spin.phase_rate);
+
+    // at a steady rate, each tick moves the phase on by exactly rate * time
+    uint32_t before = phase();
+    tick(SPINNING, TICK_US);
+    CHECK(phase() - before == spin.phase_rate * TICK_US);
+
+    // a 54ms stall at 3000 RPM is 2.7 rotations: the phase still ends up exactly where the rate says - 0.7 of a
+    // rotation on - rather than losing track after the first wrap
+    spin.phase_rate = rate_for_rpm(3000);
+    for (int i = 0; i < PHASE_RATE_RAMP_US / TICK_US + 1; i++) {
+        tick(SPINNING, TICK_US);
+    }
+    before = phase();
+    tick(SPINNING, 54000);
+    CHECK(phase() - before == (uint32_t) (spin.phase_rate * 54000ULL));
+    CHECK_NEAR((uint32_t) (phase() - before) / PHASE_PER_ROTATION, 0.7, 0.001);
+
+    // a stall longer than the 32 bit phase * rate product can hold still comes out right, mod a rotation
+    before = phase();
+    tick(SPINNING, 1000000);
+    CHECK(phase() - before == (uint32_t) (spin.phase_rate * 1000000ULL));
+
+    // a new rate is slewed to over PHASE_RATE_RAMP_US: halfway there halfway through, and the phase it covers on the
+    // way is the average of the two rates'. The ramp starts on the first tick that sees the new rate
+    uint32_t from_rate = spin.phase_rate;
+    spin.phase_rate = rate_for_rpm(1000);
+    tick(SPINNING, TICK_US);
+
+    double rotations = 0;
+    uint32_t last_phase = phase();
+
+    for (unsigned long us = TICK_US; us <= PHASE_RATE_RAMP_US; us += TICK_US) {
+        tick(SPINNING, TICK_US);
+        rotations += (uint32_t) (phase() - last_phase) / PHASE_PER_ROTATION;
+        last_phase = phase();
+
+        if (us == PHASE_RATE_RAMP_US / 2) {
+            CHECK_NEAR(phase_rate(), ((double) from_rate + spin.phase_rate) / 2, 1);
+        }
+    }
+    double expected_rotations = ((double) from_rate + spin.phase_rate) / 2 * PHASE_RATE_RAMP_US / PHASE_PER_ROTATION;
+    CHECK(phase_rate() == spin.phase_rate);
+    // the rate's updated at the end of each tick, so the phase runs a half tick's rate change behind the ideal ramp
+    CHECK_NEAR(rotations, expected_rotations, ((double) from_rate - spin.phase_rate) * TICK_US / PHASE_PER_ROTATION);
+
+    // and stopping spinning ramps the rate down to nothing, after which the phase stays put
+    for (int i = 0; i < PHASE_RATE_RAMP_US / TICK_US + 1; i++) {
+        tick(READY, TICK_US);
+    }
+    CHECK(phase_rate() == 0);
+    before = phase();
+    tick(READY, 100000);
+    CHECK(phase() == before);
+
+    return check_result();
+}
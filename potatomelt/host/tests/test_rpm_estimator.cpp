@@ -0,0 +1,162 @@
+#include <math.h>
+#include <random>
+#include "check.h"
+#include "melty_config.h"
+#include "subsystems/rpm_estimator.h"
+
+// The RPM estimator against simulated traces, fed as IMU::update_estimate() feeds it - at the sensor rate - and
+// scored against the accelerometer RPM on its own, which is all we had before it.
+// The robot spins up as a first-order lag on the throttle. The accelerometers read the true RPM plus noise, and pin at
+// their 400g limit - about 2640 RPM on the beetle. The ESCs, when we have them, are noisier still.
+
+#define SAMPLE_DT_S (1.0f / ACCELEROMETER_SAMPLE_RATE_HZ)
+#define ACCEL_SATURATED_RPM 2640.0f
+#define ACCEL_NOISE_RPM ESTIMATOR_ACCEL_RPM_STDDEV
+#define MOTOR_NOISE_RPM ESTIMATOR_MOTOR_RPM_STDDEV
+
+typedef struct robot_model_t {
+    float rpm_per_throttle;
+    float time_constant_s;
+    bool motor_rpm;             // do we have ESC telemetry?
+} robot_model_t;
+
+// How a stretch of trace went: RMS and worst error, for the estimate and for the raw accelerometer RPM
+typedef struct trace_score_t {
+    double estimate_rms;
+    double estimate_worst;
+    double accel_rms;
+    double accel_worst;
+    double confidence;          // the estimate's, at the end
+    double rpm_per_s;
+    double true_rpm_per_s;
+} trace_score_t;
+
+typedef struct trace_t {
+    robot_model_t model;
+    RPMEstimator estimator;
+    float rpm;
+    std::mt19937 random_engine;
+} trace_t;
+
+// Runs a trace at a fixed throttle for duration_s, scoring everything after settle_s
+static trace_score_t run(trace_t* trace, int throttle, float duration_s, float settle_s) {
+    std::normal_distribution<float> accel_noise(0, ACCEL_NOISE_RPM);
+    std::normal_distribution<float> motor_noise(0, MOTOR_NOISE_RPM);
+    trace_score_t score = {};
+    double estimate_sum = 0;
+    double accel_sum = 0;
+    int scored = 0;
+
+    for (float t = 0; t < duration_s; t += SAMPLE_DT_S) {
+        float true_rpm_per_s = (throttle * trace->model.rpm_per_throttle - trace->rpm) / trace->model.time_constant_s;
+        trace->rpm += true_rpm_per_s * SAMPLE_DT_S;
+
+        bool saturated = trace->rpm >= ACCEL_SATURATED_RPM;
+        float accel_rpm = fminf(trace->rpm, ACCEL_SATURATED_RPM) + accel_noise(trace->random_engine);
+
+        trace->estimator.predict(SAMPLE_DT_S);
+        trace->estimator.update_accel_rpm(accel_rpm, saturated);
+        if (trace->model.motor_rpm) {
+            trace->estimator.update_motor_rpm(trace->rpm + motor_noise(trace->random_engine));
+        }
+        trace->estimator.update_throttle(throttle);
+
+        rpm_estimate_t estimate;
+        trace->estimator.get_estimate(&estimate);
+
+        if (t >= settle_s) {
+            double estimate_error = fabs(estimate.rpm - trace->rpm);
+            double accel_error = fabs(accel_rpm - trace->rpm);
+            estimate_sum += estimate_error * estimate_error;
+            accel_sum += accel_error * accel_error;
+            score.estimate_worst = fmax(score.estimate_worst, estimate_error);
+            score.accel_worst = fmax(score.accel_worst, accel_error);
+            scored++;
+        }
+
+        score.confidence = estimate.confidence;
+        score.rpm_per_s = estimate.rpm_per_s;
+        score.true_rpm_per_s = true_rpm_per_s;
+    }
+
+    score.estimate_rms = sqrt(estimate_sum / scored);
+    score.accel_rms = sqrt(accel_sum / scored);
+    return score;
+}
+
+static void start(trace_t* trace, robot_model_t model) {
+    trace->model = model;
+    trace->estimator.reset();
+    trace->rpm = 0;
+    trace->random_engine.seed(1);
+}
+
+static void print(const char* name, trace_score_t* score) {
+    printf("%-40s estimate %6.1f RMS %6.1f worst   accelerometer %6.1f RMS %6.1f worst   confidence %.2f\n",
+        name, score->estimate_rms, score->estimate_worst, score->accel_rms, score->accel_worst, score->confidence);
+}
+
+int main() {
+    const robot_model_t matched = {SPIN_MODEL_RPM_PER_THROTTLE, SPIN_MODEL_TIME_CONSTANT_S, false};
+    trace_t trace;
+
+    // Steady at 1200 RPM, accelerometers only: much less noisy than they are
+    start(&trace, matched);
+    int throttle_1200 = (int) (1200 / matched.rpm_per_throttle);
+    run(&trace, throttle_1200, 3.0f, 3.0f);
+    trace_score_t score = run(&trace, throttle_1200, 5.0f, 0.0f);
+    print("steady 1200, accelerometers", &score);
+    CHECK(score.estimate_rms < score.accel_rms / 2);
+    CHECK(score.estimate_worst < score.accel_worst / 2);
+    CHECK(score.confidence > 0.5);
+
+    // Spinning up to 2000: keeps up, without lagging far behind the way a plain low-pass filter would - and knows
+    // we're accelerating
+    int throttle_2000 = (int) (2000 / matched.rpm_per_throttle);
+    score = run(&trace, throttle_2000, 0.2f, 0.0f);
+    print("spinning up 1200 -> 2000, accelerometers", &score);
+    CHECK(score.estimate_rms < ACCEL_NOISE_RPM);
+    CHECK_NEAR(score.rpm_per_s, score.true_rpm_per_s, score.true_rpm_per_s * 0.25);
+
+    // Past the accelerometers' range, at 3000: they're pinned, but the throttle model carries on
+    int throttle_3000 = (int) (3000 / matched.rpm_per_throttle);
+    run(&trace, throttle_3000, 3.0f, 3.0f);
+    score = run(&trace, throttle_3000, 2.0f, 0.0f);
+    print("saturated at 3000, accelerometers", &score);
+    CHECK(score.accel_rms > 300);
+    CHECK(score.estimate_rms < 50);
+    CHECK(score.confidence < 0.2);      // but it knows it's only guessing
+
+    // A robot that doesn't match the throttle model - 10% weaker, and slower - is off by the mismatch when the
+    // accelerometers are pinned. With ESC telemetry, that's corrected
+    const robot_model_t weak = {SPIN_MODEL_RPM_PER_THROTTLE * 0.9f, SPIN_MODEL_TIME_CONSTANT_S * 1.2f, false};
+    int throttle_weak_3000 = (int) (3000 / weak.rpm_per_throttle);
+    start(&trace, weak);
+    run(&trace, throttle_weak_3000, 4.0f, 4.0f);
+    score = run(&trace, throttle_weak_3000, 2.0f, 0.0f);
+    print("saturated at 3000, mismatched model", &score);
+    CHECK(score.estimate_rms > 200);
+
+    robot_model_t weak_with_telemetry = weak;
+    weak_with_telemetry.motor_rpm = true;
+    start(&trace, weak_with_telemetry);
+    run(&trace, throttle_weak_3000, 4.0f, 4.0f);
+    score = run(&trace, throttle_weak_3000, 2.0f, 0.0f);
+    print("saturated at 3000, mismatched, with ESCs", &score);
+    CHECK(score.estimate_rms < 30);
+    CHECK(score.confidence > 0.5);
+
+    // and with nothing to go on but the throttle, confidence drains away
+    RPMEstimator blind;
+    blind.update_accel_rpm(1500, false);
+    for (int i = 0; i < 2 * ACCELEROMETER_SAMPLE_RATE_HZ; i++) {
+        blind.predict(SAMPLE_DT_S);
+        blind.update_accel_rpm(0, true);
+        blind.update_throttle(throttle_1200);
+    }
+    rpm_estimate_t estimate;
+    blind.get_estimate(&estimate);
+    CHECK(estimate.confidence < score.confidence / 2);
+
+    return check_result();
+}
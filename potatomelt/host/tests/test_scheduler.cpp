@@ -0,0 +1,123 @@
+#include <vector>
+#include "check.h"
+#include "host.h"
+#include "scheduler.h"
+
+// Replays the hot loop's timing on the virtual clock: every tick "works" for a set time, then waits for the next.
+// With nothing else going on, every wakeup is bang on its deadline - so any lateness, overrun or skipped deadline
+// below is exactly what the scheduler made of the work we gave it.
+
+#define RATE_HZ 4000
+#define PERIOD_US (1000000 / RATE_HZ)
+#define TICK_WORK_US 40
+
+static Scheduler scheduler;
+static uint32_t stall_next_tick_us = 0;         // the next tick works this much longer, once
+static std::vector<unsigned long> deadlines;
+
+static void loop_task(void*) {
+    scheduler.init(RATE_HZ);
+
+    while (true) {
+        deadlines.push_back(scheduler.wait_for_tick());
+
+        host_advance_us(TICK_WORK_US + stall_next_tick_us);
+        stall_next_tick_us = 0;
+    }
+}
+
+// A higher priority task on a 1kHz timer that holds the CPU for a while, every 4th hot loop tick
+static uint32_t interference_us = 0;
+
+static void interfering_task(void*) {
+    Scheduler interference;
+    interference.init(RATE_HZ / 4);
+
+    while (true) {
+        interference.wait_for_tick();
+        host_advance_us(interference_us);
+    }
+}
+
+static scheduler_stats_t run_and_reset(uint64_t us) {
+    scheduler.reset_stats();
+    deadlines.clear();
+    host_run_for_us(us);
+
+    scheduler_stats_t stats;
+    scheduler.get_stats(&stats, true);
+    return stats;
+}
+
+static bool deadlines_evenly_spaced() {
+    for (size_t i = 1; i < deadlines.size(); i++) {
+        if (deadlines[i] - deadlines[i - 1] != PERIOD_US) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    xTaskCreatePinnedToCore(loop_task, "hotloop", 10000, NULL, 1, NULL, 0);
+    xTaskCreatePinnedToCore(interfering_task, "interference", 4096, NULL, 2, NULL, 0);
+    host_run_for_us(1000);
+
+    // a steady second: every deadline met, exactly a period apart
+    scheduler_stats_t stats = run_and_reset(1000000);
+    CHECK(stats.ticks == RATE_HZ);
+    CHECK(stats.overruns == 0);
+    CHECK(stats.max_lateness_us == 0);
+    CHECK(stats.mean_lateness_us == 0);
+    CHECK(deadlines_evenly_spaced());
+
+    // one tick runs 2.4 periods: the timer's fired twice by the time it's done, so we go straight round for the second
+    // of those - 100us late - and the deadline in between is skipped and counted as an overrun
+    stall_next_tick_us = PERIOD_US * 2 + PERIOD_US * 2 / 5 - TICK_WORK_US;
+    stats = run_and_reset(PERIOD_US * 5);
+    CHECK(stats.overruns == 1);
+    CHECK(stats.max_lateness_us == 100);
+    CHECK(deadlines.size() == 4);
+    if (deadlines.size() == 4) {
+        CHECK(deadlines[1] - deadlines[0] == 2 * PERIOD_US);
+        CHECK(deadlines[2] - deadlines[1] == PERIOD_US);
+        CHECK(deadlines[3] - deadlines[2] == PERIOD_US);
+    }
+
+    // and the deadlines carry on from where they were, rather than from when we got round to it
+    stats = run_and_reset(100000);
+    CHECK(stats.overruns == 0);
+    CHECK(stats.max_lateness_us == 0);
+    CHECK(deadlines_evenly_spaced());
+
+    // a stall of exactly 8 periods: 7 deadlines missed outright, and we pick up right on the 8th
+    stall_next_tick_us = PERIOD_US * 8 - TICK_WORK_US;
+    stats = run_and_reset(PERIOD_US * 12);
+    CHECK(stats.overruns == 7);
+    CHECK(stats.max_lateness_us == 0);
+    CHECK(stats.ticks == 12 - 7);
+
+    // a higher priority task holding the CPU for 80us, every 4th tick: that's jitter, not overruns
+    interference_us = 80;
+    stats = run_and_reset(1000000);
+    CHECK(stats.ticks == RATE_HZ);
+    CHECK(stats.overruns == 0);
+    CHECK(stats.max_lateness_us == 80);
+    CHECK(stats.mean_lateness_us == 80 / 4);
+    CHECK(deadlines_evenly_spaced());
+
+    // holding it for longer than a period costs the tick it lands on, too - and the lateness is then counted from the
+    // deadline we do run for, the next one along
+    interference_us = PERIOD_US + 50;
+    stats = run_and_reset(1000000);
+    CHECK(stats.overruns == RATE_HZ / 4);
+    CHECK(stats.max_lateness_us == 50);
+    CHECK(stats.ticks == RATE_HZ - RATE_HZ / 4);
+    interference_us = 0;
+
+    // and reading with reset starts the stats afresh
+    scheduler.get_stats(&stats, false);
+    CHECK(stats.ticks == 0);
+
+    return check_result();
+}
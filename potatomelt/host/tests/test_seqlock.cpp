@@ -0,0 +1,107 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "check.h"
+#include "seqlock.h"
+#include "subsystems/imu.h"
+
+// Hammers the accelerometer sample mailbox from real threads: one writer publishing as fast as it can, and several
+// readers checking every sample they get is whole - every field from the same write - and never older than the last.
+
+#define WRITES 2000000
+#define READERS 3
+
+static Seqlock<imu_sample_t> mailbox;
+static std::atomic<bool> writing{true};
+
+// every field of sample n follows from n, so a sample stitched together from two writes gives itself away
+static imu_sample_t make_sample(uint32_t n) {
+    imu_sample_t sample;
+    sample.timestamp_us = n;
+    sample.lis1_g = (float) (n % 1000000);
+    sample.lis2_g = -sample.lis1_g;
+    sample.z_g = (float) (n % 7);
+    sample.rpm = (float) (n % 1000000) / 2;
+    sample.saturated = n & 1;
+    return sample;
+}
+
+static bool sample_whole(const imu_sample_t* sample) {
+    imu_sample_t expected = make_sample(sample->timestamp_us);
+    return sample->lis1_g == expected.lis1_g && sample->lis2_g == expected.lis2_g && sample->z_g == expected.z_g
+        && sample->rpm == expected.rpm && sample->saturated == expected.saturated;
+}
+
+typedef struct reader_result_t {
+    uint32_t reads;
+    uint32_t torn;
+    uint32_t backwards;
+    uint32_t mismatched_sequence;   // the sequence number read() hands back doesn't go with the sample
+} reader_result_t;
+
+static void writer() {
+    for (uint32_t n = 1; n <= WRITES; n++) {
+        mailbox.write(make_sample(n));
+    }
+    writing = false;
+}
+
+static void reader(reader_result_t* result) {
+    unsigned long last_timestamp = 0;
+
+    while (writing) {
+        imu_sample_t sample;
+        uint32_t seq = mailbox.read(&sample);
+        result->reads++;
+
+        if (!sample_whole(&sample)) {
+            result->torn++;
+        }
+        if (sample.timestamp_us < last_timestamp) {
+            result->backwards++;
+        }
+        if (seq != sample.timestamp_us) {
+            result->mismatched_sequence++;
+        }
+        last_timestamp = sample.timestamp_us;
+    }
+}
+
+int main() {
+    // nothing written yet: an all-zero value, sequence 0
+    Seqlock<imu_sample_t> fresh;
+    imu_sample_t sample = make_sample(12345);
+    CHECK(fresh.read(&sample) == 0);
+    CHECK(sample.timestamp_us == 0 && sample.rpm == 0);
+
+    // each write moves the sequence on by one
+    fresh.write(make_sample(5));
+    uint32_t seq = 0;
+    CHECK(fresh.try_read(&sample, &seq));
+    CHECK(seq == 1 && sample.timestamp_us == 5 && sample_whole(&sample));
+
+    reader_result_t results[READERS] = {};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < READERS; i++) {
+        threads.emplace_back(reader, &results[i]);
+    }
+    threads.emplace_back(writer);
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    for (int i = 0; i < READERS; i++) {
+        printf("reader %d: %u reads, %u torn, %u out of order\n", i, results[i].reads, results[i].torn, results[i].backwards);
+        CHECK(results[i].reads > 0);
+        CHECK(results[i].torn == 0);
+        CHECK(results[i].backwards == 0);
+        CHECK(results[i].mismatched_sequence == 0);
+    }
+
+    // and once the writer's done, everyone sees its last write
+    CHECK(mailbox.read(&sample) == WRITES);
+    CHECK(sample.timestamp_us == WRITES && sample_whole(&sample));
+
+    return check_result();
+}
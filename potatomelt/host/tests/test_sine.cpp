@@ -0,0 +1,57 @@
+#include <math.h>
+#include <stdint.h>
+#include "check.h"
+#include "sine_table.h"
+
+// sine_scale(): the translation throttle's sine, off the fixed point table - against the real thing
+
+#define PHASE_PER_ROTATION 4294967296.0
+
+static double radians(uint32_t phase) {
+    return phase / PHASE_PER_ROTATION * 2 * M_PI;
+}
+
+int main() {
+    // the table is what its header says it is
+    for (int i = 0; i < (1 << SINE_TABLE_BITS); i++) {
+        CHECK(sine_table[i] == (int16_t) lround(32767 * sin(2 * M_PI * i / (1 << SINE_TABLE_BITS))));
+    }
+
+    // within a table step of sin() anywhere in the rotation - the phase is truncated to 1/256th of a turn, and
+    // the shift rounds down a count
+    const int amplitude = 1000;
+    const double step_error = amplitude * 2 * M_PI / (1 << SINE_TABLE_BITS) + 1;
+    double worst = 0;
+    uint32_t phase = 12345;
+    for (int i = 0; i < 100000; i++) {
+        phase = phase * 1664525 + 1013904223;
+        worst = fmax(worst, fabs(sine_scale(phase, amplitude) - amplitude * sin(radians(phase))));
+    }
+    CHECK(worst <= step_error);
+
+    // and at the start of each step, where the truncation costs nothing, it's within the shift's count, and the
+    // table's own rounding
+    for (int i = 0; i < (1 << SINE_TABLE_BITS); i++) {
+        uint32_t step = (uint32_t) i << SINE_TABLE_SHIFT;
+        CHECK_NEAR(sine_scale(step, amplitude), amplitude * sin(radians(step)), 1 + amplitude / 32767.0);
+    }
+
+    // the landmarks: nothing at 0 and half a turn, full push a quarter turn in, full pull three quarters in
+    CHECK(sine_scale(0, amplitude) == 0);
+    CHECK(sine_scale(0x80000000u, amplitude) == 0);
+    CHECK_NEAR(sine_scale(0x40000000u, amplitude), amplitude, 1);
+    CHECK_NEAR(sine_scale(0xC0000000u, amplitude), -amplitude, 1);
+
+    // half a turn on is the same push the other way - so the two motors, half a turn apart, mirror each other
+    // and a negative amplitude (spinning backwards) just flips it
+    for (uint32_t p = 0; p < 0x80000000u; p += 0x00fedcbau) {
+        CHECK_NEAR(sine_scale(p + 0x80000000u, amplitude), -sine_scale(p, amplitude), 1);
+        CHECK_NEAR(sine_scale(p, -amplitude), -sine_scale(p, amplitude), 1);
+    }
+
+    // the hot loop never asks for more than full throttle, but there's room for a lot more before the multiply overflows
+    CHECK_NEAR(sine_scale(0x40000000u, 65535), 65535, 2);
+    CHECK_NEAR(sine_scale(0xC0000000u, 65535), -65535, 2);
+
+    return check_result();
+}
@@ -0,0 +1,111 @@
+#include <Arduino.h>
+#include <string.h>
+#include <vector>
+#include "check.h"
+#include "host.h"
+#include "flight_recorder.h"
+#include "telemetry.h"
+
+// Sends one of everything the robot puts on the wire through the real framing, and checks the bytes against the capture
+// tools/tests/test_telemetry_decode.py decodes - so the decoder's tested against what the firmware actually sends.
+// If the framing or a payload changes on purpose, regenerate the capture with "test_telemetry --write", and update the
+// decoder and its test to match.
+
+static std::vector<uint8_t> wire;
+
+static void capture_serial(void*, const uint8_t* data, size_t len) {
+    wire.insert(wire.end(), data, data + len);
+}
+
+static void send_everything() {
+    // the odd line printed around the frames, as setup() does
+    Serial.print("PotatoMelt starting\r\n");
+
+    telemetry_status_t status = {};
+    status.timestamp_ms = 123456;
+    status.state = 0;               // SPINNING
+    status.profile = 1;             // beetle
+    status.flags = TELEMETRY_STATUS_CONNECTED | TELEMETRY_STATUS_ALIVE | TELEMETRY_STATUS_SPIN_REQUESTED;
+    status.battery_percent = 87;
+    status.accel_correction = 1.25f;
+    status.rpm_estimate = 1487.5f;
+    status.rpm_per_s = -12.5f;
+    status.rpm_confidence = 0.75f;
+    status.motor1_rpm = 0;
+    status.motor2_rpm = 0;
+    status.hotloop_ticks = 2000;
+    status.hotloop_overruns = 3;
+    status.hotloop_mean_lateness_us = 7;
+    status.hotloop_max_lateness_us = 180;
+    status.dropped_frames = 0;
+    status.target_rpm = 1500;
+    status.i2c_transactions_per_sample = 2;
+    status.i2c_busy_us_per_sample = 420;
+    CHECK(telemetry_send(TELEMETRY_STATUS, &status, sizeof(status)));
+
+    flight_record_t records[3] = {};
+    for (int i = 0; i < 3; i++) {
+        records[i].timestamp_us = 1000000 + i * 250;
+        records[i].phase = 0x40000000u * i;
+        records[i].phase_rate = 107374;     // 1500 RPM
+        records[i].motor1_throttle = 600 + i;
+        records[i].motor2_throttle = -600 - i;
+        records[i].lateness_us = i * 10;
+        records[i].estimated_rpm = 1490 + i;
+        records[i].state = 0;
+        records[i].battery_percent = 87;
+        records[i].flags = i % 2;
+    }
+    CHECK(telemetry_send(TELEMETRY_FLIGHT_RECORDS, records, sizeof(records)));
+
+    CHECK(telemetry_send_text("Flight recorder: 3 records"));
+
+    // as log.cpp's write_line() sends a LOG() message
+    const char* line = "Calibration done";
+    uint8_t payload[64];
+    uint32_t timestamp_ms = 123500;
+    memcpy(payload, &timestamp_ms, sizeof(timestamp_ms));
+    memcpy(&payload[sizeof(timestamp_ms)], line, strlen(line));
+    CHECK(telemetry_send(TELEMETRY_LOG, payload, sizeof(timestamp_ms) + strlen(line)));
+}
+
+int main(int argc, char** argv) {
+    host_serial_set_output(capture_serial, nullptr);
+    host_serial_set_write_room(4096);
+    send_everything();
+
+    if (argc == 3 && strcmp(argv[1], "--write") == 0) {
+        FILE* f = fopen(argv[2], "wb");
+        CHECK(f != nullptr && fwrite(wire.data(), 1, wire.size(), f) == wire.size());
+        if (f != nullptr) {
+            fclose(f);
+        }
+        printf("wrote %zu bytes to %s\n", wire.size(), argv[2]);
+        return check_result();
+    }
+
+    std::vector<uint8_t> fixture;
+    FILE* f = fopen(TELEMETRY_FIXTURE, "rb");
+    CHECK(f != nullptr);
+    if (f != nullptr) {
+        int c;
+        while ((c = fgetc(f)) != EOF) {
+            fixture.push_back((uint8_t) c);
+        }
+        fclose(f);
+    }
+    CHECK(wire == fixture);
+
+    // every frame's delimited, and has no zeros inside it
+    CHECK(wire.back() == 0);
+
+    // and a frame that doesn't fit in the serial buffer is dropped and counted, rather than waited for
+    uint32_t dropped = telemetry_get_dropped();
+    host_serial_set_write_room(16);
+    size_t sent = wire.size();
+    CHECK(!telemetry_send_text("too long for the room left"));
+    CHECK(wire.size() == sent);
+    CHECK(telemetry_get_dropped() == dropped + 1);
+
+    return check_result();
+}
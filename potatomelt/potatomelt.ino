@@ -1,37 +1,60 @@
-#include <PID_v1.h>
 #include <Preferences.h>
 #include <Wire.h>
 #include "src/robot.h"
 #include "src/melty_config.h"
 #include "src/controller.h"
+#include "src/scheduler.h"
+#include "src/seqlock.h"
+#include "src/flight_recorder.h"
+#include "src/telemetry.h"
+#include "src/log.h"
+#include "src/profiler.h"
+#include "src/latency_histogram.h"
+#include "src/hal/hal.h"
 #include "src/subsystems/storage.h"
+#include "src/subsystems/calibrator.h"
 
 TaskHandle_t hotloop;
+Scheduler hotloop_scheduler;
+FlightRecorder flight_recorder;
 
 Robot robot;
 
 robot_status state;
+robot_status previous_robot_state = NO_CONTROLLER;
 spin_control_parameters_t control_params;
 tank_control_parameters_t tank_params;
 
-Storage store;
+// loop() works on its own copies above, then hands them to the hot loop all at once
+Seqlock<robot_command_t> robot_commands;
 
-long last_logged_at = 0;
+// loop() runs at least every CONTROL_LOOP_INTERVAL_MS, and sooner whenever the input task wakes it with a new packet
+unsigned long next_control_tick_ms = 0;
+unsigned long last_received_at_us = 0;
+
+// How long controller packets take to make a difference, from when the input task picked them up. Send 'l' over serial for a report
+LatencyHistogram input_to_control("packet -> loop()");
+LatencyHistogram input_to_motors("packet -> motors");
 
-// Variables for the PID - it doesn't take args directly, just gets pointers to these
-double pid_current_rpm = 0.0; // Input to the PID: The current RPM
-double pid_target_rpm = 0.0;  // Setpoint for the PID: The target RPM
-double pid_throttle_output = 0.0; // Output from the PID: How hard to run the throttle
+Storage store;
+Calibrator calibrator;
 
-// We're using a PID to control motor power, to chase a RPM set by the throttle channel
-PID throttle_pid(&pid_current_rpm, &pid_throttle_output, &pid_target_rpm, PID_KP, PID_KI, PID_KD, P_ON_E, DIRECT);
+long last_logged_at = 0;
+unsigned long rpm_samples = 0;
+bool dump_requested = false;
 
-// todo - translation trim
+// the Arduino builder would generate these for us - but the host build doesn't have one
+void apply_config();
+void publish_commands();
+void hotloopFN(void* parameter);
 
 // Arduino setup function. Runs in CPU 1
 void setup() {
     Serial.begin(115200);
-    Serial.println("PotatoMelt startup");
+
+    // from here on, everything goes through LOG() - it never waits on the serial port
+    log_init();
+    LOG("PotatoMelt startup\n");
 
     // set up I2C
     Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
@@ -40,16 +63,22 @@ void setup() {
     // start data storage and recall
     store.init();
 
-    // Configure the PID
-    throttle_pid.SetOutputLimits(0.0, 1023.0);
-
     // start the robot subsystems
     robot.init();
+    apply_config();
     state = NO_CONTROLLER;
 
+    // an all-zero command would read as SPINNING - make sure the hot loop's first look says otherwise
+    publish_commands();
+
+    flight_recorder.init();
+
     // start the control interface
     BP32.setup(&on_connected_controller, &on_disconnected_controller);
 
+    // setup() and loop() run in the same task, so this is who the input task wakes up
+    ctrl_start_input_task(xTaskGetCurrentTaskHandle());
+
     // and start the hot loop - it'll be managing LEDs and motors
     xTaskCreatePinnedToCore(
         hotloopFN, // the function
@@ -62,15 +91,38 @@ void setup() {
     );
 }
 
+// Picks up the active profile's settings
+void apply_config() {
+    ctrl_init();
+}
+
+// Hands loop()'s latest decisions over to the hot loop
+void publish_commands() {
+    robot_command_t command;
+    command.state = state;
+    command.spin = control_params;
+    command.tank = tank_params;
+    command.input_received_at_us = last_received_at_us;
+    robot_commands.write(command);
+}
+
+// Flips over to the next robot profile - only while we're not spinning
+void switch_profile() {
+    store.set_profile((store.get_profile() + 1) % NUM_PROFILES);
+    apply_config();
+    robot.reload_config();
+    LOG("Switched to the %s profile \n", config_profile_name(store.get_profile()));
+}
+
 // This function is the core of the control loop
-// it calculates all the parameters needed for a single rotation (motor phases, LED timing, etc)
+// it calculates all the parameters needed for a single rotation (rotation rate, LED timing, battery), once per control tick
 void calculate_melty_params(spin_control_parameters_t* params, ctrl_state* c) {
-    float rpm = robot.get_rpm(c->target_rpm);
+    PROFILE_SCOPE("calculate_melty_params");
 
-    // don't lie to the PID
-    pid_current_rpm = rpm;
+    float rpm = robot.get_rpm();
+    rpm_samples++;
 
-    // but for the rest of the math, we're going to insist that we're spinning at least so fast
+    // we're going to insist that we're spinning at least so fast
     // this puts a limit on the amount of time we'll spend in a single rotation
     rpm = max(rpm, (float) MIN_TRACKING_RPM);
 
@@ -79,74 +131,298 @@ void calculate_melty_params(spin_control_parameters_t* params, ctrl_state* c) {
 
     rpm -= rpm*rpm_adjustment_factor;
 
-    long rotation_us = (1.0f/rpm) * 60 * 1000 * 1000;
-
-    params->rotation_interval_us = rotation_us;
+    // one rotation's worth of phase, every (60 million / rpm) microseconds
+    params->phase_rate = (uint32_t) (rpm * PHASE_PER_ROTATION / (60.0 * 1000 * 1000));
 
     // and the LED settings
     float led_on_portion = rpm / MAX_TRACKING_RPM;
     if (led_on_portion < 0.10f) led_on_portion = 0.10f;
     if (led_on_portion > 0.90f) led_on_portion = 0.90f;
 
-    double led_on_fraction = led_on_portion;
-
-    double led_on_us = (long) (led_on_portion * rotation_us);
-    double led_offset_us = (long) (LED_OFFSET_PERCENT * rotation_us / 100);
+    uint32_t led_on_phase = (uint32_t) (led_on_portion * PHASE_PER_ROTATION);
+    uint32_t led_offset_phase = (uint32_t) (store.get_config()->led_offset_percent * PHASE_PER_ROTATION / 100);
 
     // starts LED on time at point in rotation so it's "centered" on led offset
-    params->led_start = led_offset_us - (led_on_us / 2);
-    if (params->led_start < 0) {
-        params->led_start += rotation_us;
+    // phase is unsigned and wraps at a full rotation, so there's no need to fix up either end
+    params->led_start = led_offset_phase - (led_on_phase / 2);
+    params->led_stop = params->led_start + led_on_phase;
+
+    params->battery_percent = robot.get_battery();
+}
+
+// Where in the rotation to push, and how hard - this is all stick, so it gets picked up as soon as a packet arrives
+void calculate_translation(spin_control_parameters_t* params, ctrl_state* c) {
+    // translation: the stick's direction picks where in the rotation we push, and how far it's pushed picks how hard
+    // straight forwards is phase 0, and since we spin clockwise, right is a quarter turn later
+    int translate_lr = (abs(c->translate_lr) > CONTROL_TRANSLATE_DEADZONE) ? c->translate_lr : 0;
+
+    float translate_magnitude = sqrt((float) c->translate_forback * c->translate_forback + (float) translate_lr * translate_lr);
+    translate_magnitude = min(translate_magnitude, 512.0f);
+
+    float translate_turns = atan2((float) translate_lr, (float) c->translate_forback) / (2 * PI);
+    params->translate_phase = (uint32_t) (int64_t) (translate_turns * PHASE_PER_ROTATION);
+
+    params->translate_fraction = translate_magnitude * c->translate_trim / 1024;
+}
+
+// Feeds the calibrator
+void run_calibration() {
+    imu_sample_t sample;
+    robot.get_imu_sample(&sample);
+
+    rpm_estimate_t estimate;
+    robot.get_rpm_estimate(&estimate);
+
+    // ESC telemetry is the reference - it's measuring the wheels, so any slip shows up as error here
+    float motor1_rpm, motor2_rpm;
+    unsigned long reference_at_us;
+    bool reference_valid = robot.get_motor_rpms(&motor1_rpm, &motor2_rpm, &reference_at_us);
+    float reference_rpm = (motor1_rpm + motor2_rpm) / 2 * MOTOR_TO_ROBOT_RPM_RATIO;
+
+    if (calibrator.update(sample.rpm, sample.saturated, reference_rpm, reference_valid, reference_at_us, estimate.rpm_per_s)) {
+        correction_curve_t curve;
+        calibrator.get_curve(&curve);
+        robot.set_accel_correction_curve(&curve);
+        LOG("Auto-calibration: done, new correction curve saved\n");
     }
-    
-    params->led_stop = params->led_start + led_on_us;
-    if (params->led_stop > rotation_us)
-    {
-        params->led_stop -= rotation_us;
+}
+
+#ifdef TELEMETRY_BINARY_ENABLED
+
+// Sends everything we know as one binary status frame
+void log_status(ctrl_state* c) {
+    // keep quiet while dumping, so the dump goes out as fast as it can
+    if (millis() - last_logged_at < TELEMETRY_STATUS_INTERVAL_MS || flight_recorder.is_dumping()) {
+        return;
     }
 
-     // phase transition timing: Currently, only forwards/backwards, so we start the phases at 0 and 1/2 a rotation
-    params->motor_start_phase_1 = 0;
-    params->motor_start_phase_2 = rotation_us / 2;
+    telemetry_status_t status;
+    status.timestamp_ms = millis();
+    status.state = state;
+    status.profile = store.get_profile();
+    status.battery_percent = robot.get_battery();
+    status.target_rpm = c->target_rpm;
+    status.accel_correction = robot.get_accel_trim(c->target_rpm);
+
+    float motor1_rpm, motor2_rpm;
+    bool motor_rpms_valid = robot.get_motor_rpms(&motor1_rpm, &motor2_rpm);
+    status.motor1_rpm = motor1_rpm;
+    status.motor2_rpm = motor2_rpm;
+
+    status.flags = (c->connected ? TELEMETRY_STATUS_CONNECTED : 0)
+        | (c->alive ? TELEMETRY_STATUS_ALIVE : 0)
+        | (c->spin_requested ? TELEMETRY_STATUS_SPIN_REQUESTED : 0)
+        | (motor_rpms_valid ? TELEMETRY_STATUS_MOTOR_RPMS_VALID : 0)
+        | (flight_recorder.is_frozen() ? TELEMETRY_STATUS_FLIGHT_RECORDER_FROZEN : 0);
+
+    rpm_estimate_t estimate;
+    robot.get_rpm_estimate(&estimate);
+    status.rpm_estimate = estimate.rpm;
+    status.rpm_per_s = estimate.rpm_per_s;
+    status.rpm_confidence = estimate.confidence;
+
+    scheduler_stats_t hotloop_stats;
+    hotloop_scheduler.get_stats(&hotloop_stats, true);
+    status.hotloop_ticks = hotloop_stats.ticks;
+    status.hotloop_overruns = hotloop_stats.overruns;
+    status.hotloop_mean_lateness_us = hotloop_stats.mean_lateness_us;
+    status.hotloop_max_lateness_us = hotloop_stats.max_lateness_us;
+
+    hal_i2c_stats_t i2c_stats;
+    hal_i2c_get_stats(&i2c_stats);
+    hal_i2c_reset_stats();
+    status.i2c_transactions_per_sample = (rpm_samples > 0) ? i2c_stats.transactions / rpm_samples : 0;
+    status.i2c_busy_us_per_sample = (rpm_samples > 0) ? i2c_stats.busy_us / rpm_samples : 0;
+    rpm_samples = 0;
+
+    status.dropped_frames = telemetry_get_dropped();
+
+    telemetry_send(TELEMETRY_STATUS, &status, sizeof(status));
+    last_logged_at = millis();
+}
 
-    // The throttle PID control
-    pid_target_rpm = c->target_rpm;
-    throttle_pid.Compute();
-    params->throttle_perk = (int) pid_throttle_output;
+// As many flight record frames as the serial port will take
+void dump_flight_recorder() {
+    flight_record_t records[TELEMETRY_MAX_PAYLOAD / sizeof(flight_record_t)];
 
-    params->max_throttle_offset = (int) c->translate_forback * params->throttle_perk * c->translate_trim / 1024;
+    while (flight_recorder.is_dumping() && telemetry_can_send(sizeof(records))) {
+        int count = 0;
+        while (count < (int) (sizeof(records) / sizeof(flight_record_t)) && flight_recorder.read_dump(&records[count])) {
+            count++;
+        }
 
-    params->battery_percent = robot.get_battery();
+        telemetry_send(TELEMETRY_FLIGHT_RECORDS, records, count * sizeof(flight_record_t));
+    }
+}
+
+#else
+
+// Prints everything we know, every so often
+void log_status(ctrl_state* c) {
+    // keep quiet while dumping, so the log doesn't end up in the middle of the dump
+    if (millis() - last_logged_at < STATUS_LOG_INTERVAL_MS || flight_recorder.is_dumping()) {
+        return;
+    }
+
+    LOG("Controller: connected: %d alive: %d spin: %d vThrottle: %d | battery: %d | IMU correction %f \n", c->connected, c->alive, c->spin_requested, c->target_rpm, robot.get_battery(), robot.get_accel_trim(c->target_rpm));
+
+    scheduler_stats_t hotloop_stats;
+    hotloop_scheduler.get_stats(&hotloop_stats, true);
+    LOG("Hot loop: ticks: %lu overruns: %lu | lateness mean: %ldus max: %ldus \n", hotloop_stats.ticks, hotloop_stats.overruns, hotloop_stats.mean_lateness_us, hotloop_stats.max_lateness_us);
+
+    // what each RPM sample is costing us on the I2C bus
+    if (rpm_samples > 0) {
+        hal_i2c_stats_t i2c_stats;
+        hal_i2c_get_stats(&i2c_stats);
+        LOG("I2C: %lu transactions, %lu bus us per RPM sample \n", i2c_stats.transactions / rpm_samples, i2c_stats.busy_us / rpm_samples);
+    }
+    hal_i2c_reset_stats();
+    rpm_samples = 0;
+
+    float motor1_rpm, motor2_rpm;
+    if (robot.get_motor_rpms(&motor1_rpm, &motor2_rpm)) {
+        LOG("Motor RPM (ESC telemetry): %.0f %.0f \n", motor1_rpm, motor2_rpm);
+    }
+
+    rpm_estimate_t estimate;
+    robot.get_rpm_estimate(&estimate);
+    LOG("RPM estimate: %.0f | accel: %.0f rpm/s | confidence: %.2f \n", estimate.rpm, estimate.rpm_per_s, estimate.confidence);
+
+    if (flight_recorder.is_frozen()) {
+        LOG("Flight recorder frozen by %s - send 'd' to dump it \n", flight_recorder.get_trigger_reason());
+    }
+    last_logged_at = millis();
+}
+
+void dump_flight_recorder() {
+    flight_recorder.dump_some();
+}
+
+#endif
+
+// Single-character commands over serial
+// d: dump the flight recorder (freezing it first, if nothing else has)
+// p: print the profiling report, if PROFILING_ENABLED
+// l: print the controller latency histograms
+void handle_serial_commands() {
+    while (Serial.available() > 0) {
+        char command = Serial.read();
+
+        if (command == 'd') {
+            flight_recorder.trigger("serial command");
+            dump_requested = true;
+        } else if (command == 'p') {
+            profile_report();
+        } else if (command == 'l') {
+            input_to_control.report();
+            input_to_motors.report();
+        }
+    }
+
+    // the dump can only start once the recorder's frozen - which takes a little while after a trigger
+    if (dump_requested && flight_recorder.is_frozen()) {
+        flight_recorder.start_dump();
+        dump_requested = false;
+    }
+}
+
+// Sleeps until the next control tick, or until the input task has something new for us - whichever comes first
+// Returns true if it's time for a control tick
+bool wait_for_control_event() {
+    while (true) {
+        long remaining_ms = (long) (next_control_tick_ms - hal_millis());
+
+        if (remaining_ms <= 0) {
+            next_control_tick_ms += CONTROL_LOOP_INTERVAL_MS;
+
+            // if we've fallen a long way behind, don't try to run every tick we missed
+            if ((long) (next_control_tick_ms - hal_millis()) <= 0) {
+                next_control_tick_ms = hal_millis() + CONTROL_LOOP_INTERVAL_MS;
+            }
+            return true;
+        }
+
+        // blocking here also lets lower priority tasks run - otherwise the watchdog gets triggered
+        if (ulTaskNotifyTake(pdTRUE, max(pdMS_TO_TICKS(remaining_ms), (TickType_t) 1)) > 0) {
+            return false;
+        }
+    }
 }
 
 // Arduino loop function. Runs in CPU 1.
 // todo - low-battery state
 void loop() {
-    bool upd8 = BP32.update();
+    bool control_tick = wait_for_control_event();
 
-    ctrl_state* c = ctrl_update(upd8); 
+    ctrl_state* c = ctrl_update();
+
+    if (c->received_at_us != last_received_at_us) {
+        last_received_at_us = c->received_at_us;
+        input_to_control.record(hal_micros() - last_received_at_us);
+    }
 
     if (!c->connected) {
-        throttle_pid.SetMode(MANUAL);
         state = NO_CONTROLLER;
     } else if (!c->alive) {
-        throttle_pid.SetMode(MANUAL);
         state = CONTROLLER_STALE;
     } else if (c->spin_requested) {
-        if (state != SPINNING) {
-            // we're just starting to spin. Start the PID
-            throttle_pid.SetMode(AUTOMATIC);
+        if (c->y_pressed && !calibrator.is_running()) {
+            LOG("Auto-calibration: starting\n");
+            calibrator.start(store.get_config()->spin_target_rpms, NUM_TARGET_RPMS);
         }
 
-        calculate_melty_params(&control_params, c);
+        // the calibrator expects to be fed at a steady rate
+        if (control_tick && calibrator.is_running()) {
+            run_calibration();
+        }
+
+        // and while it's running, it picks the spin speed
+        if (calibrator.is_running()) {
+            c->target_rpm = calibrator.get_target_rpm();
+        }
+
+        // the rotation rate, LED and battery only get recalculated on the control tick (or as we start spinning), so the hot loop's
+        // phase rate ramp always gets a whole tick - translation gets picked up as soon as it arrives
+        if (control_tick || state != SPINNING) {
+            calculate_melty_params(&control_params, c);
+        }
+        calculate_translation(&control_params, c);
         state = SPINNING;
     } else {
-        throttle_pid.SetMode(MANUAL);
         state = READY;
 
+        // letting go of the throttle calls off any calibration run
+        calibrator.stop();
+
+        if (c->y_pressed) {
+            switch_profile();
+        }
+
         tank_params.translate_forback = c->translate_forback;
         tank_params.turn_lr = c->turn_lr;
+        tank_params.forback_power_scale = store.get_config()->tank_forback_power_scale;
+        tank_params.turning_power_scale = store.get_config()->tank_turning_power_scale;
+    }
+
+    // the spin controller chases the target RPM on its own, at the sensor rate
+    robot.set_spin_target(state == SPINNING, c->target_rpm);
+    publish_commands();
+
+    // freeze the flight recorder when something goes wrong, so we can see what led up to it
+    if (state == NO_CONTROLLER && previous_robot_state != NO_CONTROLLER) {
+        flight_recorder.trigger("disconnect");
+    } else if (state == CONTROLLER_STALE && previous_robot_state != CONTROLLER_STALE) {
+        flight_recorder.trigger("failsafe");
+    } else if (state == SPINNING && control_params.battery_percent <= 0) {
+        flight_recorder.trigger("flat battery");
     }
+    previous_robot_state = state;
+
+    handle_serial_commands();
+    dump_flight_recorder();
+
+    // settings only get written to flash once we've stopped spinning
+    store.set_spinning(state == SPINNING);
 
     if (c->trim_right) {
         robot.trim_accel(false, c->target_rpm);
@@ -156,27 +432,47 @@ void loop() {
         robot.trim_accel(true, c->target_rpm);
     }
 
-    if (millis() - last_logged_at > 500) {
-        Serial.printf("Controller: connected: %d alive: %d spin: %d vThrottle: %d | battery: %d | IMU correction %f \n", c->connected, c->alive, c->spin_requested, c->target_rpm, robot.get_battery(), robot.get_accel_trim(c->target_rpm));
-        last_logged_at = millis();
-    }
+    log_status(c);
 
-    // The main loop must have some kind of "yield to lower priority task" event.
-    // Otherwise, the watchdog will get triggered.
-    // If your main loop doesn't have one, just add a simple `vTaskDelay(1)`.
+    // no delay here - wait_for_control_event() is our "yield to lower priority task" event, which keeps the watchdog happy
     // Detailed info here:
     // https://stackoverflow.com/questions/66278271/task-watchdog-got-triggered-the-tasks-did-not-reset-the-watchdog-in-time
-
-    vTaskDelay(10);
 }
 
+static_assert(HOTLOOP_FREQ_HZ >= 1000 && HOTLOOP_FREQ_HZ <= 10000, "HOTLOOP_FREQ_HZ should be between 1khz and 10khz");
+
 // The robot control loop. Runs in CPU 0.
-void hotloopFN(void* parameter) {
+void hotloopFN(void*) {
+    // the scheduler wakes us up at a fixed rate, off a hardware timer rather than the FreeRTOS tick
+    // blocking between ticks also lets the idle task run, keeping the watchdog happy
+    hotloop_scheduler.init(HOTLOOP_FREQ_HZ);
+
+    unsigned long last_applied_at_us = 0;
+
     while(true) {
+        unsigned long deadline = hotloop_scheduler.wait_for_tick();
+        unsigned long woke_at = hal_micros();
+
+        // pick up whatever loop() last decided
+        robot_command_t command;
+        robot_commands.read(&command);
+
         // do the magic stuff
-        robot.update_loop(state, &control_params, &tank_params);
+        robot.update_loop(command.state, &command.spin, &command.tank);
 
-        //TODO: Update this to a proper, configurable delay - probably 1-4khz
-        vTaskDelay(1);
+        // the first tick to act on a new controller packet is when it reaches the motors
+        if (command.input_received_at_us != last_applied_at_us) {
+            last_applied_at_us = command.input_received_at_us;
+            input_to_motors.record(hal_micros() - last_applied_at_us);
+        }
+
+        // and write down what we did
+        flight_record_t* record = flight_recorder.next();
+        if (record != nullptr) {
+            record->timestamp_us = deadline;
+            record->lateness_us = min(woke_at - deadline, 65535UL);
+            robot.fill_flight_record(record);
+            flight_recorder.commit();
+        }
     }
 }
\ No newline at end of file
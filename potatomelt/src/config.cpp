@@ -0,0 +1,87 @@
+#include <stddef.h>
+#include <string.h>
+#include "config.h"
+#include "melty_config.h"
+#include "hal/hal.h"
+
+// Everything melty_config.h decides - nothing the robot's calibrated, learned or been told since
+static void load_profile_tuning(robot_config_t* config, float accelerometer_radius_cm, int battery_cell_count) {
+    static const int spin_target_rpms[NUM_TARGET_RPMS] = {600, 800, 1000, 1200, 1500, 1800, 2100, 2500, 3000};
+    static const float translation_trims[NUM_TRANS_TRIMS] = {1.0, 1.2, 1.5, 1.8, 2.2, 2.7, 3.3, 3.9, 4.7, 5.6, 6.8, 8.2, 10.0};
+
+    config->accelerometer_radius_cm = accelerometer_radius_cm;
+    config->led_offset_percent = LED_OFFSET_PERCENT;
+    for (int i = 0; i < NUM_TARGET_RPMS; i++) {
+        config->spin_target_rpms[i] = spin_target_rpms[i];
+    }
+    for (int i = 0; i < NUM_TRANS_TRIMS; i++) {
+        config->translation_trims[i] = translation_trims[i];
+    }
+
+    config->pid_kp = PID_KP;
+    config->pid_ki = PID_KI;
+    config->pid_kd = PID_KD;
+
+    config->tank_forback_power_scale = TANK_FORBACK_POWER_SCALE;
+    config->tank_turning_power_scale = TANK_TURNING_POWER_SCALE;
+
+    config->battery_cell_count = battery_cell_count;
+}
+
+static void load_profile_defaults(robot_config_t* config, float accelerometer_radius_cm, int battery_cell_count) {
+    load_profile_tuning(config, accelerometer_radius_cm, battery_cell_count);
+
+    correction_curve_init(&config->feed_forward_curve, PID_KFF);
+    config->target_rpm_index = 3;
+    config->trans_trim_index = 4;
+    config->has_accel_correction_curve = false;
+    correction_curve_init(&config->accel_correction_curve, 1.0f);
+}
+
+static void load_blob_defaults(config_blob_t* blob) {
+    // zero the lot first, so padding is deterministic and the CRC is repeatable
+    memset(blob, 0, sizeof(config_blob_t));
+
+    blob->version = CONFIG_VERSION;
+    blob->active_profile = DEFAULT_PROFILE;
+    load_profile_defaults(&blob->profiles[PROFILE_ANT], ANT_ACCELEROMETER_RADIUS_CM, ANT_BATTERY_CELL_COUNT);
+    load_profile_defaults(&blob->profiles[PROFILE_BEETLE], BEETLE_ACCELEROMETER_RADIUS_CM, BEETLE_BATTERY_CELL_COUNT);
+}
+
+void config_load_defaults(config_blob_t* blob) {
+    load_blob_defaults(blob);
+    blob->defaults_hash = config_defaults_hash();
+    config_update_crc(blob);
+}
+
+// Takes on melty_config.h's tuning, keeping both profiles' correction curves, learned feed-forward and remembered settings
+// They came from the robot, not from melty_config.h, and they're a lot more work to get back than a reflash
+void config_update_defaults(config_blob_t* blob) {
+    load_profile_tuning(&blob->profiles[PROFILE_ANT], ANT_ACCELEROMETER_RADIUS_CM, ANT_BATTERY_CELL_COUNT);
+    load_profile_tuning(&blob->profiles[PROFILE_BEETLE], BEETLE_ACCELEROMETER_RADIUS_CM, BEETLE_BATTERY_CELL_COUNT);
+    blob->defaults_hash = config_defaults_hash();
+    config_update_crc(blob);
+}
+
+// A fingerprint of everything melty_config.h puts in the blob - it changes whenever any of the defaults do
+uint32_t config_defaults_hash() {
+    // a few hundred bytes - too big for the stack of everyone who might call this
+    static config_blob_t defaults;
+
+    load_blob_defaults(&defaults);
+    return hal_crc32(&defaults, offsetof(config_blob_t, crc));
+}
+
+bool config_is_valid(const config_blob_t* blob) {
+    return blob->version == CONFIG_VERSION
+        && blob->active_profile >= 0 && blob->active_profile < NUM_PROFILES
+        && blob->crc == hal_crc32(blob, offsetof(config_blob_t, crc));
+}
+
+void config_update_crc(config_blob_t* blob) {
+    blob->crc = hal_crc32(blob, offsetof(config_blob_t, crc));
+}
+
+const char* config_profile_name(int profile) {
+    return (profile == PROFILE_ANT) ? "ant" : "beetle";
+}
\ No newline at end of file
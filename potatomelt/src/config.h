@@ -0,0 +1,67 @@
+#ifndef _CONFIG_h
+#define _CONFIG_h
+
+#include <stdint.h>
+#include "subsystems/correction_curve.h"
+
+// The robot's tuning and remembered settings, stored in flash as a single blob
+// Compile-time defaults come from melty_config.h. Bump CONFIG_VERSION whenever these structs change shape -
+// a blob from an older version gets thrown away for the defaults, rather than read as garbage.
+// The blob also remembers which defaults it started from, so changing melty_config.h takes effect, rather than being
+// ignored - its tuning gets overwritten, but calibration, learned feed-forward and remembered settings are kept
+
+#define CONFIG_VERSION 4
+
+#define NUM_TARGET_RPMS 9
+#define NUM_TRANS_TRIMS 13
+
+// One set of tuning per robot class, so the same board can go between robots without a reflash
+typedef enum robot_profile {
+    PROFILE_ANT = 0,
+    PROFILE_BEETLE = 1,
+    NUM_PROFILES = 2
+} robot_profile;
+
+typedef struct robot_config_t {
+    // spin control
+    float accelerometer_radius_cm;              // distance from the center of rotation to the accelerometers
+    float led_offset_percent;                   // where in the rotation the heading LED is centered
+    int spin_target_rpms[NUM_TARGET_RPMS];      // the spin speeds the left stick steps between
+    float translation_trims[NUM_TRANS_TRIMS];   // the translation strengths the dpad steps between
+
+    // throttle PID
+    float pid_kp;
+    float pid_ki;
+    float pid_kd;
+    correction_curve_t feed_forward_curve;      // throttle per RPM, across the RPM range - learned while spinning
+
+    // tank mode
+    float tank_forback_power_scale;
+    float tank_turning_power_scale;
+
+    int battery_cell_count;
+
+    // remembered between power cycles
+    int target_rpm_index;
+    int trans_trim_index;
+    bool has_accel_correction_curve;
+    correction_curve_t accel_correction_curve;
+} robot_config_t;
+
+// What actually goes into flash
+typedef struct config_blob_t {
+    uint32_t version;
+    uint32_t defaults_hash;                     // config_defaults_hash() when this blob last took on the defaults
+    int active_profile;
+    robot_config_t profiles[NUM_PROFILES];
+    uint32_t crc;                               // over everything above
+} config_blob_t;
+
+void config_load_defaults(config_blob_t* blob);
+void config_update_defaults(config_blob_t* blob);
+uint32_t config_defaults_hash();
+bool config_is_valid(const config_blob_t* blob);
+void config_update_crc(config_blob_t* blob);
+const char* config_profile_name(int profile);
+
+#endif
\ No newline at end of file
@@ -1,24 +1,27 @@
 #include <Bluepad32.h>
-#include <Preferences.h>
 
 #include "controller.h"
 #include "melty_config.h"
 #include "subsystems/storage.h"
+#include "log.h"
+#include "scheduler.h"
+#include "seqlock.h"
+#include "hal/hal.h"
 
 ControllerPtr myControllers[BP32_MAX_GAMEPADS];
 
-// todo - save the trims & spin speed
-// todo - work out how to get these into melty_config.h properly
-int spin_target_rpms[] =  {600, 800, 1000, 1200, 1500, 1800, 2100, 2500, 3000};
-float translation_trims[] = {1.0, 1.2, 1.5, 1.8, 2.2, 2.7, 3.3, 3.9, 4.7, 5.6, 6.8, 8.2, 10.0};
-#define NUM_TARGET_RPMS 9
+// the spin speeds and translation trims themselves live in the config - these pick between them
 int target_rpm_index = 3;
-
-#define NUM_TRANS_TRIMS 13;
 int target_trans_trim = 4;
 
 bool reverse_spin = false;
-bool connected = false;
+bool connected = false;     // only touched by the input task - bluepad32 runs the connection callbacks from BP32.update()
+
+// the input task publishes each packet here, and the control task picks up the latest
+TaskHandle_t input_task;
+TaskHandle_t control_task;
+Seqlock<ctrl_input_t> latest_input;
+uint32_t packets_seen = 0;
 
 long last_updated_millis;
 prev_state previous_state;
@@ -32,25 +35,85 @@ ctrl_state* previous_ctrls = &state_green;
 ctrl_state* new_ctrls = &state_blue;
 bool prev_ctrls_are_green = true;
 
-ctrl_state* ctrl_update(bool upd8) {
-    long now = millis();
+// Copies what we need out of a controller, so nobody else has to touch bluepad32
+void read_input(ControllerPtr ctl, ctrl_input_t* input) {
+    input->throttle = ctl->throttle();
+    input->axis_x = ctl->axisX();
+    input->axis_y = ctl->axisY();
+    input->axis_rx = ctl->axisRX();
+    input->axis_ry = ctl->axisRY();
+    input->buttons = ctl->buttons();
+    input->dpad = ctl->dpad();
+    input->received_at_us = hal_micros();
+    input->packet_count++;
+}
+
+// Polls bluepad32 much faster than packets arrive, so each one gets passed on within a poll period of landing
+void input_task_fn(void*) {
+    Scheduler input_scheduler;
+    input_scheduler.init(CONTROLLER_POLL_RATE_HZ);
+
+    ctrl_input_t input = {};
 
-    if (upd8) {
-        for (auto myController : myControllers) {
-            if (myController && myController->isConnected() && myController->hasData()) {
-                // create a new control state
-                last_updated_millis = now;
-                return get_state(myController);
+    while (true) {
+        input_scheduler.wait_for_tick();
+
+        bool was_connected = connected;
+        bool received = false;
+
+        if (BP32.update()) {
+            for (auto myController : myControllers) {
+                if (myController && myController->isConnected() && myController->hasData()) {
+                    read_input(myController, &input);
+                    received = true;
+                    break;
+                }
             }
         }
+
+        // connects and disconnects are news too
+        if (received || connected != was_connected) {
+            input.connected = connected;
+            latest_input.write(input);
+            xTaskNotifyGive(control_task);
+        }
+    }
+}
+
+void ctrl_start_input_task(TaskHandle_t control) {
+    control_task = control;
+
+    xTaskCreatePinnedToCore(
+        input_task_fn,                  // the function
+        "ctrl_input",                   // name the task
+        4096,                           // stack depth
+        NULL,                           // params
+        CONTROLLER_INPUT_PRIORITY,      // priority
+        &input_task,                    // task handle
+        1                               // core affinity
+    );
+}
+
+ctrl_state* ctrl_update() {
+    long now = hal_millis();
+
+    ctrl_input_t input;
+    latest_input.read(&input);
+
+    if (input.packet_count != packets_seen) {
+        // a new packet - create a new control state
+        packets_seen = input.packet_count;
+        last_updated_millis = now;
+        return get_state(&input);
     }
 
     // otherwise, recycle the existing control state
-    previous_ctrls->connected = connected;
+    previous_ctrls->connected = input.connected;
 
     // reset all the config buttons
     previous_ctrls->trim_left = false;
     previous_ctrls->trim_right = false;
+    previous_ctrls->y_pressed = false;
 
     // and check for control timeout
     if (now - last_updated_millis > CONTROL_UPDATE_TIMEOUT_MS) {
@@ -61,35 +124,46 @@ ctrl_state* ctrl_update(bool upd8) {
 }
 
 // right now, this is only written and tested with an xbox bluetooth controller
-ctrl_state* get_state(ControllerPtr ctl) {
+ctrl_state* get_state(ctrl_input_t* input) {
     // todo - validate controller type
     // todo - expand controller type support?
 
     // because we're processing a new update, we know the controller is alive
+    new_ctrls->connected = input->connected;
     new_ctrls->alive = true;
+    new_ctrls->received_at_us = input->received_at_us;
 
     // gotta hold down the throttle to spin
     // this both gives us a dead-girl switch and a constantly-changing input to keep the packets flowing
-    new_ctrls->spin_requested = ctl->throttle() > CONTROL_THROTTLE_MINIMUM;
+    new_ctrls->spin_requested = input->throttle > CONTROL_THROTTLE_MINIMUM;
 
-    new_ctrls->translate_forback = ctl->axisRY();
-    new_ctrls->translate_lr = ctl->axisX(); // plumbing it through even though it currently isn't used
-    new_ctrls->turn_lr = ctl->axisRX();
+    new_ctrls->translate_forback = input->axis_ry;
+    new_ctrls->translate_lr = input->axis_x;
+    new_ctrls->turn_lr = input->axis_rx;
 
     // spin direction
-    if ((ctl->buttons() & XBOX_BUTTON_X) && !previous_state.reverse_spin_pressed) {
+    if ((input->buttons & XBOX_BUTTON_X) && !previous_state.reverse_spin_pressed) {
         previous_state.reverse_spin_pressed = true;
         reverse_spin = !reverse_spin;
-    } else if (!(ctl->buttons() & XBOX_BUTTON_X) && previous_state.reverse_spin_pressed) {
+    } else if (!(input->buttons & XBOX_BUTTON_X) && previous_state.reverse_spin_pressed) {
         previous_state.reverse_spin_pressed = false;
     }
 
     new_ctrls->reverse_spin = reverse_spin;
 
+    // the Y button - what it does depends on whether we are spinning
+    new_ctrls->y_pressed = false;
+    if ((input->buttons & XBOX_BUTTON_Y) != previous_state.y_pressed) {
+        previous_state.y_pressed = !previous_state.y_pressed;
+        if (previous_state.y_pressed) {
+            new_ctrls->y_pressed = true;
+        }
+    }
+
     // target RPM adjustment
     // forward on the xbox controller gives negative values, for some reason
     // todo - make this only adjust while spinning?
-    int lstick = ctl->axisY();
+    int lstick = input->axis_y;
 
     if ((abs(lstick) > CONTROL_SPIN_SPEED_DEADZONE) && !previous_state.spin_target_rpm_changed) {
         // we've just gone past the threshold to change the target spin speed
@@ -107,11 +181,11 @@ ctrl_state* get_state(ControllerPtr ctl) {
         previous_state.spin_target_rpm_changed = false;
     }
 
-    new_ctrls->target_rpm = spin_target_rpms[target_rpm_index];
+    new_ctrls->target_rpm = get_active_store()->get_config()->spin_target_rpms[target_rpm_index];
 
     // And the trim adjustments
     // todo - save trim into config in appropriate places (trim- IMU. translate - ???)
-    int dpad = ctl->dpad();
+    int dpad = input->dpad;
 
     new_ctrls->trim_left = false;
     new_ctrls->trim_right = false;
@@ -133,7 +207,7 @@ ctrl_state* get_state(ControllerPtr ctl) {
         }
     }
 
-    new_ctrls->translate_trim = translation_trims[target_trans_trim];
+    new_ctrls->translate_trim = get_active_store()->get_config()->translation_trims[target_trans_trim];
 
     if ((dpad & XBOX_DPAD_LEFT) != previous_state.trim_left_pressed) {
         previous_state.trim_left_pressed = !previous_state.trim_left_pressed;
@@ -172,11 +246,11 @@ void on_connected_controller(ControllerPtr ctl) {
     bool foundEmptySlot = false;
     for (int i = 0; i < BP32_MAX_GAMEPADS; i++) {
         if (myControllers[i] == nullptr) {
-            Serial.printf("CALLBACK: Controller is connected, index=%d\n", i);
+            LOG("CALLBACK: Controller is connected, index=%d\n", i);
             // Additionally, you can get certain gamepad properties like:
             // Model, VID, PID, BTAddr, flags, etc.
             ControllerProperties properties = ctl->getProperties();
-            Serial.printf("Controller model: %s, VID=0x%04x, PID=0x%04x\n", ctl->getModelName().c_str(), properties.vendor_id,
+            LOG("Controller model: %s, VID=0x%04x, PID=0x%04x\n", ctl->getModelName().c_str(), properties.vendor_id,
                            properties.product_id);
             myControllers[i] = ctl;
             foundEmptySlot = true;
@@ -184,7 +258,7 @@ void on_connected_controller(ControllerPtr ctl) {
         }
     }
     if (!foundEmptySlot) {
-        Serial.println("CALLBACK: Controller connected, but could not found empty slot");
+        LOG("CALLBACK: Controller connected, but could not found empty slot\n");
     }
 
     connected = true;
@@ -203,7 +277,7 @@ void on_disconnected_controller(ControllerPtr ctl) {
 
     for (int i = 0; i < BP32_MAX_GAMEPADS; i++) {
         if (myControllers[i] == ctl) {
-            Serial.printf("CALLBACK: Controller disconnected from index=%d\n", i);
+            LOG("CALLBACK: Controller disconnected from index=%d\n", i);
             myControllers[i] = nullptr;
             foundController = true;
             break;
@@ -211,7 +285,7 @@ void on_disconnected_controller(ControllerPtr ctl) {
     }
 
     if (!foundController) {
-        Serial.println("CALLBACK: Controller disconnected, but not found in myControllers");
+        LOG("CALLBACK: Controller disconnected, but not found in myControllers\n");
     }
 
     BP32.enableNewBluetoothConnections(true);
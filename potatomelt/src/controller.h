@@ -10,7 +10,7 @@ typedef struct ctrl_state {
 
     // translation commands and spin direction
     int translate_forback; // -512 - 512
-    int translate_lr; // reserved for future implementation
+    int translate_lr; // -512 - 512
     int turn_lr; // -512 - 512
     bool reverse_spin; // toggle, stays true between presses of the command button
     int target_rpm; // this may stay high even if spin_requested is false!
@@ -21,7 +21,26 @@ typedef struct ctrl_state {
     // all of these are edge detectors, they'll go true once when the button is pressed and then drop back to false
     bool trim_left;
     bool trim_right;
-};
+    bool y_pressed; // auto-calibrate while spinning, switch robot profile otherwise
+
+    unsigned long received_at_us; // when the input task picked up the packet behind this state - see ctrl_input_t
+} ctrl_state;
+
+// The raw inputs from a single controller packet, as the input task saw them
+typedef struct ctrl_input_t {
+    bool connected;
+    uint32_t packet_count;      // goes up by one with every packet
+    int throttle;
+    int axis_x;
+    int axis_y;
+    int axis_rx;
+    int axis_ry;
+    uint16_t buttons;
+    uint8_t dpad;
+    // when the input task picked this packet up. Bluepad32 doesn't tell us when a packet actually landed, so this can be
+    // up to a poll period (1000 / CONTROLLER_POLL_RATE_HZ ms) after it did - and latencies measured from it read that much short
+    unsigned long received_at_us;
+} ctrl_input_t;
 
 typedef struct prev_state {
     // for keeping track of what's changed since last update
@@ -30,19 +49,23 @@ typedef struct prev_state {
     bool decrease_translate_pressed;
     bool trim_left_pressed;
     bool trim_right_pressed;
+    bool y_pressed;
     bool spin_target_rpm_changed;
     long last_trim_at;
-};
+} prev_state;
 
 void ctrl_init();
 
+// starts the input task, which polls bluepad32 and wakes control_task whenever something new arrives
+void ctrl_start_input_task(TaskHandle_t control_task);
+
 // connect and disconnect callbacks for bpad32
 void on_connected_controller(ControllerPtr ctr);
 void on_disconnected_controller(ControllerPtr ctr);
 
 // and what we all came here for, the controller interface functions
-// update() should be called regardless of if there's been a controller update or not
+// update() should be called every time the control task runs, whether or not it was woken by new input
 bool is_connected();
-ctrl_state* ctrl_update(bool upd8);
-ctrl_state* get_state(ControllerPtr ctl);
+ctrl_state* ctrl_update();
+ctrl_state* get_state(ctrl_input_t* input);
 // todo - vibrate the controller on big hits? That'd be cute.
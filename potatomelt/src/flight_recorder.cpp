@@ -0,0 +1,122 @@
+#include <Arduino.h>
+#include "flight_recorder.h"
+#include "melty_config.h"
+#include "log.h"
+#include "hal/hal.h"
+
+static_assert((FLIGHT_RECORDER_RECORDS & (FLIGHT_RECORDER_RECORDS - 1)) == 0, "FLIGHT_RECORDER_RECORDS must be a power of 2");
+static_assert((FLIGHT_RECORDER_INTERNAL_RECORDS & (FLIGHT_RECORDER_INTERNAL_RECORDS - 1)) == 0, "FLIGHT_RECORDER_INTERNAL_RECORDS must be a power of 2");
+
+// a dump line is never longer than this
+#define DUMP_LINE_LENGTH 96
+
+FlightRecorder::FlightRecorder() {
+    records = nullptr;
+    capacity = 0;
+    mask = 0;
+    head = 0;
+    triggered = false;
+    frozen = false;
+    trigger_reason = "";
+    dumping = false;
+}
+
+// Grabs a big buffer from PSRAM if the board has it, otherwise a smaller one from internal RAM
+void FlightRecorder::init() {
+    capacity = FLIGHT_RECORDER_RECORDS;
+    records = (flight_record_t*) hal_alloc_psram(capacity * sizeof(flight_record_t));
+
+    if (records == nullptr) {
+        capacity = FLIGHT_RECORDER_INTERNAL_RECORDS;
+        records = (flight_record_t*) malloc(capacity * sizeof(flight_record_t));
+    }
+
+    if (records == nullptr) {
+        LOG("Flight recorder: couldn't allocate a buffer, not recording\n");
+        return;
+    }
+
+    mask = capacity - 1;
+    LOG("Flight recorder: %lu records (%lu ms at the hot loop rate) \n", (unsigned long) capacity, (unsigned long) (capacity * 1000 / HOTLOOP_FREQ_HZ));
+}
+
+void FlightRecorder::trigger(const char* reason) {
+    if (triggered.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    trigger_reason = reason;
+    stop_at = head.load(std::memory_order_relaxed) + capacity * FLIGHT_RECORDER_POST_TRIGGER_PERCENT / 100;
+    triggered.store(true, std::memory_order_release);
+}
+
+bool FlightRecorder::is_frozen() {
+    return frozen.load(std::memory_order_acquire);
+}
+
+const char* FlightRecorder::get_trigger_reason() {
+    return trigger_reason;
+}
+
+void FlightRecorder::start_dump() {
+    if (!is_frozen() || dumping) {
+        return;
+    }
+
+    dump_end = head.load(std::memory_order_acquire);
+    dump_start = (dump_end > capacity) ? dump_end - capacity : 0;
+    dump_position = dump_start;
+    dump_header_pending = true;
+    dumping = true;
+}
+
+bool FlightRecorder::is_dumping() {
+    return dumping;
+}
+
+bool FlightRecorder::read_dump(flight_record_t* record) {
+    if (!dumping) {
+        return false;
+    }
+
+    *record = records[dump_position & mask];
+    dump_position++;
+
+    if (dump_position == dump_end) {
+        dumping = false;
+        rearm();
+    }
+
+    return true;
+}
+
+void FlightRecorder::dump_some() {
+    if (!dumping) {
+        return;
+    }
+
+    if (dump_header_pending) {
+        dump_header_pending = false;
+        Serial.printf("Flight recorder dump: %lu records, triggered by %s \n", (unsigned long) (dump_end - dump_start), trigger_reason);
+        Serial.println("timestamp_us,phase,rpm,motor1_throttle,motor2_throttle,lateness_us,estimated_rpm,state,battery_percent,led_on");
+    }
+
+    flight_record_t record;
+    while (Serial.availableForWrite() >= DUMP_LINE_LENGTH && read_dump(&record)) {
+        float rpm = record.phase_rate * 60000000.0 / 4294967296.0;
+
+        Serial.printf("%lu,%lu,%.0f,%d,%d,%u,%u,%u,%u,%u\n", (unsigned long) record.timestamp_us, (unsigned long) record.phase, rpm,
+            record.motor1_throttle, record.motor2_throttle, record.lateness_us, record.estimated_rpm,
+            record.state, record.battery_percent, (record.flags & FLIGHT_RECORD_LED_ON) ? 1 : 0);
+    }
+
+    if (!dumping) {
+        Serial.println("Flight recorder dump: done");
+    }
+}
+
+// start recording again - the hot loop won't look at the trigger until it's unfrozen
+void FlightRecorder::rearm() {
+    triggered.store(false, std::memory_order_relaxed);
+    frozen.store(false, std::memory_order_release);
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#ifndef _FLIGHT_RECORDER_h
+#define _FLIGHT_RECORDER_h
+
+#include <atomic>
+#include <stdint.h>
+
+// flags
+#define FLIGHT_RECORD_LED_ON 0x01
+
+// One hot loop tick, as compact as we can make it
+typedef struct flight_record_t {
+    uint32_t timestamp_us;      // the deadline this tick was scheduled for
+    uint32_t phase;             // where we were in the rotation
+    uint32_t phase_rate;        // how fast the hot loop thinks we're spinning: RPM = phase_rate * 60,000,000 / 2^32
+    int16_t motor1_throttle;    // what we sent the motors, -1000 - 1000
+    int16_t motor2_throttle;
+    uint16_t lateness_us;       // how late the tick started. Over a whole period means we overran
+    uint16_t estimated_rpm;     // what the RPM estimator thought, to set against phase_rate
+    uint8_t state;              // robot_status
+    uint8_t battery_percent;
+    uint8_t flags;
+} flight_record_t;
+
+// A flight recorder for the hot loop
+// The hot loop writes a record every tick into a ring buffer, overwriting the oldest. When something goes wrong
+// (a disconnect, a failsafe, a flat battery), trigger() lets it run on a little longer and then freezes it,
+// so we've got what led up to the problem and a bit of what came after. It stays frozen until it's been dumped.
+// Lock-free: only the hot loop writes records. Everyone else only touches them once the buffer is frozen.
+class FlightRecorder {
+    public:
+        FlightRecorder();
+        void init();
+
+        // hot loop only: a slot to fill in for this tick, or nullptr if we're frozen. commit() once it's filled in
+        flight_record_t* next() {
+            if (frozen.load(std::memory_order_relaxed) || records == nullptr) {
+                return nullptr;
+            }
+            return &records[head.load(std::memory_order_relaxed) & mask];
+        }
+
+        void commit() {
+            uint32_t written = head.load(std::memory_order_relaxed) + 1;
+            head.store(written, std::memory_order_release);
+
+            if (triggered.load(std::memory_order_acquire) && (int32_t) (written - stop_at) >= 0) {
+                frozen.store(true, std::memory_order_release);
+            }
+        }
+
+        // freeze the buffer, once the post-trigger records are in. Only the first trigger counts
+        void trigger(const char* reason);
+        bool is_frozen();
+        const char* get_trigger_reason();
+
+        // dumping, once frozen
+        // read_dump() hands the records back oldest first, and re-arms the recorder after the last one
+        // dump_some() prints them as CSV - as much as the serial port can take without blocking
+        void start_dump();
+        bool is_dumping();
+        bool read_dump(flight_record_t* record);
+        void dump_some();
+    private:
+        void rearm();
+        flight_record_t* records;
+        uint32_t capacity;
+        uint32_t mask;
+        std::atomic<uint32_t> head;         // how many records have ever been written
+        std::atomic<bool> triggered;
+        std::atomic<bool> frozen;
+        uint32_t stop_at;                   // freeze once head gets here
+        const char* trigger_reason;
+        bool dumping;
+        bool dump_header_pending;
+        uint32_t dump_start;
+        uint32_t dump_position;
+        uint32_t dump_end;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,51 @@
+#ifndef _HAL_h
+#define _HAL_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <driver/rmt.h>
+
+// A thin hardware abstraction layer
+// The robot code talks to the clock, I2C bus, RMT peripheral, ADC and NVS through these functions rather than
+// calling the Arduino/ESP-IDF APIs directly, so that another backend can stand in for the ESP32 one (hal_esp32.cpp)
+
+// ------------ Clock ---------------------------------
+unsigned long hal_micros();
+unsigned long hal_millis();
+uint32_t hal_cycle_count();         // CPU cycles, on whichever core we're running on. Wraps every few tens of seconds
+uint32_t hal_cycles_per_us();
+
+// ------------ I2C -----------------------------------
+// bus usage counters, so we can see what each sensor read costs
+typedef struct hal_i2c_stats_t {
+    unsigned long transactions;
+    unsigned long busy_us;
+} hal_i2c_stats_t;
+
+void hal_i2c_write(uint8_t device_addr, uint8_t reg_addr, const uint8_t* data, uint8_t len);
+void hal_i2c_read(uint8_t device_addr, uint8_t reg_addr, uint8_t* data, uint8_t len);
+void hal_i2c_get_stats(hal_i2c_stats_t* stats);
+void hal_i2c_reset_stats();
+
+// ------------ RMT -----------------------------------
+void hal_rmt_write(rmt_channel_t channel, const rmt_item32_t* items, int item_count);
+
+// ------------ ADC -----------------------------------
+uint32_t hal_adc_read_millivolts(uint8_t pin);
+
+// ------------ NVS -----------------------------------
+void hal_nvs_begin(const char* name);
+int hal_nvs_get_int(const char* key, int default_value);
+void hal_nvs_put_int(const char* key, int value);
+float hal_nvs_get_float(const char* key, float default_value);
+void hal_nvs_put_float(const char* key, float value);
+size_t hal_nvs_get_bytes(const char* key, void* buffer, size_t len);   // returns the number of bytes read, 0 if the key's missing
+void hal_nvs_put_bytes(const char* key, const void* buffer, size_t len);
+
+// ------------ Memory --------------------------------
+void* hal_alloc_psram(size_t len);      // returns nullptr if there's no PSRAM, or not enough of it
+
+// ------------ Checksums -----------------------------
+uint32_t hal_crc32(const void* data, size_t len);
+
+#endif
@@ -0,0 +1,115 @@
+#include <Arduino.h>
+#include <Preferences.h>
+#include <Wire.h>
+#include <esp_rom_crc.h>
+#include <esp_heap_caps.h>
+#include <esp_cpu.h>
+#include "hal.h"
+
+// The ESP32 backend for the HAL - straight passthroughs to the Arduino and ESP-IDF APIs
+
+Preferences preferences;
+
+hal_i2c_stats_t i2c_stats;
+
+unsigned long hal_micros() {
+    return micros();
+}
+
+unsigned long hal_millis() {
+    return millis();
+}
+
+uint32_t hal_cycle_count() {
+    return esp_cpu_get_cycle_count();
+}
+
+uint32_t hal_cycles_per_us() {
+    return getCpuFrequencyMhz();
+}
+
+void hal_i2c_write(uint8_t device_addr, uint8_t reg_addr, const uint8_t* data, uint8_t len) {
+    unsigned long started_at = micros();
+
+    Wire.beginTransmission(device_addr);
+    Wire.write(reg_addr);
+    for (int i = 0; i < len; i++) {
+        Wire.write(data[i]);
+    }
+    Wire.endTransmission();
+
+    i2c_stats.transactions++;
+    i2c_stats.busy_us += micros() - started_at;
+}
+
+void hal_i2c_read(uint8_t device_addr, uint8_t reg_addr, uint8_t* data, uint8_t len) {
+    unsigned long started_at = micros();
+
+    Wire.beginTransmission(device_addr);
+    Wire.write(reg_addr);
+    Wire.endTransmission();
+    Wire.requestFrom(device_addr, len);
+    for (int i = 0; i < len; i++) {
+        data[i] = Wire.read();
+    }
+
+    i2c_stats.transactions++;
+    i2c_stats.busy_us += micros() - started_at;
+}
+
+void hal_i2c_get_stats(hal_i2c_stats_t* stats) {
+    *stats = i2c_stats;
+}
+
+void hal_i2c_reset_stats() {
+    i2c_stats.transactions = 0;
+    i2c_stats.busy_us = 0;
+}
+
+void hal_rmt_write(rmt_channel_t channel, const rmt_item32_t* items, int item_count) {
+    rmt_write_items(channel, items, item_count, false);
+}
+
+uint32_t hal_adc_read_millivolts(uint8_t pin) {
+    return analogReadMilliVolts(pin);
+}
+
+void hal_nvs_begin(const char* name) {
+    preferences.begin(name, false);
+}
+
+int hal_nvs_get_int(const char* key, int default_value) {
+    return preferences.getInt(key, default_value);
+}
+
+void hal_nvs_put_int(const char* key, int value) {
+    preferences.putInt(key, value);
+}
+
+float hal_nvs_get_float(const char* key, float default_value) {
+    return preferences.getFloat(key, default_value);
+}
+
+void hal_nvs_put_float(const char* key, float value) {
+    preferences.putFloat(key, value);
+}
+
+size_t hal_nvs_get_bytes(const char* key, void* buffer, size_t len) {
+    // getBytes() will happily read a shorter blob - but anything that isn't the size we expect is junk to us
+    if (preferences.getBytesLength(key) != len) {
+        return 0;
+    }
+    return preferences.getBytes(key, buffer, len);
+}
+
+void hal_nvs_put_bytes(const char* key, const void* buffer, size_t len) {
+    preferences.putBytes(key, buffer, len);
+}
+
+void* hal_alloc_psram(size_t len) {
+    return heap_caps_malloc(len, MALLOC_CAP_SPIRAM);
+}
+
+uint32_t hal_crc32(const void* data, size_t len) {
+    return esp_rom_crc32_le(0, (const uint8_t*) data, len);
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#include "histogram.h"
+
+uint32_t histogram_percentile(const volatile uint32_t* histogram, int buckets, uint32_t (*bucket_start)(int bucket),
+    uint32_t samples, float fraction, uint32_t min_seen, uint32_t max_seen) {
+    uint32_t target = (uint32_t) (samples * fraction);
+    uint32_t seen = 0;
+
+    for (int bucket = 0; bucket < buckets; bucket++) {
+        uint32_t in_bucket = histogram[bucket];
+        if (seen + in_bucket > target) {
+            uint32_t low = bucket_start(bucket);
+            uint32_t width = bucket_start(bucket + 1) - low;
+            uint32_t estimate = low + (uint32_t) ((uint64_t) width * (target - seen) / in_bucket);
+
+            // the real extremes beat our guess
+            if (estimate < min_seen) return min_seen;
+            if (estimate > max_seen) return max_seen;
+            return estimate;
+        }
+        seen += in_bucket;
+    }
+
+    return max_seen;
+}
@@ -0,0 +1,14 @@
+#ifndef _HISTOGRAM_h
+#define _HISTOGRAM_h
+
+#include <stdint.h>
+
+// Percentiles from a bucketed histogram - shared by the profiler and the latency histograms
+// bucket_start(n) is the smallest value that lands in bucket n. Every bucket must be at least 1 wide.
+
+// The value that fraction of samples came in under
+// The histogram only knows which bucket each sample's in, so we assume they're spread evenly across the bucket
+uint32_t histogram_percentile(const volatile uint32_t* histogram, int buckets, uint32_t (*bucket_start)(int bucket),
+    uint32_t samples, float fraction, uint32_t min_seen, uint32_t max_seen);
+
+#endif
@@ -0,0 +1,58 @@
+#include <Arduino.h>
+#include "latency_histogram.h"
+#include "histogram.h"
+#include "log.h"
+
+LatencyHistogram::LatencyHistogram(const char* name) : name(name) {
+    reset();
+}
+
+void LatencyHistogram::reset() {
+    count = 0;
+    total_us = 0;
+    min_us = UINT32_MAX;
+    max_us = 0;
+    for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        histogram[i] = 0;
+    }
+}
+
+static uint32_t latency_bucket_start(int bucket) {
+    return bucket * LATENCY_HISTOGRAM_BUCKET_US;
+}
+
+uint32_t LatencyHistogram::percentile(uint32_t samples, float fraction) {
+    return histogram_percentile(histogram, LATENCY_HISTOGRAM_BUCKETS, latency_bucket_start, samples, fraction, min_us, max_us);
+}
+
+void LatencyHistogram::report() {
+    uint32_t samples = count;
+    if (samples == 0) {
+        LOG("Latency: %s - nothing recorded \n", name);
+        return;
+    }
+
+    uint32_t min_seen = min_us;
+    uint32_t max_seen = max_us;
+    LOG("Latency: %s - %lu samples | min: %luus mean: %luus p50: %luus p99: %luus max: %luus \n", name,
+        (unsigned long) samples, (unsigned long) min_seen, (unsigned long) (total_us / samples),
+        (unsigned long) percentile(samples, 0.50f), (unsigned long) percentile(samples, 0.99f), (unsigned long) max_seen);
+
+    // one column per bucket, skipping the empty lines - the last one catches everything slower
+    static_assert(LATENCY_HISTOGRAM_BUCKETS % 6 == 0, "reports print the buckets 6 to a line");
+    for (int bucket = 0; bucket < LATENCY_HISTOGRAM_BUCKETS; bucket += 6) {
+        volatile uint32_t* h = &histogram[bucket];
+        if (h[0] + h[1] + h[2] + h[3] + h[4] + h[5] == 0) {
+            continue;
+        }
+
+        const char* format = (bucket + 6 < LATENCY_HISTOGRAM_BUCKETS)
+            ? "Latency:   %4lu-%4luus:  %6lu %6lu %6lu %6lu %6lu %6lu \n"
+            : "Latency:   %4lu-%4lu+us: %6lu %6lu %6lu %6lu %6lu %6lu \n";
+        LOG(format, (unsigned long) latency_bucket_start(bucket), (unsigned long) latency_bucket_start(bucket + 6) - 1,
+            (unsigned long) h[0], (unsigned long) h[1], (unsigned long) h[2], (unsigned long) h[3],
+            (unsigned long) h[4], (unsigned long) h[5]);
+    }
+
+    reset();
+}
\ No newline at end of file
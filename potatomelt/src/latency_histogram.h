@@ -0,0 +1,45 @@
+#ifndef _LATENCY_HISTOGRAM_h
+#define _LATENCY_HISTOGRAM_h
+
+#include <stdint.h>
+
+// How long things take to get from A to B, in microseconds
+// Linear buckets, since the interesting latencies here are all under a couple of milliseconds - input polls at 1kHz and
+// the hot loop runs at 4kHz. Anything past the last bucket lands in it
+#define LATENCY_HISTOGRAM_BUCKET_US 50
+#define LATENCY_HISTOGRAM_BUCKETS 48           // 0-2.4ms - reports print these 6 to a line
+
+// Only one task may record into each histogram. Reports can come from anywhere, and might catch it mid-update -
+// that skews a report by one sample at most
+class LatencyHistogram {
+    public:
+        LatencyHistogram(const char* name);
+
+        void record(uint32_t latency_us) {
+            count++;
+            total_us += latency_us;
+            if (latency_us < min_us) min_us = latency_us;
+            if (latency_us > max_us) max_us = latency_us;
+
+            uint32_t bucket = latency_us / LATENCY_HISTOGRAM_BUCKET_US;
+            if (bucket >= LATENCY_HISTOGRAM_BUCKETS) bucket = LATENCY_HISTOGRAM_BUCKETS - 1;
+            histogram[bucket]++;
+        }
+
+        // prints a summary line and the buckets, then starts counting afresh
+        void report();
+
+        // The latency that fraction of samples came in under - to within a bucket
+        uint32_t percentile(uint32_t samples, float fraction);
+        uint32_t samples() { return count; }
+    private:
+        void reset();
+        const char* name;
+        volatile uint32_t count;
+        volatile uint64_t total_us;
+        volatile uint32_t min_us;
+        volatile uint32_t max_us;
+        volatile uint32_t histogram[LATENCY_HISTOGRAM_BUCKETS];
+};
+
+#endif
\ No newline at end of file
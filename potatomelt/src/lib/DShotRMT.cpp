@@ -5,6 +5,8 @@
 //
 
 #include "DShotRMT.h"
+#include "../hal/hal.h"
+#include "../profiler.h"
 
 // Constructor that takes gpio and rmtChannel as arguments
 DShotRMT::DShotRMT(gpio_num_t gpio, rmt_channel_t rmtChannel)
@@ -14,6 +16,21 @@ DShotRMT::DShotRMT(gpio_num_t gpio, rmt_channel_t rmtChannel)
     dshot_config.pin_num = static_cast<uint8_t>(gpio);
     dshot_config.rmt_channel = rmtChannel;
     dshot_config.mem_block_num = static_cast<uint8_t>(RMT_CHANNEL_MAX - static_cast<uint8_t>(rmtChannel));
+    dshot_config.rx_rmt_channel = RMT_CHANNEL_MAX;
+
+    // Create an empty packet using the DSHOT_NULL_PACKET and the buildTxRmtItem function
+    buildTxRmtItem(DSHOT_NULL_PACKET);
+}
+
+// Constructor for bidirectional DShot, that takes gpio, rmtChannel and a receive rmtChannel as arguments
+DShotRMT::DShotRMT(gpio_num_t gpio, rmt_channel_t rmtChannel, rmt_channel_t rxRmtChannel)
+{
+    // Initialize the dshot_config structure with the arguments passed to the constructor
+    dshot_config.gpio_num = gpio;
+    dshot_config.pin_num = static_cast<uint8_t>(gpio);
+    dshot_config.rmt_channel = rmtChannel;
+    dshot_config.mem_block_num = static_cast<uint8_t>(RMT_CHANNEL_MAX - static_cast<uint8_t>(rmtChannel));
+    dshot_config.rx_rmt_channel = rxRmtChannel;
 
     // Create an empty packet using the DSHOT_NULL_PACKET and the buildTxRmtItem function
     buildTxRmtItem(DSHOT_NULL_PACKET);
@@ -27,6 +44,7 @@ DShotRMT::DShotRMT(uint8_t pin, uint8_t channel)
     dshot_config.pin_num = pin;
     dshot_config.rmt_channel = static_cast<rmt_channel_t>(channel);
     dshot_config.mem_block_num = RMT_CHANNEL_MAX - channel;
+    dshot_config.rx_rmt_channel = RMT_CHANNEL_MAX;
 
     // Create an empty packet using the DSHOT_NULL_PACKET and the buildTxRmtItem function
     buildTxRmtItem(DSHOT_NULL_PACKET);
@@ -40,6 +58,7 @@ DShotRMT::DShotRMT(uint8_t pin)
     dshot_config.pin_num = pin;
     dshot_config.rmt_channel = static_cast<rmt_channel_t>(RMT_CHANNEL_MAX -1);
     dshot_config.mem_block_num = RMT_CHANNEL_MAX - 1;
+    dshot_config.rx_rmt_channel = RMT_CHANNEL_MAX;
 
     // Create an empty packet using the DSHOT_NULL_PACKET and the buildTxRmtItem function
     buildTxRmtItem(DSHOT_NULL_PACKET);
@@ -49,6 +68,11 @@ DShotRMT::~DShotRMT()
 {
     // Uninstall the RMT driver
     rmt_driver_uninstall(dshot_config.rmt_channel);
+
+    if (dshot_config.rx_rmt_channel != RMT_CHANNEL_MAX)
+    {
+        rmt_driver_uninstall(dshot_config.rx_rmt_channel);
+    }
 }
 
 DShotRMT::DShotRMT(DShotRMT const &)
@@ -103,6 +127,18 @@ bool DShotRMT::begin(dshot_mode_t dshot_mode, bool is_bidirectional)
     dshot_config.ticks_zero_low = (dshot_config.ticks_per_bit - dshot_config.ticks_zero_high);
     dshot_config.ticks_one_low = (dshot_config.ticks_per_bit - dshot_config.ticks_one_high);
 
+    // Precompute the RMT items for this mode, and invalidate whatever's already encoded
+    buildRmtItemTemplates();
+    last_throttle_value = -1;
+
+    // Bidirectional DShot listens for replies on the same pin - the receiver has to be set up first,
+    // as configuring it takes the pin over as an input
+    has_erpm = false;
+    if (dshot_config.is_bidirectional && !beginTelemetry())
+    {
+        return false;
+    }
+
     // Set up RMT configuration for DShot transmission
     dshot_tx_rmt_config.rmt_mode = RMT_MODE_TX;
     dshot_tx_rmt_config.channel = dshot_config.rmt_channel;
@@ -126,12 +162,196 @@ bool DShotRMT::begin(dshot_mode_t dshot_mode, bool is_bidirectional)
     // Set up selected DShot mode
     rmt_config(&dshot_tx_rmt_config);
 
+    // Transmit and receive share the one signal wire: make it open-drain with a pullup,
+    // so the ESC can pull it low between our frames, and both channels can see it
+    if (dshot_config.is_bidirectional)
+    {
+        gpio_set_direction(dshot_config.gpio_num, GPIO_MODE_INPUT_OUTPUT_OD);
+        gpio_pullup_en(dshot_config.gpio_num);
+    }
+
     // Install RMT driver and return result
     return rmt_driver_install(dshot_tx_rmt_config.channel, 0, 0);
 }
 
+// Sets up an RMT receive channel on the motor pin, to capture the ESC's eRPM replies
+bool DShotRMT::beginTelemetry()
+{
+    if (dshot_config.rx_rmt_channel == RMT_CHANNEL_MAX)
+    {
+        return false;
+    }
+
+    rmt_config_t dshot_rx_rmt_config = RMT_DEFAULT_CONFIG_RX(dshot_config.gpio_num, dshot_config.rx_rmt_channel);
+    dshot_rx_rmt_config.clk_div = dshot_config.clk_div;
+    dshot_rx_rmt_config.mem_block_num = 1;
+    dshot_rx_rmt_config.rx_config.filter_en = true;
+    dshot_rx_rmt_config.rx_config.filter_ticks_thresh = DSHOT_RX_FILTER_TICKS;
+
+    // The reply holds a level for at most 3 of its bits, and follows our frame after ~30us of idle -
+    // so a few bit-times without an edge means the frame is over
+    dshot_rx_rmt_config.rx_config.idle_threshold = dshot_config.ticks_per_bit * DSHOT_ERPM_IDLE_BITS;
+
+    rmt_config(&dshot_rx_rmt_config);
+
+    if (rmt_driver_install(dshot_config.rx_rmt_channel, DSHOT_RX_RINGBUF_SIZE, 0) != ESP_OK)
+    {
+        return false;
+    }
+
+    rmt_get_ringbuf_handle(dshot_config.rx_rmt_channel, &dshot_rx_ringbuf);
+
+    return rmt_rx_start(dshot_config.rx_rmt_channel, true) == ESP_OK;
+}
+
+dshot_erpm_exit_mode_t DShotRMT::getMotorRPM(uint32_t &erpm)
+{
+    if (!dshot_config.is_bidirectional)
+    {
+        return ERR_BIDIRECTION_DISABLED;
+    }
+
+    dshot_erpm_exit_mode_t result = ERR_EMPTY_QUEUE;
+
+    // Drain everything that's been captured, keeping the newest good reply.
+    // The receiver also sees our own outgoing frames on the shared wire - those fail to decode, and get skipped.
+    size_t rx_size = 0;
+    rmt_item32_t *rx_items = (rmt_item32_t *)xRingbufferReceive(dshot_rx_ringbuf, &rx_size, 0);
+
+    while (rx_items != nullptr)
+    {
+        uint32_t decoded_erpm;
+        if (decodeERPM(rx_items, rx_size / sizeof(rmt_item32_t), dshot_config.ticks_per_bit, decoded_erpm) == DECODE_SUCCESS)
+        {
+            last_erpm = decoded_erpm;
+            has_erpm = true;
+            result = DECODE_SUCCESS;
+        }
+        else if (result != DECODE_SUCCESS)
+        {
+            result = ERR_CHECKSUM_FAIL;
+        }
+
+        vRingbufferReturnItem(dshot_rx_ringbuf, rx_items);
+        rx_items = (rmt_item32_t *)xRingbufferReceive(dshot_rx_ringbuf, &rx_size, 0);
+    }
+
+    erpm = last_erpm;
+
+    if (!has_erpm)
+    {
+        return ERR_NO_PACKETS;
+    }
+
+    return result;
+}
+
+// Turns a captured telemetry frame back into eRPM
+// The line idles high. The ESC sends a low start bit, then 20 bits of GCR where a 1 is a change of level, at 5/4 of the command bitrate.
+dshot_erpm_exit_mode_t DShotRMT::decodeERPM(const rmt_item32_t *items, size_t item_count, uint16_t ticks_per_bit, uint32_t &erpm)
+{
+    if (ticks_per_bit == 0)
+    {
+        return ERR_NO_PACKETS;
+    }
+
+    // First, turn the captured levels back into bits
+    uint32_t raw_levels = 0;
+    int bit_count = 0;
+
+    for (size_t i = 0; i < item_count && bit_count < DSHOT_ERPM_FRAME_BITS; i++)
+    {
+        const uint32_t durations[2] = {items[i].duration0, items[i].duration1};
+        const uint32_t levels[2] = {items[i].level0, items[i].level1};
+
+        for (int half = 0; half < 2 && bit_count < DSHOT_ERPM_FRAME_BITS; half++)
+        {
+            // a zero duration marks the end of the capture
+            if (durations[half] == 0)
+            {
+                i = item_count;
+                break;
+            }
+
+            // skip anything before the start bit
+            if (bit_count == 0 && levels[half] == 1)
+            {
+                continue;
+            }
+
+            // round to the nearest whole number of reply bits (each 4/5 of a command bit)
+            uint32_t bits = (durations[half] * 5 + ticks_per_bit * 2) / (ticks_per_bit * 4);
+            if (bits == 0)
+            {
+                bits = 1;
+            }
+
+            for (; bits > 0 && bit_count < DSHOT_ERPM_FRAME_BITS; bits--, bit_count++)
+            {
+                raw_levels = (raw_levels << 1) | levels[half];
+            }
+        }
+    }
+
+    if (bit_count == 0)
+    {
+        return ERR_NO_PACKETS;
+    }
+
+    // the capture stops once the line has idled high for a while - so fill in the trailing high bits
+    int missing_bits = DSHOT_ERPM_FRAME_BITS - bit_count;
+    raw_levels = (raw_levels << missing_bits) | ((1 << missing_bits) - 1);
+
+    // undo the level-change encoding to get the GCR bits back, dropping the start bit
+    uint32_t gcr = (raw_levels ^ (raw_levels >> 1)) & 0xFFFFF;
+
+    // then GCR decode, 5 bits to a nibble
+    uint16_t packet = 0;
+    for (int quintet = 3; quintet >= 0; quintet--)
+    {
+        uint8_t nibble = GCR_decode[(gcr >> (quintet * 5)) & 0x1F];
+        if (nibble == 0xFF)
+        {
+            return ERR_CHECKSUM_FAIL;
+        }
+        packet = (packet << 4) | nibble;
+    }
+
+    // all four nibbles XOR together to 0xF in a good packet
+    uint16_t crc = packet ^ (packet >> 8);
+    crc ^= crc >> 4;
+    if ((crc & 0x0F) != 0x0F)
+    {
+        return ERR_CHECKSUM_FAIL;
+    }
+
+    // what's left is the time per electrical revolution in microseconds, as a 3-bit exponent and 9-bit mantissa
+    uint16_t period_packet = packet >> 4;
+    if (period_packet == DSHOT_ERPM_MAX_PERIOD)
+    {
+        erpm = 0;
+        return DECODE_SUCCESS;
+    }
+
+    uint32_t period_us = (period_packet & 0x1FF) << (period_packet >> 9);
+    if (period_us == 0)
+    {
+        return ERR_CHECKSUM_FAIL;
+    }
+
+    erpm = (60 * 1000 * 1000) / period_us;
+    return DECODE_SUCCESS;
+}
+
 // Define a function to send a DShot command over an RMT interface to control a brushless motor's speed.
 void DShotRMT::sendThrottleValue(uint16_t throttle_value)
+{
+    loadThrottleValue(throttle_value);
+    transmit();
+}
+
+// Encodes the throttle value into dshot_tx_rmt_item, ready to go
+void DShotRMT::loadThrottleValue(uint16_t throttle_value)
 {
     dshot_packet_t dshot_rmt_packet = {};
 
@@ -147,6 +367,15 @@ void DShotRMT::sendThrottleValue(uint16_t throttle_value)
         throttle_value = DSHOT_THROTTLE_MAX;
     }
 
+    // The ESC still needs a steady stream of packets, but if the throttle hasn't changed,
+    // the frame we encoded last time is still good - it just needs sending again.
+    if (throttle_value == last_throttle_value)
+    {
+        return;
+    }
+
+    last_throttle_value = throttle_value;
+
     dshot_rmt_packet.throttle_value = throttle_value;
 
     // Telemetric using additional pin on the ESC is not supported.
@@ -155,75 +384,74 @@ void DShotRMT::sendThrottleValue(uint16_t throttle_value)
     // Calculate the checksum for the DShot packet using the calculateCRC function.
     dshot_rmt_packet.checksum = calculateCRC(dshot_rmt_packet);
 
-    // Send the DShot packet over the RMT interface to control the motor's speed.
-    sendRmtPaket(dshot_rmt_packet);
+    // Encode the DShot packet into RMT items
+    buildTxRmtItem(parseRmtPaket(dshot_rmt_packet));
 }
 
-// This method builds the RMT data transmission sequence for the DShot protocol
-rmt_item32_t *DShotRMT::buildTxRmtItem(uint16_t parsed_packet)
+// Output using ESP32 RMT
+void DShotRMT::transmit()
 {
-    // Check if DShot is set to bidirectional mode
-    if (dshot_config.is_bidirectional)
-    {
-        // If bidirectional, invert the high/low bits
-        for (int i = 0; i < DSHOT_PAUSE_BIT; i++, parsed_packet <<= 1)
-        {
-            if (parsed_packet & 0b1000000000000000)
-            {
-                // Set RMT item for a logic high signal
-                dshot_tx_rmt_item[i].duration0 = dshot_config.ticks_one_low;
-                dshot_tx_rmt_item[i].duration1 = dshot_config.ticks_one_high;
-            }
-            else
-            {
-                // Set RMT item for a logic low signal
-                dshot_tx_rmt_item[i].duration0 = dshot_config.ticks_zero_low;
-                dshot_tx_rmt_item[i].duration1 = dshot_config.ticks_zero_high;
-            }
+    hal_rmt_write(dshot_tx_rmt_config.channel, dshot_tx_rmt_item, DSHOT_PACKET_LENGTH);
+}
 
-            // Set level of RMT item
-            dshot_tx_rmt_item[i].level0 = 0;
-            dshot_tx_rmt_item[i].level1 = 1;
-        }
-    }
-    else
+// Builds the RMT items for each nibble value, and the pause, for the current DShot mode
+void DShotRMT::buildRmtItemTemplates()
+{
+    for (int nibble = 0; nibble < DSHOT_NIBBLE_VALUES; nibble++)
     {
-        // If not bidirectional, set the RMT items as usual
-        for (int i = 0; i < DSHOT_PAUSE_BIT; i++, parsed_packet <<= 1)
+        for (int bit = 0; bit < DSHOT_BITS_PER_NIBBLE; bit++)
         {
-            if (parsed_packet & 0b1000000000000000)
+            rmt_item32_t &item = nibble_rmt_items[nibble][bit];
+            bool is_one = nibble & (0b1000 >> bit);
+
+            // Check if DShot is set to bidirectional mode
+            if (dshot_config.is_bidirectional)
             {
-                // Set RMT item for a logic high signal
-                dshot_tx_rmt_item[i].duration0 = dshot_config.ticks_one_high;
-                dshot_tx_rmt_item[i].duration1 = dshot_config.ticks_one_low;
+                // If bidirectional, invert the high/low bits
+                item.duration0 = is_one ? dshot_config.ticks_one_low : dshot_config.ticks_zero_low;
+                item.duration1 = is_one ? dshot_config.ticks_one_high : dshot_config.ticks_zero_high;
+                item.level0 = 0;
+                item.level1 = 1;
             }
             else
             {
-                // Set RMT item for a logic low signal
-                dshot_tx_rmt_item[i].duration0 = dshot_config.ticks_zero_high;
-                dshot_tx_rmt_item[i].duration1 = dshot_config.ticks_zero_low;
+                item.duration0 = is_one ? dshot_config.ticks_one_high : dshot_config.ticks_zero_high;
+                item.duration1 = is_one ? dshot_config.ticks_one_low : dshot_config.ticks_zero_low;
+                item.level0 = 1;
+                item.level1 = 0;
             }
-
-            // Set level of RMT item
-            dshot_tx_rmt_item[i].level0 = 1;
-            dshot_tx_rmt_item[i].level1 = 0;
         }
     }
 
     // Set end marker for each frame
     if (dshot_config.is_bidirectional)
     {
-        dshot_tx_rmt_item[DSHOT_PAUSE_BIT].level0 = 1;
-        dshot_tx_rmt_item[DSHOT_PAUSE_BIT].level1 = 0;
+        pause_rmt_item.level0 = 1;
+        pause_rmt_item.level1 = 0;
     }
     else
     {
-        dshot_tx_rmt_item[DSHOT_PAUSE_BIT].level0 = 0;
-        dshot_tx_rmt_item[DSHOT_PAUSE_BIT].level1 = 1;
+        pause_rmt_item.level0 = 0;
+        pause_rmt_item.level1 = 1;
     }
 
     // Add packet seperator aka DShot Pause.
-    dshot_tx_rmt_item[DSHOT_PAUSE_BIT].duration1 = DSHOT_PAUSE;
+    pause_rmt_item.duration0 = 0;
+    pause_rmt_item.duration1 = DSHOT_PAUSE;
+}
+
+// This method builds the RMT data transmission sequence for the DShot protocol
+// from the precomputed items, most significant nibble first
+rmt_item32_t *DShotRMT::buildTxRmtItem(uint16_t parsed_packet)
+{
+    for (int nibble = 0; nibble < DSHOT_PAUSE_BIT / DSHOT_BITS_PER_NIBBLE; nibble++, parsed_packet <<= DSHOT_BITS_PER_NIBBLE)
+    {
+        memcpy(&dshot_tx_rmt_item[nibble * DSHOT_BITS_PER_NIBBLE],
+               nibble_rmt_items[parsed_packet >> 12],
+               sizeof(nibble_rmt_items[0]));
+    }
+
+    dshot_tx_rmt_item[DSHOT_PAUSE_BIT] = pause_rmt_item;
 
     // Return the rmt_item
     return dshot_tx_rmt_item;
@@ -259,11 +487,10 @@ uint16_t DShotRMT::calculateCRC(const dshot_packet_t &dshot_packet)
 uint16_t DShotRMT::parseRmtPaket(const dshot_packet_t &dshot_packet)
 {
     uint16_t parsedRmtPaket = DSHOT_NULL_PACKET;
-    uint16_t crc = calculateCRC(dshot_packet);
 
-    // Complete the paket
+    // Complete the paket - the checksum has already been calculated by the caller
     parsedRmtPaket = (dshot_packet.throttle_value << 1) | dshot_packet.telemetric_request;
-    parsedRmtPaket = (parsedRmtPaket << 4) | crc;
+    parsedRmtPaket = (parsedRmtPaket << 4) | dshot_packet.checksum;
 
     return parsedRmtPaket;
 }
@@ -272,6 +499,34 @@ uint16_t DShotRMT::parseRmtPaket(const dshot_packet_t &dshot_packet)
 void DShotRMT::sendRmtPaket(const dshot_packet_t &dshot_packet)
 {
     buildTxRmtItem(parseRmtPaket(dshot_packet));
+    transmit();
+}
+
+DShotRMTGroup::DShotRMTGroup(DShotRMT &motor_a, DShotRMT &motor_b) : motor_a(motor_a), motor_b(motor_b)
+{
+}
+
+bool DShotRMTGroup::begin()
+{
+#if SOC_RMT_SUPPORT_TX_SYNCHRO
+    // Put both channels in the sync group - from now on, neither starts until both have been loaded
+    bool success = rmt_add_channel_to_group(motor_a.dshot_config.rmt_channel) == ESP_OK;
+    success &= rmt_add_channel_to_group(motor_b.dshot_config.rmt_channel) == ESP_OK;
+    return success;
+#else
+    // No sync manager on this chip - the frames go out back-to-back instead
+    return true;
+#endif
+}
+
+void DShotRMTGroup::sendThrottleValues(uint16_t throttle_value_a, uint16_t throttle_value_b)
+{
+    PROFILE_SCOPE("DShotRMTGroup::sendThrottleValues");
+
+    // Do all the encoding first, so the two writes go out as close together as possible
+    motor_a.loadThrottleValue(throttle_value_a);
+    motor_b.loadThrottleValue(throttle_value_b);
 
-    rmt_write_items(dshot_tx_rmt_config.channel, dshot_tx_rmt_item, DSHOT_PACKET_LENGTH, false);
+    motor_a.transmit();
+    motor_b.transmit();
 }
\ No newline at end of file
@@ -11,6 +11,7 @@
 
 // The RMT (Remote Control) module library is used for generating the DShot signal.
 #include <driver/rmt.h>
+#include <freertos/ringbuf.h>
 
 // Defines the library version
 constexpr auto DSHOT_LIB_VERSION = "0.2.4";
@@ -23,6 +24,15 @@ constexpr auto DSHOT_THROTTLE_MAX = 2047;
 constexpr auto DSHOT_NULL_PACKET = 0b0000000000000000;
 constexpr auto DSHOT_PAUSE = 21; // 21-bit is recommended
 constexpr auto DSHOT_PAUSE_BIT = 16;
+constexpr auto DSHOT_BITS_PER_NIBBLE = 4;
+constexpr auto DSHOT_NIBBLE_VALUES = 16;
+
+// Constants related to bidirectional DShot telemetry
+constexpr auto DSHOT_ERPM_FRAME_BITS = 21;          // start bit + 20 GCR bits
+constexpr auto DSHOT_ERPM_IDLE_BITS = 4;            // a level held this many command bit-times ends a capture
+constexpr auto DSHOT_ERPM_MAX_PERIOD = 0x0FFF;      // the ESC sends this when the motor is stopped
+constexpr auto DSHOT_RX_FILTER_TICKS = 20;          // ignore glitches shorter than this many APB cycles (0.25us)
+constexpr auto DSHOT_RX_RINGBUF_SIZE = 1024;
 constexpr auto F_CPU_RMT = APB_CLK_FREQ;
 constexpr auto RMT_CYCLES_PER_SEC = (F_CPU_RMT / DSHOT_CLK_DIVIDER);
 constexpr auto RMT_CYCLES_PER_ESP_CYCLE = (F_CPU / RMT_CYCLES_PER_SEC);
@@ -87,6 +97,7 @@ typedef struct dshot_config_s
     gpio_num_t gpio_num;
     uint8_t pin_num;
     rmt_channel_t rmt_channel;
+    rmt_channel_t rx_rmt_channel; // RMT_CHANNEL_MAX if we aren't receiving telemetry
     uint8_t mem_block_num;
     uint16_t ticks_per_bit;
     uint8_t clk_div;
@@ -165,6 +176,8 @@ class DShotRMT
 public:
     // Constructor for the DShotRMT class
     DShotRMT(gpio_num_t gpio, rmt_channel_t rmtChannel);
+    // Bidirectional DShot needs a second (receive) RMT channel listening on the same pin
+    DShotRMT(gpio_num_t gpio, rmt_channel_t rmtChannel, rmt_channel_t rxRmtChannel);
     DShotRMT(uint8_t pin, uint8_t channel);
     DShotRMT(uint8_t pin);
 
@@ -186,11 +199,39 @@ public:
     // void sendThrottleValue(uint16_t throttle_value, telemetric_request_t telemetric_request = NO_TELEMETRIC);
     void sendThrottleValue(uint16_t throttle_value);
 
+    // In bidirectional mode, the ESC answers every frame with its eRPM.
+    // getMotorRPM() never blocks: it decodes whatever replies have arrived since the last call,
+    // and always hands back the latest good eRPM (electrical RPM - divide by the motor's pole pairs for mechanical RPM).
+    // Returns DECODE_SUCCESS if a new reply was decoded, ERR_EMPTY_QUEUE if nothing new has arrived,
+    // ERR_CHECKSUM_FAIL if only bad replies arrived, ERR_NO_PACKETS if we've never had a good one.
+    dshot_erpm_exit_mode_t getMotorRPM(uint32_t &erpm);
+
+    // Decodes one captured telemetry frame into eRPM. Separated out from the receive path so it can be checked against recorded captures.
+    static dshot_erpm_exit_mode_t decodeERPM(const rmt_item32_t *items, size_t item_count, uint16_t ticks_per_bit, uint32_t &erpm);
+
 private:
+    friend class DShotRMTGroup;
+
+    void loadThrottleValue(uint16_t throttle_value);     // Encodes a throttle value into the RMT items, without sending it.
+    void transmit();                                     // Sends whatever's currently encoded.
+
     rmt_item32_t dshot_tx_rmt_item[DSHOT_PACKET_LENGTH]; // An array of RMT items used to send a DShot packet.
     rmt_config_t dshot_tx_rmt_config;                    // The RMT configuration used for sending DShot packets.
     dshot_config_t dshot_config;                         // The configuration for the DShot mode.
 
+    // Precomputed RMT items for every possible nibble in the current mode, plus the pause,
+    // so encoding a packet is four copies rather than sixteen bit tests.
+    rmt_item32_t nibble_rmt_items[DSHOT_NIBBLE_VALUES][DSHOT_BITS_PER_NIBBLE];
+    rmt_item32_t pause_rmt_item;
+    int32_t last_throttle_value;                         // What's currently encoded in dshot_tx_rmt_item, or -1 for nothing
+
+    RingbufHandle_t dshot_rx_ringbuf;                    // Where the RMT driver leaves captured telemetry frames
+    uint32_t last_erpm;                                  // The latest good eRPM reading
+    bool has_erpm;                                       // and whether we've had one at all
+
+    bool beginTelemetry();                               // Sets up the receive channel for bidirectional DShot.
+
+    void buildRmtItemTemplates();                               // Fills in the nibble and pause items for the current mode.
     rmt_item32_t *buildTxRmtItem(uint16_t parsed_packet);       // Constructs an RMT item from a parsed DShot packet.
     uint16_t calculateCRC(const dshot_packet_t &dshot_packet);  // Calculates the CRC checksum for a DShot packet.
     uint16_t parseRmtPaket(const dshot_packet_t &dshot_packet); // Parses an RMT packet to obtain a DShot packet.
@@ -198,4 +239,24 @@ private:
     void sendRmtPaket(const dshot_packet_t &dshot_packet); // Sends a DShot packet via RMT.
 };
 
+// Drives a pair of DShotRMT channels in lockstep
+// Both channels join an RMT sync group, so the hardware holds the first frame until the second is loaded,
+// then starts both together - both ESCs latch their new throttle at the same instant.
+// Once grouped, send through the group only: a lone sendThrottleValue() would sit waiting for its partner.
+class DShotRMTGroup
+{
+public:
+    DShotRMTGroup(DShotRMT &motor_a, DShotRMT &motor_b);
+
+    // Call after begin() on both motors
+    bool begin();
+
+    // Encodes and sends both throttle values, with the same semantics as DShotRMT::sendThrottleValue()
+    void sendThrottleValues(uint16_t throttle_value_a, uint16_t throttle_value_b);
+
+private:
+    DShotRMT &motor_a;
+    DShotRMT &motor_b;
+};
+
 #endif
\ No newline at end of file
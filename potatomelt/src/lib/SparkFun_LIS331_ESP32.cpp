@@ -1,7 +1,7 @@
 #include "SparkFun_LIS331_ESP32.h"
 #include <SPI.h>
-#include <Wire.h>
 #include <stdint.h>
+#include "../hal/hal.h"
 
 LIS331ESP::LIS331ESP(void)
 {
@@ -75,12 +75,9 @@ void LIS331ESP::setODR(data_rate drate)
 void LIS331ESP::readAxes(int16_t &x, int16_t &y, int16_t &z)
 {
   uint8_t data[6]; // create a buffer for our incoming data
-  LIS331_read(OUT_X_L, &data[0], 1);
-  LIS331_read(OUT_X_H, &data[1], 1);
-  LIS331_read(OUT_Y_L, &data[2], 1);
-  LIS331_read(OUT_Y_H, &data[3], 1);
-  LIS331_read(OUT_Z_L, &data[4], 1);
-  LIS331_read(OUT_Z_H, &data[5], 1);
+  // All six output registers are consecutive, so burst-read them in one go
+  //  rather than paying for a full bus transaction per byte.
+  LIS331_read(OUT_X_L, data, 6);
   // The data that comes out is 12-bit data, left justified, so the lower
   //  four bits of the data are always zero. We need to right shift by four,
   //  then typecase the upper data to an integer type so it does a signed
@@ -154,11 +151,11 @@ void LIS331ESP::HPFOnIntPin(bool enable, uint8_t pin)
   {
     if (pin == 1)
     {
-      data &= ~1<<3;
+      data &= ~(1<<3);
     }
     if (pin == 2)
     {
-      data &= ~1<<4;
+      data &= ~(1<<4);
     }
   }
   LIS331_write(CTRL_REG2, &data, 1);
@@ -219,11 +216,11 @@ void LIS331ESP::latchInterrupt(bool enable, uint8_t intSource)
   {
     if (intSource == 1)
     {
-      data &= ~1<<2;
+      data &= ~(1<<2);
     }
     if (intSource == 2)
     {
-      data &= ~1<<5;
+      data &= ~(1<<5);
     }
   }
   LIS331_write(CTRL_REG3, &data, 1);
@@ -363,13 +360,7 @@ void LIS331ESP::LIS331_write(uint8_t reg_address, uint8_t *data, uint8_t len)
   if (mode == USE_I2C)
   {
     // I2C write handling code
-    Wire.beginTransmission(address);
-    Wire.write(reg_address);
-    for(int i = 0; i<len; i++)
-    {
-      Wire.write(data[i]);
-    }
-    Wire.endTransmission();
+    hal_i2c_write(address, reg_address, data, len);
   }
   else
   {
@@ -389,14 +380,13 @@ void LIS331ESP::LIS331_read(uint8_t reg_address, uint8_t *data, uint8_t len)
   if (mode == USE_I2C)
   {
     // I2C read handling code
-    Wire.beginTransmission(address);
-    Wire.write(reg_address);
-    Wire.endTransmission();
-    Wire.requestFrom(address, len);
-    for (int i = 0; i<len; i++)
+    // Multi-byte reads need the auto-increment bit set, or we'd just read
+    //  the same register len times.
+    if (len > 1)
     {
-      data[i] = Wire.read();
+      reg_address |= I2C_AUTO_INCREMENT;
     }
+    hal_i2c_read(address, reg_address, data, len);
   }
   else
   {
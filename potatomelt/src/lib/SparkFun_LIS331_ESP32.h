@@ -30,6 +30,10 @@
 #define INT2_THS         0x36
 #define INT2_DURATION    0x37
 
+// Setting the MSB of the I2C sub-address makes the LIS331 auto-increment the register address,
+//  so consecutive registers can be read in a single transaction
+#define I2C_AUTO_INCREMENT 0x80
+
 class LIS331ESP
 {
   public:
@@ -0,0 +1,210 @@
+#include <Arduino.h>
+#include <stdio.h>
+#include "log.h"
+#include "melty_config.h"
+#include "telemetry.h"
+#include "hal/hal.h"
+
+static_assert((LOG_RING_RECORDS & (LOG_RING_RECORDS - 1)) == 0, "LOG_RING_RECORDS must be a power of 2");
+
+log_ring_t log_rings[portNUM_PROCESSORS];
+
+TaskHandle_t log_writer;
+
+// Takes the next free slot in this core's ring, and holds the ring until log_commit()
+// Returns nullptr, and counts a drop, if the ring's full
+log_record_t* log_reserve(const char* format, log_ring_t** ring_out) {
+    log_ring_t* ring = &log_rings[xPortGetCoreID()];
+
+    taskENTER_CRITICAL(&ring->lock);
+
+    uint32_t head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tail.load(std::memory_order_acquire) >= LOG_RING_RECORDS) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        taskEXIT_CRITICAL(&ring->lock);
+        return nullptr;
+    }
+
+    log_record_t* record = &ring->records[head & (LOG_RING_RECORDS - 1)];
+    record->format = format;
+    record->timestamp_ms = hal_millis();
+    record->text_used = 0;
+
+    *ring_out = ring;
+    return record;
+}
+
+void log_commit(log_ring_t* ring) {
+    ring->head.store(ring->head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    taskEXIT_CRITICAL(&ring->lock);
+}
+
+uint32_t log_get_dropped() {
+    uint32_t dropped = 0;
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        dropped += log_rings[i].dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
+
+// Formats a record into line, one conversion specifier at a time
+// We don't have a va_list to hand vsnprintf, so each specifier gets its own snprintf with an argument of the right type
+static void format_record(const log_record_t* record, char* line, size_t line_length) {
+    const char* f = record->format;
+    size_t used = 0;
+    int arg = 0;
+
+    while (*f && used < line_length - 1) {
+        if (*f != '%') {
+            line[used++] = *f++;
+            continue;
+        }
+
+        if (f[1] == '%') {
+            line[used++] = '%';
+            f += 2;
+            continue;
+        }
+
+        // pull out one specifier: flags, width, precision and length, up to the conversion character
+        const char* start = f++;
+        while (*f && !strchr("diouxXcsfFeEgGaAp", *f)) {
+            f++;
+        }
+        if (!*f) {
+            break;
+        }
+
+        char spec[16];
+        size_t spec_length = min((size_t) (f - start + 1), sizeof(spec) - 1);
+        memcpy(spec, start, spec_length);
+        spec[spec_length] = 0;
+
+        char conversion = *f++;
+        bool is_long_long = strstr(spec, "ll") != nullptr;
+        bool is_long = !is_long_long && strchr(spec, 'l') != nullptr;
+
+        size_t room = line_length - used;
+        int written = 0;
+
+        if (arg >= record->arg_count) {
+            // more specifiers than arguments - print the specifier as-is
+            written = snprintf(&line[used], room, "%s", spec);
+        } else {
+            const log_arg_t* value = &record->args[arg++];
+
+            switch (conversion) {
+                case 'd':
+                case 'i':
+                case 'c':
+                    if (is_long_long) written = snprintf(&line[used], room, spec, (long long) value->i);
+                    else if (is_long) written = snprintf(&line[used], room, spec, (long) value->i);
+                    else written = snprintf(&line[used], room, spec, (int) value->i);
+                    break;
+                case 'o':
+                case 'u':
+                case 'x':
+                case 'X':
+                    if (is_long_long) written = snprintf(&line[used], room, spec, (unsigned long long) value->u);
+                    else if (is_long) written = snprintf(&line[used], room, spec, (unsigned long) value->u);
+                    else written = snprintf(&line[used], room, spec, (unsigned int) value->u);
+                    break;
+                case 's':
+                    written = snprintf(&line[used], room, spec, (value->text_offset < LOG_TEXT_LENGTH) ? &record->text[value->text_offset] : "");
+                    break;
+                case 'p':
+                    written = snprintf(&line[used], room, spec, value->p);
+                    break;
+                default:
+                    written = snprintf(&line[used], room, spec, value->f);
+                    break;
+            }
+        }
+
+        if (written > 0) {
+            used = min(used + written, line_length - 1);
+        }
+    }
+
+    line[used] = 0;
+}
+
+static void write_line(uint32_t timestamp_ms, const char* line) {
+#ifdef TELEMETRY_BINARY_ENABLED
+    // a timestamp, then the text - without the trailing whitespace, the decoder's doing lines for us
+    uint8_t payload[TELEMETRY_MAX_PAYLOAD];
+    size_t length = strlen(line);
+    while (length > 0 && isspace(line[length - 1])) {
+        length--;
+    }
+    length = min(length, sizeof(payload) - sizeof(timestamp_ms));
+
+    memcpy(payload, &timestamp_ms, sizeof(timestamp_ms));
+    memcpy(&payload[sizeof(timestamp_ms)], line, length);
+    telemetry_send(TELEMETRY_LOG, payload, sizeof(timestamp_ms) + length);
+#else
+    // this is the one place that's allowed to wait on the serial port
+    (void) timestamp_ms;
+    Serial.print(line);
+#endif
+}
+
+// Drains both rings, formatting and printing as it goes
+// It's the lowest-priority thing we run, so it only gets the CPU once everything else is waiting
+void log_task(void*) {
+    char line[LOG_LINE_LENGTH];
+    uint32_t reported_dropped = 0;
+
+    while (true) {
+        bool idle = true;
+
+        for (int i = 0; i < portNUM_PROCESSORS; i++) {
+            log_ring_t* ring = &log_rings[i];
+            uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+
+            while (tail != ring->head.load(std::memory_order_acquire)) {
+                log_record_t* record = &ring->records[tail & (LOG_RING_RECORDS - 1)];
+                format_record(record, line, sizeof(line));
+                uint32_t timestamp_ms = record->timestamp_ms;
+
+                // hand the slot back before we wait on the serial port
+                tail++;
+                ring->tail.store(tail, std::memory_order_release);
+
+                write_line(timestamp_ms, line);
+                idle = false;
+            }
+        }
+
+        uint32_t dropped = log_get_dropped();
+        if (dropped != reported_dropped) {
+            snprintf(line, sizeof(line), "(%lu log messages dropped) \n", (unsigned long) (dropped - reported_dropped));
+            write_line(hal_millis(), line);
+            reported_dropped = dropped;
+        }
+
+        if (idle) {
+            vTaskDelay(pdMS_TO_TICKS(LOG_TASK_INTERVAL_MS));
+        }
+    }
+}
+
+// Must be called before anything logs
+void log_init() {
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        log_rings[i].head = 0;
+        log_rings[i].tail = 0;
+        log_rings[i].dropped = 0;
+        portMUX_INITIALIZE(&log_rings[i].lock);
+    }
+
+    xTaskCreatePinnedToCore(
+        log_task,               // the function
+        "log",                  // name the task
+        4096,                   // stack depth
+        NULL,                   // params
+        LOG_TASK_PRIORITY,      // priority
+        &log_writer,            // task handle
+        1                       // core affinity
+    );
+}
\ No newline at end of file
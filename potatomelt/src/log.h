@@ -0,0 +1,98 @@
+#ifndef _LOG_h
+#define _LOG_h
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+
+// Deferred logging
+// LOG() works like Serial.printf, but it never formats anything and never waits on the serial port. It just copies the
+// format string pointer and the raw arguments into a ring buffer for the core it's running on, and moves on.
+// A low-priority task does the formatting and the printing later. If the ring's full, the message is dropped and counted.
+// Format strings must be string literals - only the pointer gets kept. String arguments are copied, up to LOG_TEXT_LENGTH.
+
+#define LOG_MAX_ARGS 8
+#define LOG_TEXT_LENGTH 48          // room for copies of all of a message's string arguments
+#define LOG_RING_RECORDS 32         // per core. Must be a power of 2
+#define LOG_LINE_LENGTH 256
+
+typedef union log_arg_t {
+    int64_t i;
+    uint64_t u;
+    double f;
+    const void* p;
+    uint16_t text_offset;           // string arguments live in the record's text area
+} log_arg_t;
+
+typedef struct log_record_t {
+    const char* format;
+    uint32_t timestamp_ms;
+    uint8_t arg_count;
+    uint8_t text_used;
+    log_arg_t args[LOG_MAX_ARGS];
+    char text[LOG_TEXT_LENGTH];
+} log_record_t;
+
+// One ring per core. Anything on a core can write to its ring, so writers take turns through a critical section -
+// that's just masking interrupts on this core, since nothing on the other core ever touches it.
+// The log task is the only reader.
+typedef struct log_ring_t {
+    log_record_t records[LOG_RING_RECORDS];
+    std::atomic<uint32_t> head;     // records ever written
+    std::atomic<uint32_t> tail;     // records ever read
+    std::atomic<uint32_t> dropped;
+    portMUX_TYPE lock;
+} log_ring_t;
+
+void log_init();
+uint32_t log_get_dropped();
+
+// the pieces LOG() is built from
+log_record_t* log_reserve(const char* format, log_ring_t** ring);
+void log_commit(log_ring_t* ring);
+
+inline void log_pack(log_record_t* record, int i, int value) { record->args[i].i = value; }
+inline void log_pack(log_record_t* record, int i, long value) { record->args[i].i = value; }
+inline void log_pack(log_record_t* record, int i, long long value) { record->args[i].i = value; }
+inline void log_pack(log_record_t* record, int i, unsigned int value) { record->args[i].u = value; }
+inline void log_pack(log_record_t* record, int i, unsigned long value) { record->args[i].u = value; }
+inline void log_pack(log_record_t* record, int i, unsigned long long value) { record->args[i].u = value; }
+inline void log_pack(log_record_t* record, int i, double value) { record->args[i].f = value; }
+inline void log_pack(log_record_t* record, int i, const void* value) { record->args[i].p = value; }
+
+inline void log_pack(log_record_t* record, int i, const char* value) {
+    size_t room = LOG_TEXT_LENGTH - record->text_used;
+    size_t len = (value == nullptr || room == 0) ? 0 : strnlen(value, room - 1);
+
+    record->args[i].text_offset = record->text_used;
+    if (room > 0 && value != nullptr) {
+        memcpy(&record->text[record->text_used], value, len);
+        record->text[record->text_used + len] = 0;
+        record->text_used += len + 1;
+    }
+}
+
+inline void log_pack(log_record_t* record, int i, char* value) { log_pack(record, i, (const char*) value); }
+
+template <typename... Args>
+void log_deferred(const char* format, Args... args) {
+    static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "too many arguments to LOG()");
+
+    log_ring_t* ring;
+    log_record_t* record = log_reserve(format, &ring);
+    if (record == nullptr) {
+        return;
+    }
+
+    int i = 0;
+    int unpack[] = {0, (log_pack(record, i++, args), 0)...};
+    (void) unpack;
+    record->arg_count = i;
+
+    log_commit(ring);
+}
+
+#define LOG(format, ...) log_deferred(format, ##__VA_ARGS__)
+
+#endif
\ No newline at end of file
@@ -2,36 +2,71 @@
 #include <driver/rmt.h>
 
 // This file has all the hard-coded settings for Potatomelt
+// Settings marked (default) are only starting points - the robot keeps its own copy in flash, per robot profile (see config.h)
 
 // ------------ safety settings ----------------------
 #define CONTROL_UPDATE_TIMEOUT_MS 3000
 
+// ------------ Loop timing --------------------------
+#define HOTLOOP_FREQ_HZ 4000                      // How often the hot loop updates motors and LEDs. 1000-10000hz
+#define CONTROL_LOOP_INTERVAL_MS 10               // How often loop() recalculates spin parameters. New controller input wakes it up early, to pick up translation
+#define CONTROLLER_POLL_RATE_HZ 1000              // How often the input task checks bluepad32 for new controller packets
+#define CONTROLLER_INPUT_PRIORITY 2               // Must outrank loop(), which shares its core, so packets get picked up while loop() is busy
+#define ACCELEROMETER_SAMPLE_RATE_HZ 400          // How often the sampler task reads the accelerometers. Also sets their ODR
+#define ACCELEROMETER_SAMPLER_PRIORITY 2          // Must outrank loop(), which shares its core and reads its samples
+#define SPIN_CONTROLLER_PRIORITY 2                // The RPM PID runs after every accelerometer sample, so it shares the sampler's priority
+#define SPIN_CONTROLLER_TIMEOUT_MS 10             // If the sampler stalls, the PID carries on at this interval off the estimator's extrapolation
+#define LOG_TASK_PRIORITY 0                       // Log messages get formatted and printed when there's nothing else to do
+#define LOG_TASK_INTERVAL_MS 10                   // How often the log task checks for new messages, once it's caught up
+#define STORAGE_FLUSH_PRIORITY 1                  // Settings get written to flash in the background, at the same priority as loop()
+#define STORAGE_FLUSH_POLL_MS 100                 // How often the background writer checks for changed settings
+#define STORAGE_FLUSH_QUIET_MS 1000               // How long settings have to stop changing before they get written. Never written while spinning
+#define ACCELEROMETER_SATURATION_COUNTS 2040      // Raw readings (out of +/-2047) past this mean the accelerometer is pinned at its 400g limit
+
+// ------------ Robot profiles -----------------------
+// One board, more than one robot. Press Y while not spinning to switch between them
+#define DEFAULT_PROFILE PROFILE_BEETLE            // PROFILE_ANT or PROFILE_BEETLE
+#define ANT_ACCELEROMETER_RADIUS_CM 3.415f        // (default) distance from the center of rotation to the accelerometers
+#define BEETLE_ACCELEROMETER_RADIUS_CM 5.13f
+#define ANT_BATTERY_CELL_COUNT 4                  // (default) How many cells are in the battery?
+#define BEETLE_BATTERY_CELL_COUNT 4
+
 // ------------ Spin control settings ----------------
-#define ACCELEROMETER_HARDWARE_RADIUS_CM 5.13f
-// Ant-tato distance: 3.415f
-// Beetle-tato distance: 5.13f
-#define LED_OFFSET_PERCENT 47
+#define LED_OFFSET_PERCENT 47                     // (default)
 
 #define LEFT_RIGHT_HEADING_CONTROL_DIVISOR 2.0f   // How quick steering while melting is (larger values = slower)
 #define MIN_TRACKING_RPM 400
 #define MAX_TRACKING_ROTATION_INTERVAL_US (1.0f / MIN_TRACKING_RPM) * 60 * 1000 * 1000 // don't track heading if we are this slow (also puts upper limit on time spent in melty loop for safety)
 
-#define MAX_TRACKING_RPM 3000;
+#define MAX_TRACKING_RPM 3000
 
 // ------------ control parameters -------------------
 #define CONTROL_TRANSLATE_DEADZONE 50
 #define CONTROL_SPIN_SPEED_DEADZONE 200
 #define CONTROL_THROTTLE_MINIMUM 500
 
-#define TANK_FORBACK_POWER_SCALE 0.40f // Scale the power waaaaay down on tank mode
-#define TANK_TURNING_POWER_SCALE 0.40f // because we're sitting on a pair of ungeared brushless motors
+#define TANK_FORBACK_POWER_SCALE 0.40f // (default) Scale the power waaaaay down on tank mode
+#define TANK_TURNING_POWER_SCALE 0.40f // (default) because we're sitting on a pair of ungeared brushless motors
 
 // ------------ PID tuning ---------------------------
 // Tuning PIDs is an art. See: https://pidexplained.com/how-to-tune-a-pid-controller/
+// The PID runs at ACCELEROMETER_SAMPLE_RATE_HZ. Throttle is out of 1000, and time is in seconds
+// These are all (default)
 
 #define PID_KP 1.0                                  // Proportional Gain - higher values give more sensitivity, lower values give more stability
 #define PID_KI 0.4                                  // Integral - damping on the rebound curves. Lower values = slower to respond, but less bounces
 #define PID_KD 0.0                                  // Derivative - useful to prevent overshoot of target value.
+#define PID_KFF (1.0f / SPIN_MODEL_RPM_PER_THROTTLE) // Feed-forward - throttle per RPM of target. Gets most of the way there before the PID has to do anything
+                                                    // This is only the starting point - see below
+
+// ------------ Feed-forward learning ---------------
+// While we're holding steady at the target RPM, the spin controller learns what throttle that takes, across the RPM range.
+// Each profile remembers its own, so the next spin-up starts from the right throttle instead of waiting for the PID's integral to wind up
+
+#define FEED_FORWARD_LEARN_RATE 0.5f              // How quickly we learn - the fraction of the way to what we're seeing, per second
+#define FEED_FORWARD_SETTLED_PERCENT 5.0f         // Only learn within this % of the target RPM,
+#define FEED_FORWARD_SETTLED_RPM_PER_S 100.0f     // while the RPM is this steady,
+#define FEED_FORWARD_MIN_CONFIDENCE 0.5f          // and the RPM estimator's at least this sure of itself
 
 // ------------- controller button mappings ----------
 #define XBOX_DPAD_UP 0x01
@@ -39,10 +74,12 @@
 #define XBOX_DPAD_DOWN 0x02
 #define XBOX_DPAD_LEFT 0x08
 #define XBOX_BUTTON_X 0x04
+#define XBOX_BUTTON_Y 0x08
 
 // ------------ Pin and RMT Mappings -----------------
 
 #define NEOPIXEL_PIN GPIO_NUM_7
+#define NEOPIXEL_COUNT 2                          // How many neopixels are chained off NEOPIXEL_PIN. They all show the same color
 #define MOTOR_1_PIN GPIO_NUM_1
 #define MOTOR_2_PIN GPIO_NUM_2
 
@@ -53,14 +90,65 @@
 #define NEOPIXEL_RMT RMT_CHANNEL_0
 #define MOTOR_1_RMT RMT_CHANNEL_1
 #define MOTOR_2_RMT RMT_CHANNEL_2
+#define MOTOR_1_RX_RMT RMT_CHANNEL_4              // receive channels, for bidirectional DShot telemetry
+#define MOTOR_2_RX_RMT RMT_CHANNEL_5
+
+// ------------ ESC Telemetry -----------------------
+
+// #define DSHOT_BIDIRECTIONAL_ENABLED            // if enabled - the ESCs report their eRPM back down the signal wire. Needs ESC firmware support (BLHeli_32, Bluejay, AM32)
+#define MOTOR_POLE_PAIRS 7                        // eRPM / pole pairs = motor RPM. Pole pairs is the number of magnets on the motor bell, divided by 2
+#define MOTOR_TO_ROBOT_RPM_RATIO 0.30f            // Robot RPM per motor RPM: wheel radius / distance from the center of the robot to the wheel
+#define MOTOR_RPM_TIMEOUT_US 2000                 // ESC telemetry older than this is stale. The ESCs reply to every frame, so that's 8 missed replies at 4khz
+
+// ------------ RPM estimation -----------------------
+// The RPM estimator fuses the accelerometers, ESC telemetry and the throttle. Each source gets trusted according to how noisy it is.
+
+#define ESTIMATOR_ACCEL_RPM_STDDEV 40.0f                // How noisy the accelerometer RPM is
+#define ESTIMATOR_MOTOR_RPM_STDDEV 80.0f                // How noisy the ESC telemetry RPM is, once converted to robot RPM (wheels slip!)
+#define ESTIMATOR_THROTTLE_RPM_PER_S_STDDEV 3000.0f     // How far off the throttle model's acceleration can be
+#define ESTIMATOR_JERK_STDDEV 20000.0f                  // How quickly our acceleration can change, in RPM/s^2
+#define ESTIMATOR_CONFIDENCE_RPM_PERCENT 10.0f          // Confidence hits zero when the estimate's standard deviation reaches this % of RPM
+
+#define SPIN_MODEL_RPM_PER_THROTTLE 3.5f          // Roughly what RPM each unit of throttle (out of 1000) settles at
+#define SPIN_MODEL_TIME_CONSTANT_S 0.5f           // Roughly how long the robot takes to get 2/3 of the way to a new RPM
+
+// ------------ Auto-calibration ---------------------
+// Press Y while spinning to step through every target RPM, and fit the accelerometer correction against ESC telemetry
+// Needs DSHOT_BIDIRECTIONAL_ENABLED, and a good MOTOR_TO_ROBOT_RPM_RATIO - the calibration is only as good as that ratio
+
+#define AUTOCAL_SETTLE_MS 1500                    // Minimum time at each step before we start measuring
+#define AUTOCAL_SETTLED_RPM_PER_S 100.0f          // And how still the RPM estimate needs to be before we trust it
+#define AUTOCAL_SAMPLES_PER_STEP 50               // How many readings to average at each step
+#define AUTOCAL_STEP_TIMEOUT_MS 6000              // Give up on a step that hasn't settled by now, and move on to the next
+#define AUTOCAL_REFERENCE_MAX_AGE_US 5000         // ESC telemetry older than this doesn't count - a step that loses it starts measuring over
+
+// ------------ Telemetry ----------------------------
+// By default, status gets printed over serial as text every STATUS_LOG_INTERVAL_MS
+// With binary telemetry, it goes out as framed binary instead - faster, never blocks, and tools/telemetry_decode.py can turn it into CSV
+// Binary telemetry won't make any sense in the serial monitor!
+
+// #define TELEMETRY_BINARY_ENABLED
+#define STATUS_LOG_INTERVAL_MS 500                // How often to print status as text
+#define TELEMETRY_STATUS_INTERVAL_MS 50           // How often to send status as binary telemetry
+
+// ------------ Profiling ----------------------------
+// Times the hot paths off the CPU cycle counter. Send 'p' over serial for a report of each one's min/mean/p99/max
+// Leave this off for competition - with it off, the probes compile away to nothing
+
+// #define PROFILING_ENABLED
+
+// ------------ Flight recorder ----------------------
+// The hot loop records every tick. Disconnects, failsafes and a flat battery freeze the recording - send 'd' over serial to dump it
+
+#define FLIGHT_RECORDER_RECORDS 8192              // Records kept if the board has PSRAM (24 bytes each). Must be a power of 2
+#define FLIGHT_RECORDER_INTERNAL_RECORDS 1024     // Records kept in internal RAM if it doesn't. Must be a power of 2
+#define FLIGHT_RECORDER_POST_TRIGGER_PERCENT 25   // How much of the buffer to keep recording after a trigger
 
 // ------------ Battery Configuration ---------------
 
 #define BATTERY_ALERT_ENABLED                     // if enabled - heading LED will flicker when battery voltage is low
 #define BATTERY_CRIT_HALT_ENABLED                 // if enabled - robot will halt when battery voltage is critically low
 #define BATTERY_VOLTAGE_DIVIDER 8.24              // From the PCB - what's the voltage divider betweeen the battery + and the sense line?
-#define BATTERY_CELL_COUNT 4                      // How many cells are in the battery?
-// Beetle-tato count: 4
 #define BATTERY_CELL_FULL_VOLTAGE 4.2             // What voltage is a fully-charged cell? Standard lipos are 4.2v, other chemistries will vary
 #define BATTERY_CELL_EMPTY_VOLTAGE 3.2            // And on the other hand, what voltage is an empty cell? We're going to cut off at 3.2v/cell
 #define LOW_BAT_REPEAT_READS_BEFORE_ALARM 20      // Requires this many ADC reads below threshold before halting the robot
\ No newline at end of file
@@ -0,0 +1,63 @@
+#include <Arduino.h>
+#include "profiler.h"
+#include "histogram.h"
+#include "log.h"
+
+ProfileProbe* probes = nullptr;
+portMUX_TYPE probes_lock = portMUX_INITIALIZER_UNLOCKED;
+
+ProfileProbe::ProfileProbe(const char* name) : name(name) {
+    count = 0;
+    total_cycles = 0;
+    min_cycles = UINT32_MAX;
+    max_cycles = 0;
+    for (int i = 0; i < PROFILE_HISTOGRAM_BUCKETS; i++) {
+        histogram[i] = 0;
+    }
+
+    // probes get created the first time their scope runs, from whichever task that is
+    taskENTER_CRITICAL(&probes_lock);
+    next = probes;
+    probes = this;
+    taskEXIT_CRITICAL(&probes_lock);
+}
+
+// bucket n holds durations from 2^(n-1) up to 2^n cycles - and bucket 0 holds the zeros
+static uint32_t profile_bucket_start(int bucket) {
+    return (bucket == 0) ? 0 : (1u << (bucket - 1));
+}
+
+// The duration that fraction of runs came in under, in cycles
+static uint32_t percentile(const ProfileProbe* probe, uint32_t count, float fraction) {
+    return histogram_percentile(probe->histogram, PROFILE_HISTOGRAM_BUCKETS, profile_bucket_start, count, fraction,
+        probe->min_cycles, probe->max_cycles);
+}
+
+// The probes are only updated by the tasks they're timing, so this can catch one mid-update
+// That'll skew a single report by one run at most, which is good enough for profiling
+void profile_report() {
+    float cycles_per_us = hal_cycles_per_us();
+
+    LOG("Profile: %-28s %8s %9s %9s %9s %9s \n", "probe", "runs", "min us", "mean us", "p99 us", "max us");
+
+    for (ProfileProbe* probe = probes; probe != nullptr; probe = probe->next) {
+        uint32_t count = probe->count;
+        if (count == 0) {
+            continue;
+        }
+
+        LOG("Profile: %-28s %8lu %9.2f %9.2f %9.2f %9.2f \n", probe->name, (unsigned long) count,
+            probe->min_cycles / cycles_per_us,
+            (float) (probe->total_cycles / count) / cycles_per_us,
+            percentile(probe, count, 0.99f) / cycles_per_us,
+            probe->max_cycles / cycles_per_us);
+
+        probe->count = 0;
+        probe->total_cycles = 0;
+        probe->min_cycles = UINT32_MAX;
+        probe->max_cycles = 0;
+        for (int i = 0; i < PROFILE_HISTOGRAM_BUCKETS; i++) {
+            probe->histogram[i] = 0;
+        }
+    }
+}
\ No newline at end of file
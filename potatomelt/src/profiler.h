@@ -0,0 +1,68 @@
+#ifndef _PROFILER_h
+#define _PROFILER_h
+
+#include <stdint.h>
+#include "melty_config.h"
+#include "hal/hal.h"
+
+// Hot-path profiling
+// Drop PROFILE_SCOPE("name") at the top of a function (or any block), and every run of it gets timed off the CPU cycle counter.
+// Each probe keeps its min, mean and max, plus a log2 histogram for percentiles. Send 'p' over serial for a report.
+// Without PROFILING_ENABLED, PROFILE_SCOPE compiles to nothing.
+
+#define PROFILE_HISTOGRAM_BUCKETS 32
+
+// One per PROFILE_SCOPE. Only ever created as a function-local static, so it lives forever
+class ProfileProbe {
+    public:
+        ProfileProbe(const char* name);
+
+        void record(uint32_t cycles) {
+            count++;
+            total_cycles += cycles;
+            if (cycles < min_cycles) min_cycles = cycles;
+            if (cycles > max_cycles) max_cycles = cycles;
+
+            // bucket n holds durations from 2^(n-1) up to 2^n cycles
+            int bucket = (cycles == 0) ? 0 : 32 - __builtin_clz(cycles);
+            if (bucket >= PROFILE_HISTOGRAM_BUCKETS) bucket = PROFILE_HISTOGRAM_BUCKETS - 1;
+            histogram[bucket]++;
+        }
+
+        const char* name;
+        ProfileProbe* next;             // all the probes, in a list
+        volatile uint32_t count;
+        volatile uint64_t total_cycles;
+        volatile uint32_t min_cycles;
+        volatile uint32_t max_cycles;
+        volatile uint32_t histogram[PROFILE_HISTOGRAM_BUCKETS];
+};
+
+// Times from construction to destruction
+class ProfileScope {
+    public:
+        ProfileScope(ProfileProbe* probe) : probe(probe), started_at(hal_cycle_count()) {
+        }
+
+        ~ProfileScope() {
+            probe->record(hal_cycle_count() - started_at);
+        }
+    private:
+        ProfileProbe* probe;
+        uint32_t started_at;
+};
+
+// prints a line per probe, then starts them all counting afresh
+void profile_report();
+
+#ifdef PROFILING_ENABLED
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) \
+    static ProfileProbe PROFILE_CONCAT(profile_probe_, __LINE__)(name); \
+    ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(&PROFILE_CONCAT(profile_probe_, __LINE__))
+#else
+#define PROFILE_SCOPE(name)
+#endif
+
+#endif
\ No newline at end of file
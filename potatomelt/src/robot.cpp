@@ -1,5 +1,9 @@
 #include "robot.h"
 #include "melty_config.h"
+#include "subsystems/storage.h"
+#include "hal/hal.h"
+#include "sine_table.h"
+#include "profiler.h"
 
 int perk2dshot(int throttle) {
   if (throttle == 0) {
@@ -15,11 +19,27 @@ int perk2dshot(int throttle) {
 }
 
 Robot::Robot():
-    motor1(MOTOR_1_PIN, MOTOR_1_RMT),
-    motor2(MOTOR_2_PIN, MOTOR_2_RMT)  {
+    motor1(MOTOR_1_PIN, MOTOR_1_RMT, MOTOR_1_RX_RMT),
+    motor2(MOTOR_2_PIN, MOTOR_2_RMT, MOTOR_2_RX_RMT),
+    motors(motor1, motor2)  {
 }
 
 void Robot::update_loop(robot_status state, spin_control_parameters_t* spin_params, tank_control_parameters_t* tank_params) {
+    PROFILE_SCOPE("Robot::update_loop");
+
+    last_state = state;
+    led_on = false;
+    battery_percent = spin_params->battery_percent;
+
+    // keep track of rotation phase every tick, so we don't lose our place when the loop stalls or the RPM changes
+    advance_phase((state == SPINNING) ? spin_params->phase_rate : 0);
+
+    // the spin controller runs on its own, at the sensor rate - just pick up whatever it wants now
+    spin_throttle = spin_controller.get_throttle();
+
+    // and let the RPM estimator know what the motors are up to
+    update_motor_feedback(state == SPINNING, spin_throttle);
+
     switch(state) {
         default:
         case NO_CONTROLLER:
@@ -39,63 +59,68 @@ void Robot::update_loop(robot_status state, spin_control_parameters_t* spin_para
     }
 }
 
-void Robot::spin(spin_control_parameters_t* spin_params) {
-    long time_spent_this_rotation_us = micros() - rotation_started_at_us;
+// Integrates the rotation rate into our phase
+// Phase is a uint32_t that wraps once per rotation, so if we've stalled for several rotations, the multiply just wraps that many times
+// The rate itself is slewed linearly towards the latest target over PHASE_RATE_RAMP_US, so the phase doesn't kink every time loop() updates the RPM
+void Robot::advance_phase(uint32_t target_phase_rate) {
+    unsigned long now = hal_micros();
 
-    if (time_spent_this_rotation_us > spin_params->rotation_interval_us) {
-        time_spent_this_rotation_us -= spin_params->rotation_interval_us;
-        rotation_started_at_us += spin_params->rotation_interval_us;
+    if (target_phase_rate != ramp_to_phase_rate) {
+        ramp_from_phase_rate = phase_rate;
+        ramp_to_phase_rate = target_phase_rate;
+        ramp_started_at_us = now;
     }
 
-    double throttle_offset = 0;
+    unsigned long ramp_elapsed_us = now - ramp_started_at_us;
+    if (ramp_elapsed_us >= PHASE_RATE_RAMP_US) {
+        phase_rate = ramp_to_phase_rate;
+    } else {
+        int64_t rate_change = (int64_t) ramp_to_phase_rate - ramp_from_phase_rate;
+        phase_rate = ramp_from_phase_rate + (rate_change * (int64_t) ramp_elapsed_us) / PHASE_RATE_RAMP_US;
+    }
 
-    // translation math time - first, how far into this phase of rotation are we?
-    long micros_into_phase = time_spent_this_rotation_us % (spin_params->rotation_interval_us/2);
-    float phase_progress = 2.0 * micros_into_phase / (spin_params->rotation_interval_us);
+    uint32_t elapsed_us = now - phase_updated_at_us;
+    phase += phase_rate * elapsed_us;
+    phase_updated_at_us = now;
+}
 
-    // What does that mean the sine (approximation) of that distance into the phase is?
-    // Using a parabolic approximation of half a sine wave, that goes from Y=0 to 1 and back in the range X=0..1
-    float phase_offset_fraction = -4 * phase_progress * (phase_progress - 1);
+void Robot::spin(spin_control_parameters_t* spin_params) {
+    PROFILE_SCOPE("Robot::spin");
 
-    throttle_offset = (double) (phase_offset_fraction * spin_params->max_throttle_offset);
+    // translation math time - how far are we into the translation cycle, and what's the sine of that?
+    // motor 1 pushes hardest a quarter turn after translate_phase, and motor 2 (on the other side) pushes hardest half a turn after that
+    int max_throttle_offset = (int) (spin_throttle * spin_params->translate_fraction);
+    int throttle_offset = sine_scale(phase - spin_params->translate_phase, max_throttle_offset);
 
-    if (time_spent_this_rotation_us >= spin_params->motor_start_phase_1 && time_spent_this_rotation_us <= spin_params->motor_start_phase_2) {
-        motor1.sendThrottleValue(perk2dshot(spin_params->throttle_perk + throttle_offset));
-        motor2.sendThrottleValue(perk2dshot(spin_params->throttle_perk - throttle_offset));
-    } else {
-        motor1.sendThrottleValue(perk2dshot(spin_params->throttle_perk - throttle_offset));
-        motor2.sendThrottleValue(perk2dshot(spin_params->throttle_perk + throttle_offset));
-    }
+    send_throttles(spin_throttle + throttle_offset, spin_throttle - throttle_offset);
    
     // displays heading LED at correct location
-    if (spin_params->led_start > spin_params->led_stop) {
-    // the LED will be on across 0, so each loop we're shutting it off and then turning it on
-    if (time_spent_this_rotation_us >= spin_params->led_start || time_spent_this_rotation_us <= spin_params->led_stop) {
-      leds.leds_on_gradient(spin_params->battery_percent);
-    } else {
-      leds.leds_off();
-    }
-  } else {
-    if (time_spent_this_rotation_us >= spin_params->led_start && time_spent_this_rotation_us <= spin_params->led_stop) {
+    // unsigned phase math takes care of the beacon wrapping across 0
+    if (phase - spin_params->led_start <= spin_params->led_stop - spin_params->led_start) {
       leds.leds_on_gradient(spin_params->battery_percent);
+      led_on = true;
     } else {
       leds.leds_off();
     }
-  }
+}
+
+// throttles are in perk, -1000 - 1000
+void Robot::send_throttles(int motor1_perk, int motor2_perk) {
+    motor1_throttle = motor1_perk;
+    motor2_throttle = motor2_perk;
+    motors.sendThrottleValues(perk2dshot(motor1_perk), perk2dshot(motor2_perk));
 }
 
 void Robot::motors_stop() {
-    motor1.sendThrottleValue(0);
-    motor2.sendThrottleValue(0);
+    send_throttles(0, 0);
 }
 
 void Robot::drive_tank(tank_control_parameters_t* params) {
     if (abs(params->translate_forback) > CONTROL_TRANSLATE_DEADZONE || abs(params->turn_lr) > CONTROL_TRANSLATE_DEADZONE) {
-        int forback = params->translate_forback * TANK_FORBACK_POWER_SCALE;
-        int leftright = params->turn_lr * TANK_TURNING_POWER_SCALE;
+        int forback = params->translate_forback * params->forback_power_scale;
+        int leftright = params->turn_lr * params->turning_power_scale;
 
-        motor1.sendThrottleValue(perk2dshot(forback + leftright));
-        motor2.sendThrottleValue(perk2dshot(-1 * (forback - leftright)));
+        send_throttles(forback + leftright, -1 * (forback - leftright));
     } else {
         motors_stop();
     }
@@ -105,8 +130,112 @@ float Robot::get_z_buffer() {
     return imu.z_accel_buffer;
 }
 
-float Robot::get_rpm(int target_rpm) {
-    return imu.get_rpm(target_rpm);
+float Robot::get_rpm() {
+    return imu.get_rpm();
+}
+
+// Collects the ESCs' eRPM telemetry, and passes it and the throttle on to the IMU's RPM estimator
+void Robot::update_motor_feedback(bool spinning, int throttle_perk) {
+    uint32_t erpm1;
+    uint32_t erpm2;
+
+    dshot_erpm_exit_mode_t status1 = motor1.getMotorRPM(erpm1);
+    dshot_erpm_exit_mode_t status2 = motor2.getMotorRPM(erpm2);
+
+    unsigned long now = hal_micros();
+
+    if (status1 == DECODE_SUCCESS) {
+        motor1_rpm = (float) erpm1 / MOTOR_POLE_PAIRS;
+        motor1_rpm_at_us = now;
+    }
+    if (status2 == DECODE_SUCCESS) {
+        motor2_rpm = (float) erpm2 / MOTOR_POLE_PAIRS;
+        motor2_rpm_at_us = now;
+    }
+    if (status1 == DECODE_SUCCESS || status2 == DECODE_SUCCESS) {
+        motor_rpms_at_us = now;
+    }
+
+    // getMotorRPM() hands back the last reading forever once an ESC goes quiet - so it's only good while it's recent
+    motor_rpms_valid = status1 != ERR_BIDIRECTION_DISABLED && status1 != ERR_NO_PACKETS
+        && status2 != ERR_BIDIRECTION_DISABLED && status2 != ERR_NO_PACKETS
+        && now - motor1_rpm_at_us <= MOTOR_RPM_TIMEOUT_US && now - motor2_rpm_at_us <= MOTOR_RPM_TIMEOUT_US;
+
+    imu_motor_feedback_t feedback;
+    feedback.throttle_perk = spinning ? throttle_perk : 0;
+
+    // the wheels only tell us about the robot's rotation while we're spinning in place
+    feedback.robot_rpm_valid = spinning && motor_rpms_valid;
+    feedback.robot_rpm = (motor1_rpm + motor2_rpm) / 2 * MOTOR_TO_ROBOT_RPM_RATIO;
+    feedback.robot_rpm_at_us = motor_rpms_at_us;
+
+    feedback.motor1_rpm = motor1_rpm;
+    feedback.motor2_rpm = motor2_rpm;
+    feedback.motor_rpms_valid = motor_rpms_valid;
+    feedback.motor_rpms_at_us = ((long) (motor1_rpm_at_us - motor2_rpm_at_us) < 0) ? motor1_rpm_at_us : motor2_rpm_at_us;
+
+    imu.set_motor_feedback(&feedback);
+}
+
+// Motor RPMs, from the ESCs' eRPM telemetry, as the hot loop last published them
+// Returns false if we don't have a recent reading from both motors. at_us, if given, gets when the older one came in
+bool Robot::get_motor_rpms(float* motor1_rpm, float* motor2_rpm, unsigned long* at_us) {
+    imu_motor_feedback_t feedback;
+    imu.get_motor_feedback(&feedback);
+
+    *motor1_rpm = feedback.motor1_rpm;
+    *motor2_rpm = feedback.motor2_rpm;
+    if (at_us != nullptr) {
+        *at_us = feedback.motor_rpms_at_us;
+    }
+    return feedback.motor_rpms_valid;
+}
+
+void Robot::get_rpm_estimate(rpm_estimate_t* estimate) {
+    imu.get_rpm_estimate(estimate);
+}
+
+void Robot::get_imu_sample(imu_sample_t* sample) {
+    imu.get_sample(sample);
+}
+
+void Robot::set_accel_correction_curve(correction_curve_t* curve) {
+    imu.set_accel_correction_curve(curve);
+}
+
+// What the hot loop just did - called from the hot loop, after update_loop()
+void Robot::fill_flight_record(flight_record_t* record) {
+    record->phase = phase;
+    record->phase_rate = phase_rate;
+    record->motor1_throttle = motor1_throttle;
+    record->motor2_throttle = motor2_throttle;
+    record->state = last_state;
+    record->battery_percent = battery_percent;
+    record->flags = led_on ? FLIGHT_RECORD_LED_ON : 0;
+
+    // the estimator runs on the other core, so this never waits on it
+    rpm_estimate_t estimate;
+    imu.get_rpm_estimate(&estimate);
+    record->estimated_rpm = (uint16_t) min(estimate.rpm, 65535.0f);
+}
+
+// The active profile has changed - pick up its settings
+void Robot::reload_config() {
+    imu.load_accel_correction();
+    spin_controller.load_config(get_active_store()->get_config());
+}
+
+// What the spin controller should be chasing - it throttles down as soon as spinning goes false
+void Robot::set_spin_target(bool spinning, float target_rpm) {
+    spin_controller.set_setpoint(spinning, target_rpm);
+
+    // keep whatever feed-forward it learned on the way - storage won't write it until we've stopped, anyway
+    if (spin_target_enabled && !spinning) {
+        correction_curve_t curve;
+        spin_controller.get_learned_feed_forward(&curve);
+        get_active_store()->set_feed_forward_curve(&curve);
+    }
+    spin_target_enabled = spinning;
 }
 
 int Robot::get_battery() {
@@ -123,6 +252,14 @@ float Robot::get_accel_trim(int target_rpm) {
 
 void Robot::init() {
     imu.init();
+    spin_controller.load_config(get_active_store()->get_config());
+    spin_controller.init(&imu);
+#ifdef DSHOT_BIDIRECTIONAL_ENABLED
+    motor1.begin(DSHOT300, true);
+    motor2.begin(DSHOT300, true);
+#else
     motor1.begin(DSHOT300);
     motor2.begin(DSHOT300);
+#endif
+    motors.begin();
 }
\ No newline at end of file
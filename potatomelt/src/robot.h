@@ -2,25 +2,34 @@
 #include "subsystems/battery.h"
 #include "subsystems/imu.h"
 #include "subsystems/led.h"
+#include "subsystems/spin_controller.h"
 #include "lib/DShotRMT.h"
+#include "flight_recorder.h"
 #include "melty_config.h"
 
+// Rotation phase is tracked in fixed point: a uint32_t covers exactly one rotation, so it wraps around for free
+#define PHASE_PER_ROTATION 4294967296.0
+
+// How long the hot loop takes to slew from one rotation rate to the next, rather than jumping
+// loop() only recalculates the rotation rate on its control tick, so each ramp finishes just as the next one starts
+#define PHASE_RATE_RAMP_US (CONTROL_LOOP_INTERVAL_MS * 1000)
+
 // The main struct shared by the robot side and the control side threads - contains the state of what we want the robot to do
 typedef struct spin_control_parameters_t {
-    int throttle_perk;               // stores throttle, out of 0-1000
-    int max_throttle_offset;            // In a rotation, the furthest from the base throttle setting that each motor should be spun
-    long rotation_interval_us; // time for 1 rotation of robot
-    long led_start;            // offset for beginning of LED beacon
-    long led_stop;             // offset for end of LED beacon
-    long motor_start_phase_1;  // time offset for when motor 1 begins translating forwards
-    long motor_start_phase_2;  // time offset for when motor 2 begins translating forwards
+    float translate_fraction;           // In a rotation, the furthest from the base throttle that each motor should be spun, as a fraction of it
+    uint32_t phase_rate;       // how much phase we cover per microsecond - i.e. how fast we're spinning
+    uint32_t led_start;        // phase for beginning of LED beacon
+    uint32_t led_stop;         // phase for end of LED beacon
+    uint32_t translate_phase;  // phase at which motor 1 begins pushing us in the direction we're translating
     int battery_percent;                // battery power remaining- where on the green->red slope we should be
-};
+} spin_control_parameters_t;
 
 typedef struct tank_control_parameters_t {
     int translate_forback;
     int turn_lr;
-};
+    float forback_power_scale;          // from the active profile - the hot loop never reads the config itself
+    float turning_power_scale;
+} tank_control_parameters_t;
 
 enum robot_status {
     SPINNING,
@@ -30,25 +39,63 @@ enum robot_status {
     NO_CONTROLLER
 };
 
+// Everything the hot loop needs from loop() - published as one unit, so the state always arrives with the parameters that go with it
+typedef struct robot_command_t {
+    robot_status state;
+    spin_control_parameters_t spin;
+    tank_control_parameters_t tank;
+    unsigned long input_received_at_us;    // when the controller packet behind this command arrived
+} robot_command_t;
+
 // And the parent Robot class
 class Robot {
     public:
         Robot();
         void update_loop(robot_status state, spin_control_parameters_t* spin_params, tank_control_parameters_t* tank_params);
         float get_z_buffer();
-        float get_rpm(int target_rpm);
+        float get_rpm();
         void init();
         int get_battery();
+        bool get_motor_rpms(float* motor1_rpm, float* motor2_rpm, unsigned long* at_us = nullptr);
+        void get_rpm_estimate(rpm_estimate_t* estimate);
+        void get_imu_sample(imu_sample_t* sample);
+        void set_accel_correction_curve(correction_curve_t* curve);
+        void reload_config();
+        void set_spin_target(bool spinning, float target_rpm);
         void trim_accel(bool increase, int target_rpm);
         float get_accel_trim(int target_rpm);
+        void fill_flight_record(flight_record_t* record);
     private:
+        void send_throttles(int motor1_perk, int motor2_perk);
         void motors_stop();
         void drive_tank(tank_control_parameters_t* params);
         void spin(spin_control_parameters_t* params);
-        unsigned long rotation_started_at_us;
+        void advance_phase(uint32_t target_phase_rate);
+        void update_motor_feedback(bool spinning, int throttle_perk);
+        int spin_throttle;                  // what the spin controller wants this tick
+        bool spin_target_enabled;           // whether loop() last told the spin controller to spin
+        uint32_t phase;                     // where we are in the current rotation
+        uint32_t phase_rate;                // how fast phase is currently advancing, per microsecond
+        uint32_t ramp_from_phase_rate;      // phase rate slewing: where we started,
+        uint32_t ramp_to_phase_rate;        // where we're going,
+        unsigned long ramp_started_at_us;   // and when we started
+        unsigned long phase_updated_at_us;
+        float motor1_rpm;                   // latest ESC telemetry - hot loop only. Everyone else gets it through the IMU's motor feedback
+        float motor2_rpm;
+        bool motor_rpms_valid;
+        unsigned long motor1_rpm_at_us;     // when each ESC last replied
+        unsigned long motor2_rpm_at_us;
+        unsigned long motor_rpms_at_us;     // and when either did
+        robot_status last_state;            // what the hot loop did last tick, for the flight recorder
+        int motor1_throttle;
+        int motor2_throttle;
+        bool led_on;
+        int battery_percent;
         LED leds;
         Battery battery;
         DShotRMT motor1;
         DShotRMT motor2;
+        DShotRMTGroup motors;
         IMU imu;
+        SpinController spin_controller;
 };
\ No newline at end of file
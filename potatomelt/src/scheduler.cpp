@@ -0,0 +1,85 @@
+#include "scheduler.h"
+#include "hal/hal.h"
+
+Scheduler::Scheduler() {
+}
+
+void Scheduler::init(int rate_hz) {
+    task = xTaskGetCurrentTaskHandle();
+    period_us = 1000000 / rate_hz;
+    reset_stats();
+
+    esp_timer_create_args_t timer_args = {};
+    timer_args.callback = &Scheduler::on_timer;
+    timer_args.arg = this;
+    timer_args.dispatch_method = ESP_TIMER_TASK;
+    timer_args.name = "scheduler";
+
+    esp_timer_create(&timer_args, &timer);
+
+    next_deadline_us = hal_micros() + period_us;
+    esp_timer_start_periodic(timer, period_us);
+}
+
+// Runs in the esp_timer task - just kick the loop awake
+void Scheduler::on_timer(void* arg) {
+    Scheduler* sched = (Scheduler*) arg;
+    xTaskNotifyGive(sched->task);
+}
+
+unsigned long Scheduler::wait_for_tick() {
+    // the notification count tells us how many timer periods have gone by since we last waited
+    // anything over one means the last tick ran past its deadline, and we've skipped some
+    uint32_t elapsed_periods = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    unsigned long now = hal_micros();
+
+    // deadlines march forwards by exactly one period per timer tick, regardless of when we actually woke up
+    next_deadline_us += elapsed_periods * period_us;
+    unsigned long deadline = next_deadline_us - period_us;
+
+    long lateness_us = (long) (now - deadline);
+
+    // waking up before the deadline isn't lateness - but waking up more than a period after it is, however the timer counted it
+    long recorded_lateness_us = (lateness_us < 0) ? 0 : lateness_us;
+    unsigned long missed_periods = (elapsed_periods > 1) ? elapsed_periods - 1 : 0;
+    if (recorded_lateness_us > (long) period_us) {
+        missed_periods = max(missed_periods, (unsigned long) (recorded_lateness_us / period_us));
+    }
+
+    taskENTER_CRITICAL(&stats_lock);
+    ticks++;
+    overruns += missed_periods;
+    summed_lateness_us += recorded_lateness_us;
+    if (recorded_lateness_us > max_lateness_us) {
+        max_lateness_us = recorded_lateness_us;
+    }
+    taskEXIT_CRITICAL(&stats_lock);
+
+    // the timer and the clock can drift apart by a tick - once we've counted it, resync rather than reporting it forever
+    if (lateness_us < 0 || lateness_us > (long) period_us) {
+        next_deadline_us = now + period_us;
+    }
+
+    return deadline;
+}
+
+void Scheduler::get_stats(scheduler_stats_t* stats, bool reset) {
+    taskENTER_CRITICAL(&stats_lock);
+    stats->ticks = ticks;
+    stats->overruns = overruns;
+    stats->max_lateness_us = max_lateness_us;
+    stats->mean_lateness_us = (ticks > 0) ? (long) (summed_lateness_us / ticks) : 0;
+    if (reset) {
+        ticks = 0;
+        overruns = 0;
+        max_lateness_us = 0;
+        summed_lateness_us = 0;
+    }
+    taskEXIT_CRITICAL(&stats_lock);
+}
+
+void Scheduler::reset_stats() {
+    scheduler_stats_t discarded;
+    get_stats(&discarded, true);
+}
@@ -0,0 +1,42 @@
+#ifndef _SCHEDULER_h
+#define _SCHEDULER_h
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+// Timing statistics for a fixed-rate loop, since the last reset
+typedef struct scheduler_stats_t {
+    unsigned long ticks;            // how many ticks we've run
+    unsigned long overruns;         // how many ticks we missed entirely because the previous one ran long
+    long max_lateness_us;           // worst-case wakeup after the deadline
+    long mean_lateness_us;          // average wakeup after the deadline
+} scheduler_stats_t;
+
+// A timer-driven, fixed-rate loop
+// An esp_timer fires every period and wakes the owning task, so the loop rate doesn't depend on the FreeRTOS tick
+// and jitter doesn't accumulate from one tick to the next
+class Scheduler {
+    public:
+        Scheduler();
+        // must be called from the task that will be calling wait_for_tick()
+        void init(int rate_hz);
+        // blocks until the next deadline. Returns the deadline we woke up for, in micros()
+        unsigned long wait_for_tick();
+        // safe to call from any task, on either core. With reset, the stats start afresh without losing a tick in between
+        void get_stats(scheduler_stats_t* stats, bool reset = false);
+        void reset_stats();
+    private:
+        static void on_timer(void* arg);
+        esp_timer_handle_t timer;
+        TaskHandle_t task;
+        unsigned long period_us;
+        unsigned long next_deadline_us;
+        // the stats are written by the loop's task and read from wherever, so they're only touched under the lock
+        portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+        unsigned long ticks;
+        unsigned long overruns;
+        long max_lateness_us;
+        long long summed_lateness_us;
+};
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef _SEQLOCK_h
+#define _SEQLOCK_h
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+// A single-writer, multi-reader mailbox holding the latest value of T
+// The writer never waits. read() retries if it catches the writer mid-update, so it never sees a torn value.
+// Only one task may write. If a reader shares a core with the writer and outranks it, it must use try_read() instead -
+// read() could spin forever waiting on a write it has preempted.
+template <typename T>
+class Seqlock {
+    static_assert(std::is_trivially_copyable<T>::value, "Seqlock can only hold plain data");
+
+    public:
+        void write(const T& value) {
+            uint32_t buffer[WORDS] = {};
+            memcpy(buffer, &value, sizeof(T));
+
+            uint32_t seq = sequence.load(std::memory_order_relaxed);
+
+            // odd sequence = write in progress
+            sequence.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            for (size_t i = 0; i < WORDS; i++) {
+                data[i].store(buffer[i], std::memory_order_relaxed);
+            }
+
+            sequence.store(seq + 2, std::memory_order_release);
+        }
+
+        // copies the latest value into out, and returns its sequence number (0 if nothing's been written yet)
+        uint32_t read(T* out) const {
+            uint32_t seq;
+            while (!try_read(out, &seq)) {
+            }
+            return seq;
+        }
+
+        // one attempt at read(). Returns false, and leaves out alone, if it caught the writer mid-update
+        // For readers that can preempt the writer - they keep whatever they had, and pick up the new value next time
+        bool try_read(T* out, uint32_t* seq = nullptr) const {
+            uint32_t buffer[WORDS];
+
+            uint32_t before = sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                return false;
+            }
+
+            for (size_t i = 0; i < WORDS; i++) {
+                buffer[i] = data[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (sequence.load(std::memory_order_relaxed) != before) {
+                return false;
+            }
+
+            memcpy(out, buffer, sizeof(T));
+            if (seq != nullptr) {
+                *seq = before / 2;
+            }
+            return true;
+        }
+
+    private:
+        // the value lives in atomic words, so a reader racing the writer is never a data race - it just retries
+        static constexpr size_t WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+        std::atomic<uint32_t> sequence{0};
+        std::atomic<uint32_t> data[WORDS] = {};
+};
+
+#endif
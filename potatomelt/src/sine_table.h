@@ -0,0 +1,49 @@
+#ifndef _SINE_TABLE_h
+#define _SINE_TABLE_h
+
+#include <math.h>
+#include <stdint.h>
+
+// One full sine wave, in Q15 fixed point (+/-32767 = +/-1.0), indexed by the top 8 bits of a rotation phase
+// Entry i is round(32767 * sin(2 * pi * i / 256)), worked out by the compiler - nothing's computed at runtime
+#define SINE_TABLE_BITS 8
+#define SINE_TABLE_SHIFT (32 - SINE_TABLE_BITS)
+
+// sin(x) for x in [-pi/2, pi/2], from its Taylor series - std::sin isn't constexpr. 12 terms is past double precision
+constexpr double sine_series(double x, double term, int n) {
+    return (n > 12) ? 0 : term + sine_series(x, -term * x * x / ((2 * n) * (2 * n + 1)), n + 1);
+}
+
+// sin(x) for x in [0, 2pi), folded into the range the series is good for
+constexpr double sine_folded(double x) {
+    return (x < M_PI / 2) ? sine_series(x, x, 1)
+        : (x < 3 * M_PI / 2) ? sine_series(M_PI - x, M_PI - x, 1)
+        : sine_series(x - 2 * M_PI, x - 2 * M_PI, 1);
+}
+
+constexpr int16_t sine_q15(int i) {
+    return (int16_t) (32767 * sine_folded(2 * M_PI * i / (1 << SINE_TABLE_BITS)) + (i < (1 << SINE_TABLE_BITS) / 2 ? 0.5 : -0.5));
+}
+
+#define SINE_Q15_4(i) sine_q15(i), sine_q15(i + 1), sine_q15(i + 2), sine_q15(i + 3)
+#define SINE_Q15_16(i) SINE_Q15_4(i), SINE_Q15_4(i + 4), SINE_Q15_4(i + 8), SINE_Q15_4(i + 12)
+#define SINE_Q15_64(i) SINE_Q15_16(i), SINE_Q15_16(i + 16), SINE_Q15_16(i + 32), SINE_Q15_16(i + 48)
+
+static_assert(SINE_TABLE_BITS == 8, "sine_table's initialiser is written out for 256 entries");
+
+constexpr int16_t sine_table[1 << SINE_TABLE_BITS] = {
+    SINE_Q15_64(0), SINE_Q15_64(64), SINE_Q15_64(128), SINE_Q15_64(192)
+};
+
+// the quarter points, and one between - a bad series or fold can't get past these
+static_assert(sine_table[0] == 0 && sine_table[64] == 32767 && sine_table[128] == 0 && sine_table[192] == -32767,
+    "sine_table's quarter points are off");
+static_assert(sine_table[32] == 23170 && sine_table[96] == 23170 && sine_table[160] == -23170 && sine_table[224] == -23170,
+    "sine_table's eighth points are off");
+
+// sin(phase) * amplitude, where a uint32_t phase covers one full rotation
+inline int sine_scale(uint32_t phase, int amplitude) {
+    return (amplitude * sine_table[phase >> SINE_TABLE_SHIFT]) >> 15;
+}
+
+#endif
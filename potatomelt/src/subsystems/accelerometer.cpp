@@ -2,6 +2,7 @@
 
 #include "accelerometer.h"
 #include "../lib/SparkFun_LIS331_ESP32.h"
+#include "../melty_config.h"
 
 Accelerometer::Accelerometer() { }
 
@@ -9,6 +10,15 @@ void Accelerometer::init(int addr) {
     lis.setI2CAddr(addr);
     lis.begin(LIS331ESP::USE_I2C);
     lis.setFullScale(LIS331ESP::HIGH_RANGE);
+
+    // run the sensor at least as fast as we're going to be sampling it
+    if (ACCELEROMETER_SAMPLE_RATE_HZ > 400) {
+        lis.setODR(LIS331ESP::DR_1000HZ);
+    } else if (ACCELEROMETER_SAMPLE_RATE_HZ > 100) {
+        lis.setODR(LIS331ESP::DR_400HZ);
+    } else {
+        lis.setODR(LIS331ESP::DR_100HZ);
+    }
 }
 
 // Assumption: We're only calling this when the bot is at rest, right-side-up, in a 1g environment.
@@ -44,3 +54,17 @@ float Accelerometer::get_xy_accel() {
 
     return sqrt(xg*xg + yg*yg);
 }
+
+// both of the above, from a single read
+// returns true if the X or Y axis has hit the end of the sensor's range
+bool Accelerometer::get_accel(float* xy_g, float* z_g) {
+    int16_t x, y, z;
+    lis.readAxes(x, y, z);
+    float xg = lis.convertToG(400, x) - x_offset;
+    float yg = lis.convertToG(400, y) - y_offset;
+
+    *xy_g = sqrt(xg*xg + yg*yg);
+    *z_g = lis.convertToG(400, z) - z_offset;
+
+    return abs(x) >= ACCELEROMETER_SATURATION_COUNTS || abs(y) >= ACCELEROMETER_SATURATION_COUNTS;
+}
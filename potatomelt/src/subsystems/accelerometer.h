@@ -7,6 +7,7 @@ class Accelerometer {
         void sample_offset();
         float get_z_accel();
         float get_xy_accel();
+        bool get_accel(float* xy_g, float* z_g);
     private:
         LIS331ESP lis;
         int sample_count;
@@ -0,0 +1,112 @@
+#include <Arduino.h>
+#include <math.h>
+#include "calibrator.h"
+#include "../melty_config.h"
+#include "../log.h"
+#include "../hal/hal.h"
+
+Calibrator::Calibrator() {
+    running = false;
+    correction_curve_init(&curve, 1.0f);
+}
+
+void Calibrator::start(const int* target_rpms, int count) {
+    num_steps = min(count, AUTOCAL_MAX_STEPS);
+    for (int i = 0; i < num_steps; i++) {
+        targets[i] = target_rpms[i];
+    }
+
+    num_measured = 0;
+    step = -1;
+    running = true;
+    had_reference = false;
+    next_step();
+}
+
+void Calibrator::stop() {
+    running = false;
+}
+
+bool Calibrator::is_running() {
+    return running;
+}
+
+int Calibrator::get_target_rpm() {
+    return targets[step];
+}
+
+void Calibrator::next_step() {
+    step++;
+    step_started_at = hal_millis();
+    step_samples = 0;
+    summed_reference_rpm = 0.0f;
+    summed_correction = 0.0f;
+}
+
+bool Calibrator::update(float accel_rpm, bool accel_saturated, float reference_rpm, bool reference_valid, unsigned long reference_at_us, float rpm_per_s) {
+    if (!running) {
+        return false;
+    }
+
+    // the reference has to be current: an ESC that's stopped replying leaves its last reading behind, and
+    // averaging that would fit the curve to a frozen RPM - and save it
+    bool reference_fresh = reference_valid && hal_micros() - reference_at_us <= AUTOCAL_REFERENCE_MAX_AGE_US;
+
+    // without a reference at all, there's nothing to calibrate against
+    if (!reference_fresh && !had_reference) {
+        LOG("Auto-calibration: no ESC telemetry, giving up\n");
+        running = false;
+        return false;
+    }
+
+    long elapsed = hal_millis() - step_started_at;
+
+    // only measure once we've had time to get up to speed, and the RPM has stopped moving
+    // a saturated accelerometer reads low, so those samples would drag the correction up
+    bool settled = elapsed > AUTOCAL_SETTLE_MS && fabs(rpm_per_s) < AUTOCAL_SETTLED_RPM_PER_S;
+    if (reference_fresh && settled && !accel_saturated && accel_rpm > 0.0f) {
+        summed_reference_rpm += reference_rpm;
+        summed_correction += reference_rpm / accel_rpm;
+        step_samples++;
+    }
+    had_reference |= reference_fresh;
+
+    // lost it partway through: this step's measurement starts over once it's back, rather than carry on from samples
+    // taken up to a dropout. If it doesn't come back, the step times out like one that never settled
+    if (!reference_fresh && step_samples > 0) {
+        LOG("Auto-calibration: ESC telemetry dropped out at %d RPM, measuring it again\n", targets[step]);
+        step_samples = 0;
+        summed_reference_rpm = 0.0f;
+        summed_correction = 0.0f;
+    }
+
+    if (step_samples >= AUTOCAL_SAMPLES_PER_STEP) {
+        measured_rpms[num_measured] = summed_reference_rpm / step_samples;
+        measured_corrections[num_measured] = summed_correction / step_samples;
+        LOG("Auto-calibration: %d RPM, correction %f \n", (int) measured_rpms[num_measured], measured_corrections[num_measured]);
+        num_measured++;
+        next_step();
+    } else if (elapsed > AUTOCAL_STEP_TIMEOUT_MS) {
+        LOG("Auto-calibration: %d RPM never settled with ESC telemetry, skipping \n", targets[step]);
+        next_step();
+    }
+
+    if (step < num_steps) {
+        return false;
+    }
+
+    running = false;
+
+    if (num_measured == 0) {
+        LOG("Auto-calibration: nothing measured, keeping the old correction\n");
+        return false;
+    }
+
+    correction_curve_init(&curve, 1.0f);
+    correction_curve_fit(&curve, measured_rpms, measured_corrections, num_measured);
+    return true;
+}
+
+void Calibrator::get_curve(correction_curve_t* out) {
+    *out = curve;
+}
\ No newline at end of file
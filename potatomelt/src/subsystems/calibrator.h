@@ -0,0 +1,36 @@
+#include "correction_curve.h"
+
+#define AUTOCAL_MAX_STEPS 16
+
+// Automatic accelerometer calibration
+// Steps the robot through a list of target RPMs. At each one, once the spin has settled, it compares the accelerometer's
+// raw RPM against a reference (ESC telemetry), then fits the correction curve through everything it measured.
+class Calibrator {
+    public:
+        Calibrator();
+        void start(const int* target_rpms, int count);
+        void stop();
+        bool is_running();
+        // what RPM the robot should be chasing for the current step
+        int get_target_rpm();
+        // call every control loop while running. reference_at_us is when the reference RPM was measured
+        // returns true once, when the run finishes with a new curve ready in get_curve()
+        bool update(float accel_rpm, bool accel_saturated, float reference_rpm, bool reference_valid, unsigned long reference_at_us, float rpm_per_s);
+        void get_curve(correction_curve_t* curve);
+    private:
+        void next_step();
+        bool running;
+        bool had_reference;         // has the reference been fresh at all, this run?
+        int targets[AUTOCAL_MAX_STEPS];
+        int num_steps;
+        int step;
+        long step_started_at;
+        int step_samples;
+        float summed_reference_rpm;
+        float summed_correction;
+        // the measured points, in the order we stepped through them
+        float measured_rpms[AUTOCAL_MAX_STEPS];
+        float measured_corrections[AUTOCAL_MAX_STEPS];
+        int num_measured;
+        correction_curve_t curve;
+};
\ No newline at end of file
@@ -0,0 +1,82 @@
+#include "correction_curve.h"
+
+int correction_curve_knot_rpm(int knot) {
+    return CORRECTION_CURVE_MIN_RPM + knot * CORRECTION_CURVE_KNOT_SPACING_RPM;
+}
+
+// Finds the knot at or below the rpm, and how far we are towards the next one
+static int find_segment(float rpm, float* fraction) {
+    float position = (rpm - CORRECTION_CURVE_MIN_RPM) / CORRECTION_CURVE_KNOT_SPACING_RPM;
+
+    if (position <= 0.0f) {
+        *fraction = 0.0f;
+        return 0;
+    }
+
+    if (position >= CORRECTION_CURVE_KNOTS - 1) {
+        *fraction = 1.0f;
+        return CORRECTION_CURVE_KNOTS - 2;
+    }
+
+    int knot = (int) position;
+    *fraction = position - knot;
+    return knot;
+}
+
+// A flat curve - the same correction everywhere
+void correction_curve_init(correction_curve_t* curve, float correction) {
+    for (int i = 0; i < CORRECTION_CURVE_KNOTS; i++) {
+        curve->knots[i] = correction;
+    }
+}
+
+float correction_curve_get(const correction_curve_t* curve, float rpm) {
+    float fraction;
+    int knot = find_segment(rpm, &fraction);
+    return curve->knots[knot] + fraction * (curve->knots[knot + 1] - curve->knots[knot]);
+}
+
+// Scales the curve at this rpm by factor, by scaling the knots either side of it
+void correction_curve_scale(correction_curve_t* curve, float rpm, float factor) {
+    float fraction;
+    int knot = find_segment(rpm, &fraction);
+    curve->knots[knot] *= factor;
+    curve->knots[knot + 1] *= factor;
+}
+
+// Moves the curve at this rpm fraction of the way towards value, by moving the knots either side of it
+// Each knot moves in proportion to how close it is, so repeated nudges at one rpm don't drag a far-off knot along
+void correction_curve_learn(correction_curve_t* curve, float rpm, float value, float fraction) {
+    float position;
+    int knot = find_segment(rpm, &position);
+    float error = value - correction_curve_get(curve, rpm);
+    curve->knots[knot] += fraction * (1.0f - position) * error;
+    curve->knots[knot + 1] += fraction * position * error;
+}
+
+// Fits the curve through a set of measured (rpm, correction) points, which must be in increasing rpm order
+// Each knot takes the straight-line interpolation between the measurements either side of it.
+// Knots beyond the measured range hold the nearest measurement.
+void correction_curve_fit(correction_curve_t* curve, const float* rpms, const float* corrections, int count) {
+    if (count <= 0) {
+        return;
+    }
+
+    for (int i = 0; i < CORRECTION_CURVE_KNOTS; i++) {
+        float knot_rpm = correction_curve_knot_rpm(i);
+
+        if (knot_rpm <= rpms[0]) {
+            curve->knots[i] = corrections[0];
+        } else if (knot_rpm >= rpms[count - 1]) {
+            curve->knots[i] = corrections[count - 1];
+        } else {
+            int point = 0;
+            while (rpms[point + 1] < knot_rpm) {
+                point++;
+            }
+
+            float fraction = (knot_rpm - rpms[point]) / (rpms[point + 1] - rpms[point]);
+            curve->knots[i] = corrections[point] + fraction * (corrections[point + 1] - corrections[point]);
+        }
+    }
+}
@@ -0,0 +1,23 @@
+#ifndef _CORRECTION_CURVE_h
+#define _CORRECTION_CURVE_h
+
+// Something that varies across the whole RPM range, as a piecewise-linear curve
+// The accelerometer correction factor, or the feed-forward throttle per RPM
+// Knots are evenly spaced from CORRECTION_CURVE_MIN_RPM to CORRECTION_CURVE_MAX_RPM. Outside that range, the end knots hold.
+#define CORRECTION_CURVE_KNOTS 9
+#define CORRECTION_CURVE_MIN_RPM 400
+#define CORRECTION_CURVE_MAX_RPM 3200
+#define CORRECTION_CURVE_KNOT_SPACING_RPM ((CORRECTION_CURVE_MAX_RPM - CORRECTION_CURVE_MIN_RPM) / (CORRECTION_CURVE_KNOTS - 1))
+
+typedef struct correction_curve_t {
+    float knots[CORRECTION_CURVE_KNOTS];
+} correction_curve_t;
+
+void correction_curve_init(correction_curve_t* curve, float correction);
+float correction_curve_get(const correction_curve_t* curve, float rpm);
+void correction_curve_scale(correction_curve_t* curve, float rpm, float factor);
+void correction_curve_learn(correction_curve_t* curve, float rpm, float value, float fraction);
+void correction_curve_fit(correction_curve_t* curve, const float* rpms, const float* corrections, int count);
+int correction_curve_knot_rpm(int knot);
+
+#endif
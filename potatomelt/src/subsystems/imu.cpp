@@ -4,23 +4,151 @@
 #include "imu.h"
 #include "storage.h"
 #include "../melty_config.h"
+#include "../scheduler.h"
+#include "../hal/hal.h"
+#include "../profiler.h"
 
 Accelerometer lis1;
 Accelerometer lis2;
 
-float accel_correction_factor = 1.0;
+TaskHandle_t imu_sampler;
 
-// todo - spin trim per-RPM
+// the loop task's copy of the correction curve - trims and calibration edit this, then publish it to the sampler
+correction_curve_t accel_correction_curve;
+
+// The target RPMs that trims were saved against, before the correction curve
+int legacy_trim_rpms[] = {600, 800, 1000, 1200, 1500, 1800, 2100, 2500, 3000};
+#define NUM_LEGACY_TRIM_RPMS 9
 
 IMU::IMU() {
+    correction_curve_init(&sampler_correction, 1.0f);
 }
 
 void IMU::init() {
+    load_accel_correction();
+
     lis1.init(0x18);
     lis2.init(0x19);
 
     delay(20); // short pause for accelerometer warmup - we get weird results if we just dive right in
     set_z_offset();
+
+    // from here on, the sampler task owns the I2C bus - everyone else reads its latest sample
+    take_sample();
+    xTaskCreatePinnedToCore(
+        sampler_task,                     // the function
+        "imu_sampler",                    // name the task
+        4096,                             // stack depth
+        this,                             // params
+        ACCELEROMETER_SAMPLER_PRIORITY,   // priority
+        &imu_sampler,                     // task handle
+        1                                 // core affinity
+    );
+}
+
+// Polls both accelerometers at the sensor's data rate, and publishes what it sees
+void IMU::sampler_task(void* parameter) {
+    IMU* imu = (IMU*) parameter;
+
+    Scheduler sampler_scheduler;
+    sampler_scheduler.init(ACCELEROMETER_SAMPLE_RATE_HZ);
+
+    while (true) {
+        sampler_scheduler.wait_for_tick();
+        imu->take_sample();
+    }
+}
+
+void IMU::take_sample() {
+    PROFILE_SCOPE("IMU::take_sample");
+
+    imu_sample_t sample;
+    float lis1_z_g;
+    float lis2_z_g;
+
+    bool lis1_saturated = lis1.get_accel(&sample.lis1_g, &lis1_z_g);
+    bool lis2_saturated = lis2.get_accel(&sample.lis2_g, &lis2_z_g);
+    sample.saturated = lis1_saturated || lis2_saturated;
+    sample.timestamp_us = hal_micros();
+    sample.z_g = (lis1_z_g + lis2_z_g) / 2;
+
+    float avg_g = (sample.lis1_g + sample.lis2_g) / 2;
+    float rpm = fabs(avg_g) * 89445.0f;
+    rpm = rpm / get_active_store()->get_config()->accelerometer_radius_cm;
+    sample.rpm = sqrt(rpm);
+
+    latest_sample.write(sample);
+
+    update_estimate(&sample);
+}
+
+// Applies the correction curve to a raw accelerometer RPM
+// The curve is indexed by true RPM, which we don't know yet - so look it up at the raw RPM, then once more at the corrected one
+// The sampler outranks loop(), which publishes the curve from the same core - so only try_read() it, and if we've caught
+// loop() mid-write, keep the curve we had until the next sample
+float IMU::correct_accel_rpm(float raw_rpm) {
+    accel_correction.try_read(&sampler_correction);
+
+    float rpm = raw_rpm * correction_curve_get(&sampler_correction, raw_rpm);
+    return raw_rpm * correction_curve_get(&sampler_correction, rpm);
+}
+
+// Runs the RPM estimator forwards to the latest sample, and feeds it everything we know
+void IMU::update_estimate(imu_sample_t* sample) {
+    if (estimated_at_us != 0) {
+        estimator.predict((sample->timestamp_us - estimated_at_us) / 1000000.0f);
+    }
+    estimated_at_us = sample->timestamp_us;
+
+    estimator.update_accel_rpm(correct_accel_rpm(sample->rpm), sample->saturated);
+
+    imu_motor_feedback_t feedback;
+    motor_feedback.read(&feedback);
+
+    // ESC telemetry arrives on its own schedule - only use each reading once
+    if (feedback.robot_rpm_valid && feedback.robot_rpm_at_us != motor_rpm_used_at_us) {
+        estimator.update_motor_rpm(feedback.robot_rpm);
+        motor_rpm_used_at_us = feedback.robot_rpm_at_us;
+    }
+
+    estimator.update_throttle(feedback.throttle_perk);
+
+    rpm_estimate_t estimate;
+    estimator.get_estimate(&estimate);
+    estimate.timestamp_us = sample->timestamp_us;
+    latest_estimate.write(estimate);
+
+    if (estimate_listener != nullptr) {
+        xTaskNotifyGive(estimate_listener);
+    }
+}
+
+void IMU::get_sample(imu_sample_t* sample) {
+    latest_sample.read(sample);
+}
+
+// The latest estimate, carried forwards to right now
+void IMU::get_rpm_estimate(rpm_estimate_t* estimate) {
+    latest_estimate.read(estimate);
+
+    unsigned long now = hal_micros();
+    estimate->rpm += estimate->rpm_per_s * (now - estimate->timestamp_us) / 1000000.0f;
+    estimate->rpm = max(estimate->rpm, 0.0f);
+    estimate->timestamp_us = now;
+}
+
+// Wakes task up every time there's a new estimate
+void IMU::set_estimate_listener(TaskHandle_t task) {
+    estimate_listener = task;
+}
+
+void IMU::set_motor_feedback(imu_motor_feedback_t* feedback) {
+    motor_feedback.write(*feedback);
+}
+
+// The latest motor feedback, as published by the hot loop
+void IMU::get_motor_feedback(imu_motor_feedback_t* feedback) {
+    motor_feedback.read(feedback);
 }
 
 void IMU::set_z_offset() {
@@ -35,7 +163,9 @@ void IMU::set_z_offset() {
 // to be called every hit of loop()
 // todo - rethink this
 void IMU::poll() {
-    float avg_z_g = (lis1.get_z_accel() + lis2.get_z_accel()) / 2;
+    imu_sample_t sample;
+    latest_sample.read(&sample);
+    float avg_z_g = sample.z_g;
     
     z_accel_buffer *= 0.5;
     z_accel_buffer += (0.5 * avg_z_g);
@@ -46,47 +176,70 @@ bool IMU::get_inverted() {
     return z_accel_buffer < 0.0;
 }
 
-void IMU::get_accel_correction(int target_rpm) {
-    float new_corr_factor = get_active_store()->get_accel_correction(target_rpm);
+void IMU::load_accel_correction() {
+    if (get_active_store()->get_accel_correction_curve(&accel_correction_curve)) {
+        accel_correction.write(accel_correction_curve);
+        return;
+    }
 
-    if (new_corr_factor > 0.0f) {
-        accel_correction_factor = new_corr_factor;
-    } else {
-        get_active_store()->set_accel_correction(target_rpm, accel_correction_factor);
+    // no curve yet - carry over any per-target-RPM trims saved by older firmware
+    float rpms[NUM_LEGACY_TRIM_RPMS];
+    float corrections[NUM_LEGACY_TRIM_RPMS];
+    int count = 0;
+
+    for (int i = 0; i < NUM_LEGACY_TRIM_RPMS; i++) {
+        float correction = get_active_store()->get_accel_correction(legacy_trim_rpms[i]);
+        if (correction > 0.0f) {
+            rpms[count] = legacy_trim_rpms[i];
+            corrections[count] = correction;
+            count++;
+        }
     }
+
+    correction_curve_init(&accel_correction_curve, 1.0f);
+    correction_curve_fit(&accel_correction_curve, rpms, corrections, count);
+    save_accel_correction();
+}
+
+// Publishes the loop task's copy of the curve to the sampler, and stores it
+void IMU::save_accel_correction() {
+    accel_correction.write(accel_correction_curve);
+    get_active_store()->set_accel_correction_curve(&accel_correction_curve);
 }
 
 void IMU::trim(bool increase, int target_rpm) {
-    accel_correction_factor *= ((increase) ? 1.005 : (1.0/1.005));
-    get_active_store()->set_accel_correction(target_rpm, accel_correction_factor);
+    correction_curve_scale(&accel_correction_curve, target_rpm, (increase) ? 1.005 : (1.0/1.005));
+    save_accel_correction();
 }
 
-float IMU::get_rpm(int target_rpm) {
-    if (target_rpm != current_target_rpm) {
-        current_target_rpm = target_rpm;
-        get_accel_correction(target_rpm);
-    }
+// Swaps in a whole new correction curve - from auto-calibration
+void IMU::set_accel_correction_curve(correction_curve_t* curve) {
+    accel_correction_curve = *curve;
+    save_accel_correction();
+}
 
-    float lis1_g = lis1.get_xy_accel();
-    float lis2_g = lis2.get_xy_accel();
+float IMU::get_rpm() {
+    PROFILE_SCOPE("IMU::get_rpm");
 
-    float avg_g = (lis1_g + lis2_g) / 2;
-    float rpm = fabs(avg_g) * 89445.0f;
-    rpm = rpm / ACCELEROMETER_HARDWARE_RADIUS_CM;
-    rpm = sqrt(rpm);
-    rpm *= accel_correction_factor;
+    // no bus traffic here - just pick up whatever the estimator thinks
+    rpm_estimate_t estimate;
+    get_rpm_estimate(&estimate);
 
-    return rpm;
+    return estimate.rpm;
 }
 
 float IMU::get_accel_1_g() {
-    return lis1.get_xy_accel();
+    imu_sample_t sample;
+    latest_sample.read(&sample);
+    return sample.lis1_g;
 }
 
 float IMU::get_accel_2_g() {
-    return lis2.get_xy_accel();
+    imu_sample_t sample;
+    latest_sample.read(&sample);
+    return sample.lis2_g;
 }
 
 float IMU::get_trim(int target_rpm) {
-    return accel_correction_factor;
+    return correction_curve_get(&accel_correction_curve, target_rpm);
 }
\ No newline at end of file
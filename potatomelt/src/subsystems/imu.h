@@ -1,7 +1,35 @@
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "../seqlock.h"
+#include "rpm_estimator.h"
+#include "correction_curve.h"
+
+// The latest reading from both accelerometers, as published by the sampler task
+typedef struct imu_sample_t {
+    unsigned long timestamp_us;     // when the sample was taken
+    float lis1_g;                   // centripetal acceleration seen by each accelerometer, in g
+    float lis2_g;
+    float z_g;                      // averaged z acceleration
+    float rpm;                      // RPM implied by the average of the two - before the correction factor
+    bool saturated;                 // true if either accelerometer has hit the end of its range
+} imu_sample_t;
+
+// What the motors are telling us, as published by the hot loop
+typedef struct imu_motor_feedback_t {
+    int throttle_perk;              // the base throttle we're commanding while spinning, 0 otherwise
+    bool robot_rpm_valid;           // do we have ESC telemetry, and are we spinning so it means anything?
+    float robot_rpm;                // robot RPM implied by the ESC telemetry
+    unsigned long robot_rpm_at_us;  // when we got that telemetry
+    float motor1_rpm;               // the telemetry itself, for everyone else
+    float motor2_rpm;
+    bool motor_rpms_valid;          // do we have a recent reading from both motors?
+    unsigned long motor_rpms_at_us; // when the older of the two came in
+} imu_motor_feedback_t;
+
 class IMU {
     public:
         IMU();
-        float get_rpm(int target_rpm);
+        float get_rpm();
         bool get_inverted();
         void poll();
         void init();
@@ -10,8 +38,27 @@ class IMU {
         float get_accel_2_g();
         float z_accel_buffer = 0.0;
         float get_trim(int target_rpm);
+        void get_sample(imu_sample_t* sample);
+        void get_rpm_estimate(rpm_estimate_t* estimate);
+        void set_motor_feedback(imu_motor_feedback_t* feedback);
+        void get_motor_feedback(imu_motor_feedback_t* feedback);
+        void set_accel_correction_curve(correction_curve_t* curve);
+        void load_accel_correction();
+        void set_estimate_listener(TaskHandle_t task);
     private:
+        static void sampler_task(void* parameter);
+        void take_sample();
+        void update_estimate(imu_sample_t* sample);
         void set_z_offset();
-        void get_accel_correction(int target_rpm);
-        int current_target_rpm;
+        float correct_accel_rpm(float raw_rpm);
+        void save_accel_correction();
+        Seqlock<correction_curve_t> accel_correction;
+        correction_curve_t sampler_correction;      // the sampler's copy of accel_correction
+        Seqlock<imu_sample_t> latest_sample;
+        Seqlock<imu_motor_feedback_t> motor_feedback;
+        Seqlock<rpm_estimate_t> latest_estimate;
+        RPMEstimator estimator;
+        unsigned long estimated_at_us;
+        unsigned long motor_rpm_used_at_us;
+        TaskHandle_t estimate_listener = nullptr;
 };
\ No newline at end of file
@@ -1,10 +1,13 @@
 #include <Arduino.h>
+#include <string.h>
 #include <driver/rmt.h>
 #include "led.h"
 #include "../melty_config.h"
+#include "../hal/hal.h"
+#include "../profiler.h"
 
-rmt_item32_t led_data[6*8];
-uint8_t pixel_color[6]; 
+// The RMT items for every possible nibble, most significant bit first - a byte is just two of these back to back
+rmt_item32_t nibble_items[16][4];
 
 LED::LED() {
     rmt_config_t rmt_cfg = RMT_DEFAULT_CONFIG_TX(NEOPIXEL_PIN, NEOPIXEL_RMT);
@@ -14,6 +17,23 @@ LED::LED() {
     rmt_config(&rmt_cfg);
 
     rmt_driver_install(rmt_cfg.channel, 0, 0);
+
+    for (int nibble = 0; nibble < 16; nibble++) {
+        for (int bit = 0; bit < 4; bit++) {
+            rmt_item32_t* item = &nibble_items[nibble][bit];
+            item->level0 = 1;
+            item->level1 = 0;
+            if ((nibble >> (3 - bit)) & 1) {
+                item->duration0 = 8;
+                item->duration1 = 4;
+            } else {
+                item->duration0 = 4;
+                item->duration1 = 8;
+            }
+        }
+    }
+
+    showing = -1;
 }
 
 void LED::leds_on_ready() {
@@ -25,7 +45,7 @@ void LED::leds_on_low_battery() {
 }
 
 void LED::leds_on_controller_stale() {
-    long now = millis();
+    long now = hal_millis();
         now /= 100;
         if ((now % 10) < 8) {
             leds_on_rgb(255, 0, 0);
@@ -35,7 +55,7 @@ void LED::leds_on_controller_stale() {
 }
 
 void LED::leds_on_no_controller() {
-    long now = millis();
+    long now = hal_millis();
         now /= 100;
         if ((now % 10) < 2) {
             leds_on_rgb(255, 0, 0);
@@ -51,38 +71,49 @@ void LED::leds_on_gradient(int color) {
 }
 
 void LED::leds_off() {
-    pixel_color[0] = pixel_color[1] = pixel_color[2] = 0;
-    pixel_color[3] = pixel_color[4] = pixel_color[5] = 0;
-    write_pixel();
+    show(0);
 }
 
 void LED::leds_on_rgb(int red, int green, int blue) {
     // neopixels usually use GRB addressing rather than RGB
-    pixel_color[0] = pixel_color[3] = green;
-    pixel_color[1] = pixel_color[4] = red;
-    pixel_color[2] = pixel_color[5] = blue;
-    write_pixel();
+    show(((uint32_t) (green & 0xff) << 16) | ((uint32_t) (red & 0xff) << 8) | (uint32_t) (blue & 0xff));
 }
 
-void LED::write_pixel() {
-    int index = 0;
-    for (auto chan : pixel_color) {
-      uint8_t value = chan;
-      for (int bit = 7; bit >= 0; bit--) {
-        if ((value >> bit) & 1) {
-          led_data[index].level0 = 1;
-          led_data[index].duration0 = 8;
-          led_data[index].level1 = 0;
-          led_data[index].duration1 = 4;
-        } else {
-          led_data[index].level0 = 1;
-          led_data[index].duration0 = 4;
-          led_data[index].level1 = 0;
-          led_data[index].duration1 = 8;
-        }
-        index++;
-      }
+// Sets every pixel to color - but only bothers the RMT if that's not what they're already showing
+// The hot loop calls this every tick, and the color only changes a couple of times a rotation
+void LED::show(uint32_t color) {
+    if (showing >= 0 && encoded[showing].color == color) {
+        return;
+    }
+
+    int other = (showing == 0) ? 1 : 0;
+
+    // the RMT might still be sending the current buffer, so only ever re-encode the other one
+    // rmt_write_items() waits for the previous send to finish before it starts, so that one's always free
+    if (showing < 0 || encoded[other].color != color) {
+        encode(color, &encoded[other]);
     }
 
-    rmt_write_items(NEOPIXEL_RMT, led_data, 6*8, false);
-  }
\ No newline at end of file
+    write_pixels(&encoded[other]);
+    showing = other;
+}
+
+void LED::encode(uint32_t color, led_encoded_t* encoded) {
+    encoded->color = color;
+
+    // one pixel's worth, a nibble at a time, then copied down the chain
+    for (int nibble = 0; nibble < 6; nibble++) {
+        uint8_t value = (color >> (20 - nibble * 4)) & 0xf;
+        memcpy(&encoded->items[nibble * 4], nibble_items[value], sizeof(nibble_items[value]));
+    }
+
+    for (int pixel = 1; pixel < NEOPIXEL_COUNT; pixel++) {
+        memcpy(&encoded->items[pixel * LED_ITEMS_PER_PIXEL], encoded->items, LED_ITEMS_PER_PIXEL * sizeof(rmt_item32_t));
+    }
+}
+
+void LED::write_pixels(led_encoded_t* encoded) {
+    PROFILE_SCOPE("LED::write_pixels");
+
+    hal_rmt_write(NEOPIXEL_RMT, encoded->items, NEOPIXEL_COUNT * LED_ITEMS_PER_PIXEL);
+}
\ No newline at end of file
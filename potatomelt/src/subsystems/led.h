@@ -1,5 +1,15 @@
+#include <driver/rmt.h>
 #include "../melty_config.h"
 
+// Each pixel takes 24 bits (8 each of green, red and blue), and each bit is one RMT item
+#define LED_ITEMS_PER_PIXEL 24
+
+// The whole chain's worth of RMT items, for one color
+typedef struct led_encoded_t {
+    uint32_t color;                 // packed GRB
+    rmt_item32_t items[NEOPIXEL_COUNT * LED_ITEMS_PER_PIXEL];
+} led_encoded_t;
+
 class LED {
     public:
         LED();
@@ -13,5 +23,10 @@ class LED {
         void leds_off();
     private:
         void leds_on_rgb(int red, int green, int blue);
-        void write_pixel();
+        void show(uint32_t color);
+        void encode(uint32_t color, led_encoded_t* encoded);
+        void write_pixels(led_encoded_t* encoded);
+        // the last two colors we've sent, ready to go again - while spinning, we flip between the beacon and off twice a rotation
+        led_encoded_t encoded[2];
+        int showing;                    // which of those is on the LEDs now, or -1 if nothing's been sent yet
 };
\ No newline at end of file
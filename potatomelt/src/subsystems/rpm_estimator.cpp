@@ -0,0 +1,98 @@
+#include <Arduino.h>
+#include <math.h>
+#include "rpm_estimator.h"
+#include "../melty_config.h"
+
+#define STATE_RPM 0
+#define STATE_RPM_PER_S 1
+
+RPMEstimator::RPMEstimator() {
+    reset();
+}
+
+void RPMEstimator::reset() {
+    rpm = 0.0f;
+    rpm_per_s = 0.0f;
+
+    // we know we're sitting still at startup
+    p[0][0] = ESTIMATOR_ACCEL_RPM_STDDEV * ESTIMATOR_ACCEL_RPM_STDDEV;
+    p[0][1] = p[1][0] = 0.0f;
+    p[1][1] = ESTIMATOR_THROTTLE_RPM_PER_S_STDDEV * ESTIMATOR_THROTTLE_RPM_PER_S_STDDEV;
+}
+
+// Moves the estimate forwards in time, assuming constant acceleration
+// Our uncertainty grows with time, driven by how quickly the acceleration can change
+void RPMEstimator::predict(float dt_s) {
+    rpm += rpm_per_s * dt_s;
+
+    float q = ESTIMATOR_JERK_STDDEV * ESTIMATOR_JERK_STDDEV;
+    float dt2 = dt_s * dt_s;
+
+    // P = F P F' + Q, for F = [1 dt; 0 1]
+    float p00 = p[0][0] + dt_s * (p[0][1] + p[1][0]) + dt2 * p[1][1] + q * dt2 * dt_s / 3.0f;
+    float p01 = p[0][1] + dt_s * p[1][1] + q * dt2 / 2.0f;
+    float p11 = p[1][1] + q * dt_s;
+
+    p[0][0] = p00;
+    p[0][1] = p[1][0] = p01;
+    p[1][1] = p11;
+}
+
+void RPMEstimator::update_accel_rpm(float measured_rpm, bool saturated) {
+    // once an accelerometer hits the end of its range, it'll only ever tell us "at least this fast" - ignore it
+    if (saturated) {
+        return;
+    }
+
+    update(STATE_RPM, measured_rpm, ESTIMATOR_ACCEL_RPM_STDDEV * ESTIMATOR_ACCEL_RPM_STDDEV);
+}
+
+void RPMEstimator::update_motor_rpm(float measured_rpm) {
+    update(STATE_RPM, measured_rpm, ESTIMATOR_MOTOR_RPM_STDDEV * ESTIMATOR_MOTOR_RPM_STDDEV);
+}
+
+// The throttle gives us a rough idea of our acceleration: we chase the RPM the throttle would eventually settle at,
+// with a first-order lag. It's a crude model, so it gets a lot of variance - it mostly matters when nothing else is talking.
+void RPMEstimator::update_throttle(int throttle_perk) {
+    float settling_rpm = throttle_perk * SPIN_MODEL_RPM_PER_THROTTLE;
+    float modelled_rpm_per_s = (settling_rpm - rpm) / SPIN_MODEL_TIME_CONSTANT_S;
+
+    update(STATE_RPM_PER_S, modelled_rpm_per_s, ESTIMATOR_THROTTLE_RPM_PER_S_STDDEV * ESTIMATOR_THROTTLE_RPM_PER_S_STDDEV);
+}
+
+// A scalar Kalman update, measuring one of the two states directly
+void RPMEstimator::update(int state, float measurement, float variance) {
+    float innovation = measurement - ((state == STATE_RPM) ? rpm : rpm_per_s);
+    float innovation_variance = p[state][state] + variance;
+
+    float gain_rpm = p[STATE_RPM][state] / innovation_variance;
+    float gain_rpm_per_s = p[STATE_RPM_PER_S][state] / innovation_variance;
+
+    rpm += gain_rpm * innovation;
+    rpm_per_s += gain_rpm_per_s * innovation;
+
+    // P = (I - K H) P
+    float p0s = p[STATE_RPM][state];
+    float p1s = p[STATE_RPM_PER_S][state];
+    float p00 = p[0][0] - gain_rpm * p0s;
+    float p01 = p[0][1] - gain_rpm * p1s;
+    float p11 = p[1][1] - gain_rpm_per_s * p1s;
+
+    p[0][0] = p00;
+    p[0][1] = p[1][0] = p01;
+    p[1][1] = p11;
+
+    if (rpm < 0.0f) {
+        rpm = 0.0f;
+    }
+}
+
+void RPMEstimator::get_estimate(rpm_estimate_t* estimate) {
+    estimate->rpm = rpm;
+    estimate->rpm_per_s = rpm_per_s;
+
+    // confidence falls off as our standard deviation approaches ESTIMATOR_CONFIDENCE_RPM_PERCENT of the RPM
+    float stddev = sqrt(p[0][0]);
+    float tolerance = max(rpm, (float) MIN_TRACKING_RPM) * ESTIMATOR_CONFIDENCE_RPM_PERCENT / 100.0f;
+    estimate->confidence = constrain(1.0f - stddev / tolerance, 0.0f, 1.0f);
+}
@@ -0,0 +1,31 @@
+#ifndef _RPM_ESTIMATOR_h
+#define _RPM_ESTIMATOR_h
+
+// What the estimator thinks we're doing
+typedef struct rpm_estimate_t {
+    unsigned long timestamp_us;     // when the estimate was made
+    float rpm;
+    float rpm_per_s;                // angular acceleration
+    float confidence;               // 0 (no idea) to 1 (certain)
+} rpm_estimate_t;
+
+// A two-state (RPM, angular acceleration) Kalman filter
+// It fuses the accelerometer RPM, the ESCs' eRPM telemetry (when we have it), and a simple model of how the
+// commanded throttle accelerates the robot. Where the accelerometers are noisy or saturated, the others carry it.
+class RPMEstimator {
+    public:
+        RPMEstimator();
+        void reset();
+        void predict(float dt_s);
+        void update_accel_rpm(float rpm, bool saturated);
+        void update_motor_rpm(float rpm);
+        void update_throttle(int throttle_perk);
+        void get_estimate(rpm_estimate_t* estimate);
+    private:
+        void update(int state, float measurement, float variance);
+        float rpm;
+        float rpm_per_s;
+        float p[2][2];                  // estimate covariance
+};
+
+#endif
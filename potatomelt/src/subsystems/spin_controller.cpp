@@ -0,0 +1,162 @@
+#include <Arduino.h>
+#include <math.h>
+#include "spin_controller.h"
+#include "imu.h"
+#include "../melty_config.h"
+#include "../profiler.h"
+
+TaskHandle_t spin_controller_task;
+
+SpinController::SpinController() {
+    throttle = 0;
+    feed_forward_loaded = 0;
+    correction_curve_init(&feed_forward, PID_KFF);
+    target = {};
+    pid_gains = {};
+    reset();
+}
+
+void SpinController::init(IMU* imu) {
+    this->imu = imu;
+
+    xTaskCreatePinnedToCore(
+        controller_task,                // the function
+        "spin_controller",              // name the task
+        4096,                           // stack depth
+        this,                           // params
+        SPIN_CONTROLLER_PRIORITY,       // priority
+        &spin_controller_task,          // task handle
+        1                               // core affinity
+    );
+
+    // from here on, every new RPM estimate wakes us up
+    imu->set_estimate_listener(spin_controller_task);
+}
+
+// Runs once per RPM estimate
+// loop() writes the setpoint, gains and stored curve from our core, at a lower priority - so we can preempt it mid-write.
+// We only ever try_read() them: if loop()'s in the middle of one, we carry on with what we had, and pick it up next time
+void SpinController::controller_task(void* parameter) {
+    SpinController* controller = (SpinController*) parameter;
+
+    while (true) {
+        // if the sampler ever stalls, carry on with the estimator's extrapolation rather than leave the throttle where it was
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SPIN_CONTROLLER_TIMEOUT_MS));
+
+        controller->pick_up_feed_forward();
+        controller->setpoint.try_read(&controller->target);
+        controller->gains.try_read(&controller->pid_gains);
+
+        spin_setpoint_t target = controller->target;
+
+        if (!target.enabled) {
+            controller->reset();
+            controller->throttle = 0;
+            continue;
+        }
+
+        rpm_estimate_t estimate;
+        controller->imu->get_rpm_estimate(&estimate);
+
+        // the first step after a reset has nothing to measure dt from - assume it's been one sample
+        float dt_s = (controller->estimated_at_us == 0) ? (1.0f / ACCELEROMETER_SAMPLE_RATE_HZ)
+            : (estimate.timestamp_us - controller->estimated_at_us) / 1000000.0f;
+        controller->estimated_at_us = estimate.timestamp_us;
+
+        float output = controller->update(&controller->pid_gains, target.target_rpm, &estimate, dt_s);
+        controller->learn(target.target_rpm, &estimate, output, dt_s);
+        controller->throttle = (int) output;
+    }
+}
+
+// Swaps in the stored feed-forward curve, if the config's been (re)loaded since we last looked
+void SpinController::pick_up_feed_forward() {
+    correction_curve_t stored;
+    uint32_t version;
+
+    if (stored_feed_forward.try_read(&stored, &version) && version != feed_forward_loaded) {
+        feed_forward = stored;
+        feed_forward_loaded = version;
+        learned_feed_forward.write(feed_forward);
+    }
+}
+
+float SpinController::update(spin_pid_gains_t* gains, float target_rpm, rpm_estimate_t* estimate, float dt_s) {
+    PROFILE_SCOPE("SpinController::update");
+
+    float error = target_rpm - estimate->rpm;
+
+    // feed-forward does the bulk of the work - the rest of the PID only has to make up for what it gets wrong
+    // from a standing start, that means we start out at about the right throttle, rather than waiting for the integral to wind up
+    float feed_forward_throttle = correction_curve_get(&feed_forward, target_rpm) * target_rpm;
+    float proportional = gains->kp * error;
+
+    // derivative on measurement: the estimator already knows our acceleration, so there's nothing to difference (or filter)
+    float derivative = -gains->kd * estimate->rpm_per_s;
+
+    // anti-windup: while the output's pinned, only let the integral move back towards the range
+    float next_integral = integral + gains->ki * error * dt_s;
+    float output = feed_forward_throttle + proportional + next_integral + derivative;
+    bool pinned_high = output > SPIN_CONTROLLER_MAX_THROTTLE && error > 0;
+    bool pinned_low = output < 0 && error < 0;
+    if (!pinned_high && !pinned_low) {
+        integral = next_integral;
+    }
+
+    output = feed_forward_throttle + proportional + integral + derivative;
+    return constrain(output, 0.0f, (float) SPIN_CONTROLLER_MAX_THROTTLE);
+}
+
+// Nudges the feed-forward towards the throttle it's actually taking to hold this RPM - but only once we're holding it
+void SpinController::learn(float target_rpm, rpm_estimate_t* estimate, float output, float dt_s) {
+    bool settled = fabs(target_rpm - estimate->rpm) < target_rpm * FEED_FORWARD_SETTLED_PERCENT / 100
+        && fabs(estimate->rpm_per_s) < FEED_FORWARD_SETTLED_RPM_PER_S
+        && estimate->confidence >= FEED_FORWARD_MIN_CONFIDENCE;
+
+    // a pinned throttle can't tell us what it would have taken
+    bool pinned = output <= 0 || output >= SPIN_CONTROLLER_MAX_THROTTLE;
+
+    if (!settled || pinned || estimate->rpm < MIN_TRACKING_RPM) {
+        return;
+    }
+
+    float before = correction_curve_get(&feed_forward, target_rpm) * target_rpm;
+    correction_curve_learn(&feed_forward, estimate->rpm, output / estimate->rpm, FEED_FORWARD_LEARN_RATE * dt_s);
+    float after = correction_curve_get(&feed_forward, target_rpm) * target_rpm;
+
+    // whatever the feed-forward just picked up, the integral was already supplying - hand it over, so the throttle doesn't jump
+    integral -= after - before;
+
+    learned_feed_forward.write(feed_forward);
+}
+
+void SpinController::reset() {
+    integral = 0;
+    estimated_at_us = 0;
+}
+
+void SpinController::set_setpoint(bool enabled, float target_rpm) {
+    spin_setpoint_t target;
+    target.enabled = enabled;
+    target.target_rpm = target_rpm;
+    setpoint.write(target);
+}
+
+void SpinController::load_config(const robot_config_t* config) {
+    spin_pid_gains_t pid_gains;
+    pid_gains.kp = config->pid_kp;
+    pid_gains.ki = config->pid_ki;
+    pid_gains.kd = config->pid_kd;
+    gains.write(pid_gains);
+
+    stored_feed_forward.write(config->feed_forward_curve);
+}
+
+// The feed-forward curve as of the last thing we learned
+void SpinController::get_learned_feed_forward(correction_curve_t* curve) {
+    learned_feed_forward.read(curve);
+}
+
+int SpinController::get_throttle() {
+    return throttle;
+}
\ No newline at end of file
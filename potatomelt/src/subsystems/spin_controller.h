@@ -0,0 +1,57 @@
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include "../seqlock.h"
+#include "../config.h"
+#include "rpm_estimator.h"
+
+class IMU;
+
+#define SPIN_CONTROLLER_MAX_THROTTLE 1000
+
+// What loop() wants from the spin controller
+typedef struct spin_setpoint_t {
+    bool enabled;                   // false = throttle off, and let go of the integral
+    float target_rpm;
+} spin_setpoint_t;
+
+typedef struct spin_pid_gains_t {
+    float kp;                       // throttle per RPM of error
+    float ki;                       // throttle per RPM of error, per second
+    float kd;                       // throttle per RPM/s of acceleration
+} spin_pid_gains_t;
+
+// Chases the target RPM with the throttle
+// A float PID with feed-forward from the target RPM (learned as we go - see learn()), derivative on measurement
+// (so target changes don't kick it) and anti-windup. It runs in its own task, woken by the IMU every time there's a new RPM estimate - so it updates at the
+// accelerometer's sample rate, with a steady dt, regardless of what loop() or the controller are up to.
+// The hot loop picks up the throttle from get_throttle().
+class SpinController {
+    public:
+        SpinController();
+        void init(IMU* imu);
+        void set_setpoint(bool enabled, float target_rpm);
+        // picks up the gains and the feed-forward curve
+        void load_config(const robot_config_t* config);
+        int get_throttle();
+        void get_learned_feed_forward(correction_curve_t* curve);
+
+        // one step of the PID. Only the controller task calls these
+        float update(spin_pid_gains_t* gains, float target_rpm, rpm_estimate_t* estimate, float dt_s);
+        void learn(float target_rpm, rpm_estimate_t* estimate, float output, float dt_s);
+        void reset();
+    private:
+        static void controller_task(void* parameter);
+        void pick_up_feed_forward();
+        IMU* imu;
+        Seqlock<spin_setpoint_t> setpoint;
+        Seqlock<spin_pid_gains_t> gains;
+        Seqlock<correction_curve_t> stored_feed_forward;    // from the config, whenever it's (re)loaded
+        Seqlock<correction_curve_t> learned_feed_forward;   // what we've learned since, for saving
+        spin_setpoint_t target;                             // the controller task's copies of the setpoint and gains
+        spin_pid_gains_t pid_gains;
+        correction_curve_t feed_forward;                    // the controller task's working copy
+        uint32_t feed_forward_loaded;                       // which version of the stored curve that came from
+        std::atomic<int> throttle;
+        float integral;
+        unsigned long estimated_at_us;
+};
\ No newline at end of file
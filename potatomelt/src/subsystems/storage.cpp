@@ -1,42 +1,178 @@
 #include "storage.h"
+#include "../melty_config.h"
+#include "../log.h"
+#include "../hal/hal.h"
+
+#define KEY_CONFIG "config"
 
 Storage* active;
 
+TaskHandle_t storage_flusher;
+
 Storage* get_active_store() {
     return active;
 }
 
+// Reads the whole config in one go, and starts the flush task
 void Storage::init() {
-    preferences.begin("potatomelt", false);
+    hal_nvs_begin("potatomelt");
+
+    size_t read = hal_nvs_get_bytes(KEY_CONFIG, &blob, sizeof(config_blob_t));
+
+    spinning = false;
+    dirty = false;
     active = this;
+
+    if (read != sizeof(config_blob_t) || !config_is_valid(&blob)) {
+        LOG("Config: nothing valid stored, using the defaults from melty_config.h\n");
+        config_load_defaults(&blob);
+    } else if (blob.defaults_hash != config_defaults_hash()) {
+        // the stored tuning came from different defaults - take the new ones, or they'd never take effect
+        LOG("Config: melty_config.h has changed since the stored config was saved, taking its tuning and keeping the calibration\n");
+        config_update_defaults(&blob);
+        mark_dirty();
+    } else {
+        LOG("Config: loaded the stored config\n");
+    }
+    LOG("Config: using the %s profile \n", config_profile_name(blob.active_profile));
+
+    xTaskCreatePinnedToCore(
+        flush_task,                 // the function
+        "storage_flush",            // name the task
+        4096,                       // stack depth
+        this,                       // params
+        STORAGE_FLUSH_PRIORITY,     // priority
+        &storage_flusher,           // task handle
+        1                           // core affinity
+    );
 }
 
-int Storage::get_target_rpm() {
-    return preferences.getInt("target_rpm_index", 3);
+robot_config_t* Storage::active_config() {
+    return &blob.profiles[blob.active_profile];
 }
 
+const robot_config_t* Storage::get_config() {
+    return active_config();
+}
 
-void Storage::set_target_rpm(int rpm) {
-    preferences.putInt("target_rpm_index", rpm);
+void Storage::mark_dirty() {
+    dirty = true;
+    last_changed_at = hal_millis();
 }
 
-void Storage::set_accel_correction(int rpm, float corr) {
-    std::string key = "a_cor_" + std::to_string(rpm);
-    preferences.putFloat(key.c_str(), corr);
-    // Serial.printf("Setting accel factor. Key: %s val: %f \n", key.c_str(), corr);
+int Storage::get_profile() {
+    return blob.active_profile;
 }
 
+void Storage::set_profile(int profile) {
+    taskENTER_CRITICAL(&lock);
+    if (profile >= 0 && profile < NUM_PROFILES && blob.active_profile != profile) {
+        blob.active_profile = profile;
+        mark_dirty();
+    }
+    taskEXIT_CRITICAL(&lock);
+}
+
+int Storage::get_target_rpm() {
+    return active_config()->target_rpm_index;
+}
+
+void Storage::set_target_rpm(int rpm) {
+    taskENTER_CRITICAL(&lock);
+    if (active_config()->target_rpm_index != rpm) {
+        active_config()->target_rpm_index = rpm;
+        mark_dirty();
+    }
+    taskEXIT_CRITICAL(&lock);
+}
+
+// Per-target-RPM corrections, from before the correction curve
+// Only read now, once, to carry old trims over into the curve - so this one goes straight to flash
 float Storage::get_accel_correction(int rpm) {
-    std::string key = "a_cor_" + std::to_string(rpm);
-    float f = preferences.getFloat(key.c_str(), 0.0f);
-    // Serial.printf("Getting accel factor. Key: %s val: %f \n", key.c_str(), f);
-    return f;
+    char key[STORAGE_KEY_LENGTH];
+    snprintf(key, sizeof(key), "a_cor_%d", rpm);
+    return hal_nvs_get_float(key, 0.0f);
+}
+
+// The active profile's accelerometer correction curve
+// Returns false if we haven't stored one yet
+bool Storage::get_accel_correction_curve(correction_curve_t* curve) {
+    taskENTER_CRITICAL(&lock);
+    *curve = active_config()->accel_correction_curve;
+    bool found = active_config()->has_accel_correction_curve;
+    taskEXIT_CRITICAL(&lock);
+    return found;
+}
+
+void Storage::set_accel_correction_curve(correction_curve_t* curve) {
+    taskENTER_CRITICAL(&lock);
+    active_config()->accel_correction_curve = *curve;
+    active_config()->has_accel_correction_curve = true;
+    mark_dirty();
+    taskEXIT_CRITICAL(&lock);
+}
+
+// The learned feed-forward - it only changes a little each time, so only mark it dirty if it actually has
+void Storage::set_feed_forward_curve(correction_curve_t* curve) {
+    taskENTER_CRITICAL(&lock);
+    if (memcmp(&active_config()->feed_forward_curve, curve, sizeof(correction_curve_t)) != 0) {
+        active_config()->feed_forward_curve = *curve;
+        mark_dirty();
+    }
+    taskEXIT_CRITICAL(&lock);
 }
 
 int Storage::get_trans_trim() {
-    return preferences.getInt("target_trans_trim_idx", 4);
+    return active_config()->trans_trim_index;
 }
 
 void Storage::set_trans_trim(int idx) {
-    preferences.putInt("target_trans_trim_idx", idx);
+    taskENTER_CRITICAL(&lock);
+    if (active_config()->trans_trim_index != idx) {
+        active_config()->trans_trim_index = idx;
+        mark_dirty();
+    }
+    taskEXIT_CRITICAL(&lock);
+}
+
+void Storage::set_spinning(bool spinning) {
+    this->spinning = spinning;
+}
+
+// Waits for a quiet moment while we're not spinning, then writes everything that's changed in one go
+// Holding off until things are quiet means a run of D-pad presses only costs one write
+void Storage::flush_task(void* parameter) {
+    Storage* store = (Storage*) parameter;
+
+    while (true) {
+        vTaskDelay(pdMS_TO_TICKS(STORAGE_FLUSH_POLL_MS));
+
+        if (!store->dirty || store->spinning) {
+            continue;
+        }
+
+        if (hal_millis() - store->last_changed_at < STORAGE_FLUSH_QUIET_MS) {
+            continue;
+        }
+
+        store->flush();
+    }
+}
+
+void Storage::flush() {
+    if (!dirty) {
+        return;
+    }
+
+    // take a snapshot, so the setters never wait on flash
+    // it's a few hundred bytes - too big for the stack of everyone who might call this
+    static config_blob_t snapshot;
+
+    taskENTER_CRITICAL(&lock);
+    snapshot = blob;
+    dirty = false;
+    taskEXIT_CRITICAL(&lock);
+
+    config_update_crc(&snapshot);
+    hal_nvs_put_bytes(KEY_CONFIG, &snapshot, sizeof(config_blob_t));
 }
\ No newline at end of file
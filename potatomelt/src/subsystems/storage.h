@@ -1,16 +1,41 @@
-#include <Preferences.h>
+#include <Arduino.h>
+#include "../config.h"
 
+// NVS keys can be at most 15 characters long
+#define STORAGE_KEY_LENGTH 16
+
+// Settings, held in RAM
+// Everything lives in one config blob, read once at boot. Setters just update the cache and mark it dirty.
+// A background task writes it out to flash later, once things have gone quiet and we're not spinning -
+// flash writes stall both cores, and wear the flash out
 class Storage{
     public:
         void init();
+        // the active profile's settings. Read-only - go through the setters to change anything
+        const robot_config_t* get_config();
+        int get_profile();
+        void set_profile(int profile);
         int get_target_rpm();
         void set_target_rpm(int rpm);
         float get_accel_correction(int rpm);
-        void set_accel_correction(int rpm, float corr);
+        bool get_accel_correction_curve(correction_curve_t* curve);
+        void set_accel_correction_curve(correction_curve_t* curve);
+        void set_feed_forward_curve(correction_curve_t* curve);
         int get_trans_trim();
         void set_trans_trim(int idx);
+        // tells the flush task whether it's safe to write
+        void set_spinning(bool spinning);
+        // writes the blob out to flash right now, if anything's changed
+        void flush();
     private:
-        Preferences preferences;
+        static void flush_task(void* parameter);
+        robot_config_t* active_config();
+        void mark_dirty();
+        portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+        volatile bool spinning;
+        volatile bool dirty;
+        volatile unsigned long last_changed_at;
+        config_blob_t blob;
 };
 
 Storage* get_active_store();
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include <Arduino.h>
+#include <string.h>
+#include "telemetry.h"
+#include "flight_recorder.h"
+#include "hal/hal.h"
+
+// version + type + payload + CRC
+#define FRAME_HEADER_LENGTH 2
+#define FRAME_CRC_LENGTH 4
+#define MAX_FRAME_LENGTH (FRAME_HEADER_LENGTH + TELEMETRY_MAX_PAYLOAD + FRAME_CRC_LENGTH)
+
+// COBS adds a byte per 254, plus one. And then there's a delimiter either side
+#define MAX_ENCODED_LENGTH (MAX_FRAME_LENGTH + MAX_FRAME_LENGTH / 254 + 1 + 2)
+
+// the decoder's schema depends on these
+static_assert(sizeof(telemetry_status_t) == 58, "telemetry_status_t has changed shape - update tools/telemetry_decode.py");
+static_assert(sizeof(flight_record_t) == 24, "flight_record_t has changed shape - update tools/telemetry_decode.py");
+static_assert(MAX_FRAME_LENGTH < 254, "telemetry frames are only ever one COBS block - keep TELEMETRY_MAX_PAYLOAD down");
+
+uint32_t dropped_frames = 0;
+
+// Consistent Overhead Byte Stuffing: every zero gets replaced by the distance to the next one,
+// so the encoded frame has no zeros in it, and zero can be the delimiter
+static size_t cobs_encode(const uint8_t* in, size_t len, uint8_t* out) {
+    size_t code_at = 0;
+    size_t out_len = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < len; i++) {
+        if (in[i] == 0) {
+            out[code_at] = code;
+            code_at = out_len++;
+            code = 1;
+        } else {
+            out[out_len++] = in[i];
+            code++;
+            if (code == 0xFF) {
+                out[code_at] = code;
+                code_at = out_len++;
+                code = 1;
+            }
+        }
+    }
+
+    out[code_at] = code;
+    return out_len;
+}
+
+static size_t encoded_length(size_t payload_len) {
+    size_t frame_len = FRAME_HEADER_LENGTH + payload_len + FRAME_CRC_LENGTH;
+    return frame_len + frame_len / 254 + 1 + 2;
+}
+
+bool telemetry_can_send(size_t len) {
+    return Serial.availableForWrite() >= (int) encoded_length(len);
+}
+
+bool telemetry_send(uint8_t type, const void* payload, size_t len) {
+    if (len > TELEMETRY_MAX_PAYLOAD || !telemetry_can_send(len)) {
+        dropped_frames++;
+        return false;
+    }
+
+    uint8_t frame[MAX_FRAME_LENGTH];
+    frame[0] = TELEMETRY_PROTOCOL_VERSION;
+    frame[1] = type;
+    memcpy(&frame[FRAME_HEADER_LENGTH], payload, len);
+
+    uint32_t crc = hal_crc32(frame, FRAME_HEADER_LENGTH + len);
+    memcpy(&frame[FRAME_HEADER_LENGTH + len], &crc, FRAME_CRC_LENGTH);
+
+    uint8_t encoded[MAX_ENCODED_LENGTH];
+    encoded[0] = 0;
+    size_t encoded_len = 1 + cobs_encode(frame, FRAME_HEADER_LENGTH + len + FRAME_CRC_LENGTH, &encoded[1]);
+    encoded[encoded_len++] = 0;
+
+    Serial.write(encoded, encoded_len);
+    return true;
+}
+
+bool telemetry_send_text(const char* text) {
+    return telemetry_send(TELEMETRY_TEXT, text, min(strlen(text), (size_t) TELEMETRY_MAX_PAYLOAD));
+}
+
+uint32_t telemetry_get_dropped() {
+    return dropped_frames;
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#ifndef _TELEMETRY_h
+#define _TELEMETRY_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Binary telemetry over serial
+// Each frame is [version][type][payload][CRC32 of everything before it], COBS-encoded so it contains no zero bytes,
+// with a zero byte either side. Anything else on the wire (the odd Serial.println) falls between delimiters,
+// fails its CRC, and gets skipped by the decoder.
+// Payloads are packed little-endian structs. tools/telemetry_decode.py has the matching schema - change both together,
+// and bump TELEMETRY_PROTOCOL_VERSION when you do.
+
+#define TELEMETRY_PROTOCOL_VERSION 1
+#define TELEMETRY_MAX_PAYLOAD 240
+
+enum telemetry_frame_type {
+    TELEMETRY_STATUS = 1,           // a telemetry_status_t
+    TELEMETRY_FLIGHT_RECORDS = 2,   // a run of flight_record_t, oldest first
+    TELEMETRY_TEXT = 3,             // a message for humans, not null-terminated
+    TELEMETRY_LOG = 4               // a uint32_t timestamp in ms, then a formatted LOG() message, not null-terminated
+};
+
+// Everything the text log prints
+// Fields are laid out so they're all naturally aligned, even packed
+typedef struct __attribute__((packed)) telemetry_status_t {
+    uint32_t timestamp_ms;
+    uint8_t state;                  // robot_status
+    uint8_t profile;
+    uint8_t flags;                  // TELEMETRY_STATUS_*
+    uint8_t battery_percent;
+    float accel_correction;         // at the target RPM
+    float rpm_estimate;
+    float rpm_per_s;
+    float rpm_confidence;
+    float motor1_rpm;               // ESC telemetry, if TELEMETRY_STATUS_MOTOR_RPMS_VALID
+    float motor2_rpm;
+    uint32_t hotloop_ticks;         // hot loop timing since the last status
+    uint32_t hotloop_overruns;
+    int32_t hotloop_mean_lateness_us;
+    int32_t hotloop_max_lateness_us;
+    uint32_t dropped_frames;        // telemetry frames we couldn't fit in the serial buffer
+    int16_t target_rpm;
+    uint16_t i2c_transactions_per_sample;
+    uint16_t i2c_busy_us_per_sample;
+} telemetry_status_t;
+
+#define TELEMETRY_STATUS_CONNECTED 0x01
+#define TELEMETRY_STATUS_ALIVE 0x02
+#define TELEMETRY_STATUS_SPIN_REQUESTED 0x04
+#define TELEMETRY_STATUS_MOTOR_RPMS_VALID 0x08
+#define TELEMETRY_STATUS_FLIGHT_RECORDER_FROZEN 0x10
+
+// whether a payload this big would go out right now without blocking
+bool telemetry_can_send(size_t len);
+// sends a frame if there's room for it in the serial buffer. Otherwise drops it, and returns false
+bool telemetry_send(uint8_t type, const void* payload, size_t len);
+bool telemetry_send_text(const char* text);
+uint32_t telemetry_get_dropped();
+
+#endif
\ No newline at end of file
@@ -0,0 +1,261 @@
+#!/usr/bin/env python3
+"""Decodes PotatoMelt's binary telemetry stream into one file per frame type.
+
+The robot sends frames when TELEMETRY_BINARY_ENABLED is set in melty_config.h.
+Each frame is [version][type][payload][CRC32], COBS-encoded, with a zero byte either side.
+The schema below mirrors src/telemetry.h and src/flight_recorder.h - change them together.
+
+Usage:
+    telemetry_decode.py /dev/ttyACM0 --out run1/          # live from the robot, until Ctrl-C
+    telemetry_decode.py capture.bin --out run1/           # from a saved capture
+    telemetry_decode.py capture.bin --format parquet      # needs pyarrow
+
+LOG() messages, and anything on the wire that isn't a frame, end up in console.log.
+"""
+
+import argparse
+import csv
+import os
+import struct
+import sys
+import termios
+import tty
+import zlib
+
+PROTOCOL_VERSION = 1
+
+ROBOT_STATES = ["SPINNING", "READY", "LOW_BATTERY", "CONTROLLER_STALE", "NO_CONTROLLER"]
+PROFILES = ["ant", "beetle"]
+
+STATUS_FLAGS = {
+    "connected": 0x01,
+    "alive": 0x02,
+    "spin_requested": 0x04,
+    "motor_rpms_valid": 0x08,
+    "flight_recorder_frozen": 0x10,
+}
+
+# telemetry_status_t
+STATUS = struct.Struct("<IBBBBffffffIIiiIhHH")
+STATUS_FIELDS = [
+    "timestamp_ms", "state", "profile", "flags", "battery_percent",
+    "accel_correction", "rpm_estimate", "rpm_per_s", "rpm_confidence", "motor1_rpm", "motor2_rpm",
+    "hotloop_ticks", "hotloop_overruns", "hotloop_mean_lateness_us", "hotloop_max_lateness_us",
+    "dropped_frames", "target_rpm", "i2c_transactions_per_sample", "i2c_busy_us_per_sample",
+]
+
+# flight_record_t, including its byte of tail padding
+FLIGHT_RECORD = struct.Struct("<IIIhhHHBBBx")
+FLIGHT_RECORD_FIELDS = [
+    "timestamp_us", "phase", "phase_rate", "motor1_throttle", "motor2_throttle",
+    "lateness_us", "estimated_rpm", "state", "battery_percent", "flags",
+]
+
+TELEMETRY_STATUS = 1
+TELEMETRY_FLIGHT_RECORDS = 2
+TELEMETRY_TEXT = 3
+TELEMETRY_LOG = 4
+
+
+def cobs_decode(data):
+    """Undoes COBS. Returns None if the block is malformed."""
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def decode_status(payload):
+    row = dict(zip(STATUS_FIELDS, STATUS.unpack(payload)))
+    row["state"] = ROBOT_STATES[row["state"]] if row["state"] < len(ROBOT_STATES) else row["state"]
+    row["profile"] = PROFILES[row["profile"]] if row["profile"] < len(PROFILES) else row["profile"]
+    flags = row.pop("flags")
+    for name, bit in STATUS_FLAGS.items():
+        row[name] = int(bool(flags & bit))
+    return row
+
+
+def decode_flight_records(payload):
+    rows = []
+    for values in FLIGHT_RECORD.iter_unpack(payload):
+        row = dict(zip(FLIGHT_RECORD_FIELDS, values))
+        row["rpm"] = round(row.pop("phase_rate") * 60e6 / 2**32, 1)
+        row["state"] = ROBOT_STATES[row["state"]] if row["state"] < len(ROBOT_STATES) else row["state"]
+        row["led_on"] = row.pop("flags") & 0x01
+        rows.append(row)
+    return rows
+
+
+class Decoder:
+    """Splits a byte stream into frames, and checks and decodes each one."""
+
+    def __init__(self, sink):
+        self.sink = sink
+        self.buffer = bytearray()
+        self.counts = {"frames": 0, "console_lines": 0, "bad_crc": 0, "bad_cobs": 0, "bad_version": 0, "unknown_type": 0, "bad_length": 0}
+
+    def feed(self, data):
+        self.buffer += data
+        while True:
+            end = self.buffer.find(b"\x00")
+            if end < 0:
+                return
+            chunk = bytes(self.buffer[:end])
+            del self.buffer[:end + 1]
+            if chunk:
+                self.handle_chunk(chunk)
+
+    def handle_chunk(self, chunk):
+        frame = cobs_decode(chunk)
+        if frame is None or len(frame) < 6:
+            if not self.console(chunk):
+                self.counts["bad_cobs"] += 1
+            return
+
+        body, crc = frame[:-4], struct.unpack("<I", frame[-4:])[0]
+        if zlib.crc32(body) != crc:
+            if not self.console(chunk):
+                self.counts["bad_crc"] += 1
+            return
+
+        version, frame_type, payload = body[0], body[1], body[2:]
+        if version != PROTOCOL_VERSION:
+            self.counts["bad_version"] += 1
+            return
+
+        try:
+            if frame_type == TELEMETRY_STATUS:
+                self.sink.write("status", [decode_status(payload)])
+            elif frame_type == TELEMETRY_FLIGHT_RECORDS:
+                self.sink.write("flight_records", decode_flight_records(payload))
+            elif frame_type == TELEMETRY_TEXT:
+                self.sink.console(payload.decode("utf-8", "replace"))
+            elif frame_type == TELEMETRY_LOG:
+                timestamp_ms = struct.unpack_from("<I", payload)[0]
+                self.sink.console("[%10.3f] %s" % (timestamp_ms / 1000.0, payload[4:].decode("utf-8", "replace")))
+            else:
+                self.counts["unknown_type"] += 1
+                return
+        except struct.error:
+            self.counts["bad_length"] += 1
+            return
+
+        self.counts["frames"] += 1
+
+    def console(self, chunk):
+        """Text that got printed between frames. Returns False if it doesn't look like text."""
+        text = chunk.decode("utf-8", "replace").strip()
+        if not text or not all(c.isprintable() or c.isspace() for c in text):
+            return False
+        self.sink.console(text)
+        self.counts["console_lines"] += 1
+        return True
+
+
+class CsvSink:
+    """Writes rows out as they arrive, so a live capture can be watched with tail -f."""
+
+    def __init__(self, out_dir):
+        self.out_dir = out_dir
+        self.files = {}
+        self.writers = {}
+        self.console_file = open(os.path.join(out_dir, "console.log"), "a")
+
+    def write(self, name, rows):
+        if not rows:
+            return
+        if name not in self.writers:
+            f = open(os.path.join(self.out_dir, name + ".csv"), "w", newline="")
+            writer = csv.DictWriter(f, fieldnames=list(rows[0].keys()))
+            writer.writeheader()
+            self.files[name] = f
+            self.writers[name] = writer
+        self.writers[name].writerows(rows)
+        self.files[name].flush()
+
+    def console(self, text):
+        self.console_file.write(text + "\n")
+        self.console_file.flush()
+
+    def close(self):
+        for f in self.files.values():
+            f.close()
+        self.console_file.close()
+
+
+class ParquetSink(CsvSink):
+    """Collects columns in memory, and writes one parquet file per frame type at the end."""
+
+    def __init__(self, out_dir):
+        import pyarrow  # noqa: F401 - fail early if it's not installed
+        super().__init__(out_dir)
+        self.columns = {}
+
+    def write(self, name, rows):
+        table = self.columns.setdefault(name, {})
+        for row in rows:
+            for key, value in row.items():
+                table.setdefault(key, []).append(value)
+
+    def close(self):
+        import pyarrow
+        import pyarrow.parquet
+        for name, columns in self.columns.items():
+            pyarrow.parquet.write_table(pyarrow.table(columns), os.path.join(self.out_dir, name + ".parquet"))
+        super().close()
+
+
+def open_input(path, baud):
+    fd = os.open(path, os.O_RDONLY | os.O_NOCTTY)
+    if os.isatty(fd):
+        tty.setraw(fd)
+        attrs = termios.tcgetattr(fd)
+        speed = getattr(termios, "B%d" % baud)
+        attrs[4] = attrs[5] = speed
+        termios.tcsetattr(fd, termios.TCSANOW, attrs)
+    return fd
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode PotatoMelt binary telemetry")
+    parser.add_argument("input", help="serial device or capture file")
+    parser.add_argument("--out", default=".", help="directory to write decoded files into")
+    parser.add_argument("--format", choices=["csv", "parquet"], default="csv")
+    parser.add_argument("--baud", type=int, default=115200, help="baud rate, if input is a serial device")
+    parser.add_argument("--capture", help="also save the raw bytes here, to decode again later")
+    args = parser.parse_args()
+
+    os.makedirs(args.out, exist_ok=True)
+    sink = ParquetSink(args.out) if args.format == "parquet" else CsvSink(args.out)
+    decoder = Decoder(sink)
+    capture = open(args.capture, "wb") if args.capture else None
+
+    fd = open_input(args.input, args.baud)
+    try:
+        while True:
+            data = os.read(fd, 4096)
+            if not data:
+                break
+            if capture:
+                capture.write(data)
+            decoder.feed(data)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        os.close(fd)
+        sink.close()
+        if capture:
+            capture.close()
+
+    print(", ".join("%s: %d" % item for item in decoder.counts.items()), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+"""Decodes telemetry_capture.bin, a capture of the firmware's own framing.
+
+potatomelt/host/tests/test_telemetry.cpp sends the frames in it through the real telemetry_send(), and checks the
+capture still matches - regenerate it with "test_telemetry --write", and update the expected values here, together.
+"""
+
+import os
+import struct
+import sys
+import unittest
+import zlib
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+
+import telemetry_decode  # noqa: E402
+
+CAPTURE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "telemetry_capture.bin")
+
+
+class ListSink:
+    def __init__(self):
+        self.rows = {}
+        self.lines = []
+
+    def write(self, name, rows):
+        self.rows.setdefault(name, []).extend(rows)
+
+    def console(self, text):
+        self.lines.append(text)
+
+
+def cobs_encode(data):
+    out = bytearray()
+    for block in data.split(b"\x00"):
+        out.append(len(block) + 1)
+        out += block
+    return bytes(out)
+
+
+def frame(frame_type, payload):
+    body = bytes([telemetry_decode.PROTOCOL_VERSION, frame_type]) + payload
+    return b"\x00" + cobs_encode(body + struct.pack("<I", zlib.crc32(body))) + b"\x00"
+
+
+class TelemetryDecodeTest(unittest.TestCase):
+    def setUp(self):
+        with open(CAPTURE, "rb") as f:
+            self.capture = f.read()
+        # the line printed before the frames, then the status, flight records, text and log frames
+        chunks = [chunk for chunk in self.capture.split(b"\x00") if chunk]
+        self.assertEqual(len(chunks), 5)
+        self.status_chunk = chunks[1]
+
+    def decode(self, data, chunk_size=None):
+        sink = ListSink()
+        decoder = telemetry_decode.Decoder(sink)
+        if chunk_size is None:
+            decoder.feed(data)
+        else:
+            for i in range(0, len(data), chunk_size):
+                decoder.feed(data[i:i + chunk_size])
+        return sink, decoder.counts
+
+    def assert_counts(self, counts, **expected):
+        for name, value in counts.items():
+            self.assertEqual(value, expected.get(name, 0), name)
+
+    def test_capture(self):
+        sink, counts = self.decode(self.capture)
+        self.assert_counts(counts, frames=4, console_lines=1)
+
+        self.assertEqual(sink.rows["status"], [{
+            "timestamp_ms": 123456, "state": "SPINNING", "profile": "beetle", "battery_percent": 87,
+            "accel_correction": 1.25, "rpm_estimate": 1487.5, "rpm_per_s": -12.5, "rpm_confidence": 0.75,
+            "motor1_rpm": 0.0, "motor2_rpm": 0.0,
+            "hotloop_ticks": 2000, "hotloop_overruns": 3, "hotloop_mean_lateness_us": 7, "hotloop_max_lateness_us": 180,
+            "dropped_frames": 0, "target_rpm": 1500, "i2c_transactions_per_sample": 2, "i2c_busy_us_per_sample": 420,
+            "connected": 1, "alive": 1, "spin_requested": 1, "motor_rpms_valid": 0, "flight_recorder_frozen": 0,
+        }])
+
+        records = sink.rows["flight_records"]
+        self.assertEqual([r["timestamp_us"] for r in records], [1000000, 1000250, 1000500])
+        self.assertEqual([r["phase"] for r in records], [0, 0x40000000, 0x80000000])
+        self.assertEqual([r["rpm"] for r in records], [1500.0] * 3)
+        self.assertEqual([r["motor1_throttle"] for r in records], [600, 601, 602])
+        self.assertEqual([r["motor2_throttle"] for r in records], [-600, -601, -602])
+        self.assertEqual([r["lateness_us"] for r in records], [0, 10, 20])
+        self.assertEqual([r["estimated_rpm"] for r in records], [1490, 1491, 1492])
+        self.assertEqual([r["led_on"] for r in records], [0, 1, 0])
+        self.assertEqual({r["state"] for r in records}, {"SPINNING"})
+
+        self.assertEqual(sink.lines, ["PotatoMelt starting", "Flight recorder: 3 records", "[   123.500] Calibration done"])
+
+    def test_capture_a_byte_at_a_time(self):
+        whole, _ = self.decode(self.capture)
+        sink, counts = self.decode(self.capture, chunk_size=1)
+        self.assert_counts(counts, frames=4, console_lines=1)
+        self.assertEqual(sink.rows, whole.rows)
+        self.assertEqual(sink.lines, whole.lines)
+
+    def test_bad_crc(self):
+        # one bit flipped in the status payload: that frame's dropped and counted, and the rest still decode
+        at = self.capture.index(self.status_chunk) + len(self.status_chunk) // 2
+        corrupted = bytearray(self.capture)
+        corrupted[at] ^= 0x10
+        self.assertNotEqual(corrupted[at], 0)
+
+        sink, counts = self.decode(bytes(corrupted))
+        self.assert_counts(counts, frames=3, console_lines=1, bad_crc=1)
+        self.assertNotIn("status", sink.rows)
+        self.assertEqual(len(sink.rows["flight_records"]), 3)
+
+    def test_truncated_frame(self):
+        # the back half of the status frame lost on the wire: the decoder picks up again at the next delimiter
+        start = self.capture.index(self.status_chunk)
+        truncated = self.capture[:start + len(self.status_chunk) // 2] + self.capture[start + len(self.status_chunk):]
+
+        sink, counts = self.decode(truncated)
+        self.assertEqual(counts["frames"], 3)
+        self.assertEqual(counts["bad_cobs"] + counts["bad_crc"], 1)
+        self.assertNotIn("status", sink.rows)
+        self.assertEqual(len(sink.rows["flight_records"]), 3)
+
+    def test_truncated_capture(self):
+        # a capture that stops partway through the last frame: it's never decoded, and nothing's miscounted
+        sink, counts = self.decode(self.capture[:-5])
+        self.assert_counts(counts, frames=3, console_lines=1)
+        self.assertEqual(sink.lines, ["PotatoMelt starting", "Flight recorder: 3 records"])
+
+    def test_short_payload(self):
+        # frame() builds them just as the firmware does
+        payload = telemetry_decode.cobs_decode(self.status_chunk)[2:-4]
+        self.assertEqual(frame(telemetry_decode.TELEMETRY_STATUS, payload), b"\x00" + self.status_chunk + b"\x00")
+
+        # so here's one that checks out, but whose payload is too short for its type
+        sink, counts = self.decode(frame(telemetry_decode.TELEMETRY_STATUS, payload[:3]))
+        self.assert_counts(counts, bad_length=1)
+        self.assertNotIn("status", sink.rows)
+
+    def test_wrong_version_and_type(self):
+        body = bytes([telemetry_decode.PROTOCOL_VERSION + 1, telemetry_decode.TELEMETRY_TEXT]) + b"hello"
+        other_version = b"\x00" + cobs_encode(body + struct.pack("<I", zlib.crc32(body))) + b"\x00"
+        _, counts = self.decode(other_version + frame(99, b"hello"))
+        self.assert_counts(counts, bad_version=1, unknown_type=1)
+
+
+if __name__ == "__main__":
+    unittest.main()